@@ -0,0 +1,19 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#ifndef SIMPLERENDERER_BOX_H
+#define SIMPLERENDERER_BOX_H
+
+#include "filter.h"
+
+namespace sr {
+    class BoxFilter : public Filter {
+    public:
+        BoxFilter(const Vector2f &radius) : Filter(radius) {}
+
+        Float Evaluate(const Point2f &p) const override;
+    };
+}
+
+#endif //SIMPLERENDERER_BOX_H
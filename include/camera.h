@@ -0,0 +1,95 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#ifndef SIMPLERENDERER_CAMERA_H
+#define SIMPLERENDERER_CAMERA_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "transform.h"
+#include "sampler.h"
+#include <vector>
+
+namespace sr {
+    class Film;
+
+    //structure of arrays ray buffer, all rays of a batch share the camera medium and tMax = Infinity
+    struct RayBatch {
+        std::vector<Float> ox, oy, oz;
+        std::vector<Float> dx, dy, dz;
+        std::vector<Float> time;
+
+        void Resize(std::size_t n);
+
+        std::size_t Size() const { return time.size(); }
+
+        Ray Get(std::size_t i, const Medium *medium = nullptr) const {
+            return Ray(Point3f(ox[i], oy[i], oz[i]), Vector3f(dx[i], dy[i], dz[i]), Infinity, time[i], medium);
+        }
+
+        void Set(std::size_t i, const Ray &r);
+    };
+
+    class Camera {
+    public:
+        Camera(const Transform &cameraToWorld, Float shutterOpen, Float shutterClose, Film *film,
+               const Medium *medium = nullptr);
+
+        virtual ~Camera();
+
+        //returns the weight of the ray
+        virtual Float GenerateRay(const CameraSample &sample, Ray *ray) const = 0;
+
+        //main ray plus the rays through the pixels one step right and one step down
+        virtual Float GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const;
+
+        //cone of a primary ray covering one pixel
+        virtual RayCone GeneratePixelCone() const { return RayCone(); }
+
+        //rays of samples[0, n) are written to rays[offset, offset + n), rays must be large enough
+        //all cameras here have constant ray weight 1
+        virtual void GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays, int64_t offset = 0) const;
+
+        //sample sampleIndex of every pixel in [x0, x1) of raster row y
+        void GenerateRowRays(Sampler &sampler, int y, int x0, int x1, int64_t sampleIndex,
+                             std::vector<CameraSample> *samples, RayBatch *rays) const;
+
+        //u in [0, 1) to the shutter interval
+        Float SampleTime(Float u) const { return shutterOpen + u * (shutterClose - shutterOpen); }
+
+        const Transform cameraToWorld;
+        const Float shutterOpen, shutterClose;
+        Film *film;
+        const Medium *medium;
+    };
+
+    //screen window covering the image with the shorter axis in [-1, 1]
+    Bounds2f DefaultScreenWindow(const Point2i &resolution);
+
+    //camera with a projective camera-to-screen transform and an optional thin lens
+    class ProjectiveCamera : public Camera {
+    public:
+        ProjectiveCamera(const Transform &cameraToWorld, const Transform &cameraToScreen, const Bounds2f &screenWindow,
+                         Float shutterOpen, Float shutterClose, Float lensRadius, Float focalDistance, Film *film,
+                         const Medium *medium = nullptr);
+
+    protected:
+        Transform cameraToScreen, rasterToCamera;
+        Transform screenToRaster, rasterToScreen;
+        Float lensRadius, focalDistance;
+
+        //raster (x, y, 0) to camera space is affine: pCamera = pCamera0 + x * dxCamera + y * dyCamera
+        Point3f pCamera0;
+        Vector3f dxCamera, dyCamera;
+
+        //the same map fused with cameraToWorld, so ray generation needs no matrix products
+        Point3f pWorld0;
+        Vector3f vWorld0, dxWorld, dyWorld;
+        //camera origin, view direction, and lens axes scaled by lensRadius in world space
+        Point3f originWorld;
+        Vector3f forwardWorld, lensU, lensV;
+    };
+}
+
+#endif //SIMPLERENDERER_CAMERA_H
@@ -0,0 +1,117 @@
+//
+// Created by 18310 on 2021/4/16.
+//
+
+#ifndef SIMPLERENDERER_COMPACTSPECTRUM_H
+#define SIMPLERENDERER_COMPACTSPECTRUM_H
+
+#include "spectrum.h"
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace sr {
+
+    //Storage-only spectrum format for texture tiles and film tile payloads.
+    //It cannot do arithmetic, Decode() it into a CoefficientSpectrum first.
+
+    //IEEE 754 binary16 conversion, round to nearest even
+    inline uint16_t FloatToHalf(float f) {
+        uint32_t x;
+        std::memcpy(&x, &f, sizeof(float));
+        uint16_t sign = (x >> 16) & 0x8000;
+        uint32_t mant = x & 0x7fffff;
+        int exp = (x >> 23) & 0xff;
+        //inf and nan, keep nan quiet
+        if (exp == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+        int e = exp - 127 + 15;
+        if (e >= 0x1f) return sign | 0x7c00;
+        if (e <= 0) {
+            //subnormal half, or flushed to zero
+            if (e < -10) return sign;
+            mant |= 0x800000;
+            int shift = 14 - e;
+            uint32_t half = mant >> shift;
+            uint32_t rem = mant & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (rem > halfway || (rem == halfway && (half & 1))) half++;
+            return sign | half;
+        }
+        uint32_t half = (uint32_t(e) << 10) | (mant >> 13);
+        uint32_t rem = mant & 0x1fff;
+        //a carry out of the mantissa correctly bumps the exponent
+        if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;
+        return sign | half;
+    }
+
+    inline float HalfToFloat(uint16_t h) {
+        const uint32_t shiftedExp = 0x7c00 << 13;
+        uint32_t bits = uint32_t(h & 0x7fff) << 13;
+        uint32_t exp = shiftedExp & bits;
+        bits += (127 - 15) << 23;
+        float f;
+        if (exp == shiftedExp) {
+            //inf and nan
+            bits += (128 - 16) << 23;
+            std::memcpy(&f, &bits, sizeof(float));
+        } else if (exp == 0) {
+            //subnormal, renormalize through a float subtraction
+            const uint32_t magicBits = 113 << 23;
+            float magic;
+            std::memcpy(&magic, &magicBits, sizeof(float));
+            bits += 1 << 23;
+            std::memcpy(&f, &bits, sizeof(float));
+            f -= magic;
+        } else {
+            std::memcpy(&f, &bits, sizeof(float));
+        }
+        return (h & 0x8000) ? -f : f;
+    }
+
+    //half precision coefficients, half the size of CoefficientSpectrum<float>
+    template<int nSpectrumSamples>
+    class HalfSpectrum {
+    public:
+        HalfSpectrum() { std::memset(h, 0, sizeof(h)); }
+
+        explicit HalfSpectrum(const CoefficientSpectrum<nSpectrumSamples> &cs) { Encode(cs); }
+
+        void Encode(const CoefficientSpectrum<nSpectrumSamples> &cs) {
+            for (int i = 0; i < nSpectrumSamples; ++i) {
+                h[i] = FloatToHalf(float(cs.c[i]));
+            }
+        }
+
+        void Decode(CoefficientSpectrum<nSpectrumSamples> *cs) const {
+#if defined(__F16C__)
+            //enabled by SR_F16C, 8 conversions per instruction and one instruction for each remaining coefficient
+            int i = 0;
+            if (sizeof(Float) == sizeof(float)) {
+                for (; i + 8 <= nSpectrumSamples; i += 8) {
+                    __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&h[i]));
+                    _mm256_storeu_ps(reinterpret_cast<float *>(&cs->c[i]), _mm256_cvtph_ps(packed));
+                }
+            }
+            for (; i < nSpectrumSamples; ++i) {
+                cs->c[i] = _cvtsh_ss(h[i]);
+            }
+#else
+            for (int i = 0; i < nSpectrumSamples; ++i) {
+                cs->c[i] = HalfToFloat(h[i]);
+            }
+#endif
+        }
+
+        CoefficientSpectrum<nSpectrumSamples> Decode() const {
+            CoefficientSpectrum<nSpectrumSamples> cs;
+            Decode(&cs);
+            return cs;
+        }
+
+    private:
+        uint16_t h[nSpectrumSamples];
+    };
+}
+
+#endif //SIMPLERENDERER_COMPACTSPECTRUM_H
@@ -0,0 +1,107 @@
+//
+// Created by 18310 on 2021/5/12.
+//
+
+#ifndef SIMPLERENDERER_DISTRIBUTED_H
+#define SIMPLERENDERER_DISTRIBUTED_H
+
+#include "sr.h"
+#include "film.h"
+#include "renderserver.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace sr {
+
+    struct DistributedOptions {
+        //tiles a worker holds beyond one per thread, so it never waits for the next assignment
+        int prefetch = 2;
+        //Compressed and Float are lossless, Half rounds and clamps values beyond 65504
+        TileEncoding encoding = TileEncoding::Compressed;
+        //once no tile is left to hand out, idle workers render copies of tiles still out on slower workers
+        //and the first result to arrive is kept
+        bool duplicateStragglers = true;
+        //seconds Render waits for a worker when none is connected
+        double workerTimeout = 30;
+        //slowest tiles kept in the report
+        int slowestTiles = 5;
+    };
+
+    struct DistributedWorkerReport {
+        int threads = 0;
+        //results merged, tiles taken from other workers' queues, copies of straggling tiles rendered
+        int64_t tiles = 0, stolen = 0, duplicates = 0;
+        //tile render time over the worker's threads
+        double busySeconds = 0;
+        //seconds from the start of the job to the worker's last merged result
+        double finishSeconds = 0;
+        int64_t payloadBytes = 0;
+        bool lost = false;
+    };
+
+    struct DistributedReport {
+        double seconds = 0;
+        int64_t tiles = 0;
+        //received, and what the same tiles take as floats; floatBytes / payloadBytes is the compression ratio
+        int64_t payloadBytes = 0, floatBytes = 0;
+        //coordinator time spent receiving, decoding and merging results
+        double mergeSeconds = 0;
+        //results that arrived after another copy of their tile
+        int64_t discardedResults = 0;
+        std::vector<DistributedWorkerReport> workers;
+        //(tile, seconds on its worker), slowest first
+        std::vector<std::pair<Bounds2i, double>> slowestTiles;
+
+        //parallel efficiency, stragglers and transfer overhead
+        void Print(std::ostream &os) const;
+    };
+
+    //Splits a job's sample bounds into tiles and farms them out to worker processes connected over TCP or Unix
+    //sockets. Every worker starts with a contiguous run of the spiral tile order in proportion to its threads and
+    //is kept threads + prefetch tiles ahead. A worker that runs dry steals the back half of the longest queue,
+    //workers joining late start by stealing. Results come back as FilmTile payloads in options.encoding and are
+    //merged as they arrive; a lost worker's tiles are queued again.
+    class RenderCoordinator {
+    public:
+        explicit RenderCoordinator(const std::string &endpoint,
+                                   const DistributedOptions &options = DistributedOptions());
+
+        //sends Shutdown to the workers
+        ~RenderCoordinator();
+
+        //opens the endpoint, false on failure
+        bool Listen();
+
+        //blocks until n workers are connected or timeoutSeconds pass, returns the number connected
+        int WaitForWorkers(int n, double timeoutSeconds);
+
+        //film must come from CreateJobFilm(job, ...), false when the job is invalid or every worker is gone
+        bool Render(const RenderJob &job, Film *film, DistributedReport *report = nullptr);
+
+        int WorkerCount() const { return int(workers.size()); }
+
+    private:
+        struct Worker {
+            int fd;
+            int threads;
+        };
+
+        //accepts a pending connection and reads its Hello
+        bool AcceptWorker();
+
+        const std::string endpoint;
+        const DistributedOptions options;
+        int listenFd = -1;
+        std::vector<Worker> workers;
+        int32_t jobId = 0;
+    };
+
+    //Worker process side: connects to the coordinator at endpoint and renders the tiles it is handed on scene
+    //with every thread, sending each back as soon as it is done, until the coordinator shuts it down.
+    //Counters and validation failures of each job go to std::cerr once it ends.
+    bool RunRenderWorker(const std::string &endpoint, std::shared_ptr<const Scene> scene,
+                         const GuidedPathOptions &options = GuidedPathOptions());
+}
+
+#endif //SIMPLERENDERER_DISTRIBUTED_H
@@ -0,0 +1,178 @@
+//
+// Created by 18310 on 2021/4/21.
+//
+
+#ifndef SIMPLERENDERER_FILM_H
+#define SIMPLERENDERER_FILM_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "spectrum.h"
+#include "filter.h"
+#include "parallel.h"
+#include <memory>
+#include <vector>
+
+namespace sr {
+
+    //Welford running mean and variance of the luminance of one pixel's samples
+    struct VarianceEstimator {
+        int64_t n = 0;
+        double mean = 0, m2 = 0;
+
+        void Add(Float x) {
+            ++n;
+            double delta = x - mean;
+            mean += delta / n;
+            m2 += delta * (x - mean);
+        }
+
+        double Variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+
+        //standard error of the mean relative to the mean, dark pixels are measured against 1e-3
+        double RelativeError() const {
+            if (n < 2) return Infinity;
+            return std::sqrt(Variance() / n) / std::max(std::abs(mean), 1e-3);
+        }
+    };
+
+    struct FilmTilePixel {
+        Float xyz[3] = {0, 0, 0};
+        Float filterWeightSum = 0;
+    };
+
+    //FilmTile payload formats. Float keeps the sums exactly, 16 bytes a pixel. Half sends every pixel's mean as
+    //binary16 and its filter weight sum as a float, 10 bytes a pixel with about 3 significant digits.
+    //Compressed is lossless: the Float payload with every channel xor'ed against the previous pixel, split into
+    //byte planes and run length encoded, so empty pixels and the shared high bytes of neighbours cost little.
+    enum class TileEncoding : uint32_t {
+        Float,
+        Half,
+        Compressed
+    };
+
+    //Private accumulation buffer of one worker, covering its tile plus the filter radius.
+    //Samples are stored as XYZ, so any spectrum type with ToXYZ can be added.
+    class FilmTile {
+    public:
+        //pixelStats (optional) covers statsBounds, it is only written for pixels in this tile's sample bounds
+        FilmTile(const Bounds2i &pixelBounds, const Vector2f &filterRadius, const Float *filterTable,
+                 int filterTableWidth, VarianceEstimator *pixelStats = nullptr,
+                 const Bounds2i &statsBounds = Bounds2i()) : pixelBounds(pixelBounds), filterRadius(filterRadius),
+                                                             invFilterRadius(1 / filterRadius.x, 1 / filterRadius.y),
+                                                             filterTable(filterTable),
+                                                             filterTableWidth(filterTableWidth),
+                                                             pixels(std::max(0, pixelBounds.SurfaceArea())),
+                                                             pixelStats(pixelStats), statsBounds(statsBounds) {}
+
+        //pFilm is in continuous raster coordinates
+        template<typename SpectrumType>
+        void AddSample(const Point2f &pFilm, const SpectrumType &L, Float sampleWeight = 1.f) {
+            Float xyz[3];
+            L.ToXYZ(xyz);
+            AddSampleXYZ(pFilm, xyz, sampleWeight);
+            if (pixelStats) {
+                //the sample's own pixel belongs to exactly one tile, so no other thread touches its estimator
+                Point2i p((int) std::floor(pFilm.x), (int) std::floor(pFilm.y));
+                if (InsideExclusive(statsBounds, p)) {
+                    int width = statsBounds.pMax.x - statsBounds.pMin.x;
+                    pixelStats[(p.y - statsBounds.pMin.y) * width + (p.x - statsBounds.pMin.x)].Add(
+                            L.y() * sampleWeight);
+                }
+            }
+        }
+
+        void AddSampleXYZ(const Point2f &pFilm, const Float xyz[3], Float sampleWeight = 1.f);
+
+        FilmTilePixel &GetPixel(const Point2i &p) {
+            assert(InsideExclusive(pixelBounds, p));
+            int width = pixelBounds.pMax.x - pixelBounds.pMin.x;
+            return pixels[(p.y - pixelBounds.pMin.y) * width + (p.x - pixelBounds.pMin.x)];
+        }
+
+        const FilmTilePixel &GetPixel(const Point2i &p) const {
+            assert(InsideExclusive(pixelBounds, p));
+            int width = pixelBounds.pMax.x - pixelBounds.pMin.x;
+            return pixels[(p.y - pixelBounds.pMin.y) * width + (p.x - pixelBounds.pMin.x)];
+        }
+
+        const Bounds2i &GetPixelBounds() const { return pixelBounds; }
+
+        //appends the pixel bounds, the encoding and every pixel, for tiles rendered in another process
+        void Encode(std::vector<uint8_t> *payload, TileEncoding encoding = TileEncoding::Compressed) const;
+
+    private:
+        const Bounds2i pixelBounds;
+        const Vector2f filterRadius, invFilterRadius;
+        const Float *filterTable;
+        const int filterTableWidth;
+        std::vector<FilmTilePixel> pixels;
+        VarianceEstimator *pixelStats;
+        const Bounds2i statsBounds;
+    };
+
+    //Image film over croppedPixelBounds. Workers render into FilmTiles from GetFilmTile and hand them back to
+    //MergeFilmTile, which accumulates with atomic adds, so tiles from any number of threads merge without locks.
+    class Film {
+    public:
+        //cropWindow is in NDC, [0, 1]^2 is the full image
+        Film(const Point2i &resolution, const Bounds2f &cropWindow, std::unique_ptr<Filter> filter,
+             const std::string &filename, Float scale = 1.f);
+
+        //pixels whose samples can reach croppedPixelBounds through the filter
+        Bounds2i GetSampleBounds() const;
+
+        std::unique_ptr<FilmTile> GetFilmTile(const Bounds2i &sampleBounds) const;
+
+        void MergeFilmTile(std::unique_ptr<FilmTile> tile) { MergeFilmTile(*tile); }
+
+        void MergeFilmTile(const FilmTile &tile);
+
+        //tile of a FilmTile::Encode payload, nullptr when it is malformed or reaches outside croppedPixelBounds
+        std::unique_ptr<FilmTile> DecodeFilmTile(const uint8_t *payload, std::size_t size) const;
+
+        //resolved rgb of croppedPixelBounds, 3 floats per pixel, top row first
+        void GetRGB(Float *rgb) const;
+
+        bool WriteImage() const;
+
+        void Clear();
+
+        //replaces the pixels of croppedPixelBounds, row major, for integrators that estimate whole pixels.
+        //Instantiated for RGBSpectrum and SampledSpectrum.
+        template<typename SpectrumType>
+        void SetImage(const SpectrumType *img);
+
+        //track per pixel luminance statistics over GetSampleBounds(), used by adaptive sampling
+        void EnablePixelStatistics();
+
+        //root mean square of the pixels' relative errors in sampleBounds, Infinity without statistics
+        Float Error(const Bounds2i &sampleBounds) const;
+
+        const Point2i fullResolution;
+        const std::unique_ptr<Filter> filter;
+        const std::string filename;
+        Bounds2i croppedPixelBounds;
+
+    private:
+        struct Pixel {
+            AtomicFloat xyz[3];
+            AtomicFloat filterWeightSum;
+        };
+
+        //filter values over one quadrant of [0, radius]^2, the filter is assumed symmetric
+        static constexpr int filterTableWidth = 16;
+        Float filterTable[filterTableWidth * filterTableWidth];
+        std::unique_ptr<Pixel[]> pixels;
+        const Float scale;
+        std::unique_ptr<VarianceEstimator[]> pixelStats;
+
+        Pixel &GetPixel(const Point2i &p) const {
+            assert(InsideExclusive(croppedPixelBounds, p));
+            int width = croppedPixelBounds.pMax.x - croppedPixelBounds.pMin.x;
+            return pixels[(p.y - croppedPixelBounds.pMin.y) * width + (p.x - croppedPixelBounds.pMin.x)];
+        }
+    };
+}
+
+#endif //SIMPLERENDERER_FILM_H
@@ -0,0 +1,26 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#ifndef SIMPLERENDERER_FILTER_H
+#define SIMPLERENDERER_FILTER_H
+
+#include "sr.h"
+#include "geometry.h"
+
+namespace sr {
+    //pixel reconstruction filter, nonzero only inside [-radius, radius]
+    class Filter {
+    public:
+        Filter(const Vector2f &radius) : radius(radius), invRadius(1 / radius.x, 1 / radius.y) {}
+
+        virtual ~Filter();
+
+        //p is relative to the filter center
+        virtual Float Evaluate(const Point2f &p) const = 0;
+
+        const Vector2f radius, invRadius;
+    };
+}
+
+#endif //SIMPLERENDERER_FILTER_H
@@ -0,0 +1,30 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#ifndef SIMPLERENDERER_GAUSSIAN_H
+#define SIMPLERENDERER_GAUSSIAN_H
+
+#include "filter.h"
+
+namespace sr {
+    //gaussian shifted down so that it reaches zero at the radius
+    class GaussianFilter : public Filter {
+    public:
+        GaussianFilter(const Vector2f &radius, Float alpha) : Filter(radius), alpha(alpha),
+                                                              expX(std::exp(-alpha * radius.x * radius.x)),
+                                                              expY(std::exp(-alpha * radius.y * radius.y)) {}
+
+        Float Evaluate(const Point2f &p) const override;
+
+    private:
+        const Float alpha;
+        const Float expX, expY;
+
+        Float Gaussian(Float d, Float expv) const {
+            return std::max((Float) 0, Float(std::exp(-alpha * d * d) - expv));
+        }
+    };
+}
+
+#endif //SIMPLERENDERER_GAUSSIAN_H
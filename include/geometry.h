@@ -9,6 +9,7 @@
 #include <iterator>
 
 #include "sr.h"
+#include "stats.h"
 
 namespace sr {
 
@@ -20,7 +21,7 @@ namespace sr {
         Vector2() : x(0), y(0) {}
 
         Vector2(T _x, T _y) : x(_x), y(_y) {
-            assert(!HasNans());
+            SR_VALIDATE(!HasNans());
         }
 
         T operator[](std::size_t i) const {
@@ -169,13 +170,15 @@ namespace sr {
         Vector3() : x(0), y(0), z(0) {}
 
         Vector3(T _x, T _y, T _z) : x(_x), y(_y), z(_z) {
-            assert(!HasNans());
+            SR_VALIDATE(!HasNans());
         }
 
         explicit Vector3(const Normal3<T> &n) : x(n.x), y(n.y), z(n.z) {
-            assert(n.HasNans());
+            SR_VALIDATE(!n.HasNans());
         }
 
+        explicit Vector3(const Point3<T> &p) : x(p.x), y(p.y), z(p.z) {}
+
         T operator[](std::size_t i) const {
             assert(i >= 0 && i < 3);
             return i == 0 ? x : (i == 1 ? y : z);
@@ -358,10 +361,24 @@ namespace sr {
 
         Point2() : x(0), y(0) {}
 
-        Point2(T _x, T _y) : x(_x), y(_y) { assert(!HasNans()); }
+        Point2(T _x, T _y) : x(_x), y(_y) { SR_VALIDATE(!HasNans()); }
 
         template<typename U>
-        explicit Point2(const Point3<U> &p) : x((U) p.x), y((U) p.y) { assert(!HasNans()); }
+        explicit Point2(const Point3<U> &p) : x((U) p.x), y((U) p.y) { SR_VALIDATE(!HasNans()); }
+
+        //avoid implicit conversion from point<U> to point<T>
+        template<typename U>
+        explicit Point2(const Point2<U> &p) : x((T) p.x), y((T) p.y) { SR_VALIDATE(!HasNans()); }
+
+        T operator[](std::size_t i) const {
+            assert(i >= 0 && i < 2);
+            return i == 0 ? x : y;
+        }
+
+        T &operator[](std::size_t i) {
+            assert(i >= 0 && i < 2);
+            return i == 0 ? x : y;
+        }
 
         template<typename U>
         explicit operator Vector2<U>() const {
@@ -378,7 +395,7 @@ namespace sr {
 
         Point2<T> operator+=(const Vector2<T> &v) {
             x += v.x;
-            y + v.y;
+            y += v.y;
             return *this;
         }
 
@@ -414,11 +431,11 @@ namespace sr {
 
         Point3() : x(0), y(0), z(0) {}
 
-        Point3(T _x, T _y, T _z) : x(_x), y(_y), z(_z) { assert(!HasNans()); }
+        Point3(T _x, T _y, T _z) : x(_x), y(_y), z(_z) { SR_VALIDATE(!HasNans()); }
 
         //avoid implicit conversion from point<U> to point<T>
         template<typename U>
-        explicit Point3(const Point3<U> &p): x((T) p.x), y((T) p.y), z((T) p.z) { assert(!HasNans()); }
+        explicit Point3(const Point3<U> &p): x((T) p.x), y((T) p.y), z((T) p.z) { SR_VALIDATE(!HasNans()); }
 
         //avoid implicit conversion like: point = Vector3
         template<typename U>
@@ -621,11 +638,11 @@ namespace sr {
         Normal3() = default;
 
         Normal3(T _x, T _y, T _z) : x(_x), y(_y), z(_z) {
-            assert(!HasNans());
+            SR_VALIDATE(!HasNans());
         }
 
         explicit Normal3<T>(const Vector3<T> &v) : x(v.x), y(v.y), z(v.z) {
-            assert(!v.HasNans());
+            SR_VALIDATE(!v.HasNans());
         }
 
         T operator[](std::size_t i) const {
@@ -810,9 +827,45 @@ namespace sr {
         }
     };
 
-    //todo
-    class RayDifferentials : Ray {
+    //ray with two offset rays one pixel apart in x and y on the film, used to estimate texture footprints
+    class RayDifferentials : public Ray {
+    public:
+        bool hasDifferentials;
+        Point3f rxOrigin, ryOrigin;
+        Vector3f rxDirection, ryDirection;
+
+        RayDifferentials() : hasDifferentials(false) {}
+
+        RayDifferentials(const Point3f &o, const Vector3f &d, Float tMax = Infinity, Float time = 0.f,
+                         const Medium *medium = nullptr) : Ray(o, d, tMax, time, medium), hasDifferentials(false) {}
+
+        RayDifferentials(const Ray &ray) : Ray(ray), hasDifferentials(false) {}
+
+        //spacing of s pixels, for s samples per pixel use 1 / sqrt(s)
+        void ScaleDifferentials(Float s) {
+            rxOrigin = o + (rxOrigin - o) * s;
+            ryOrigin = o + (ryOrigin - o) * s;
+            rxDirection = d + (rxDirection - d) * s;
+            ryDirection = d + (ryDirection - d) * s;
+        }
+    };
+
+    //ray cone: footprint width grows by spreadAngle per unit distance.
+    //Two floats per ray instead of four vectors, cheap enough to carry through every bounce
+    class RayCone {
+    public:
+        Float width, spreadAngle;
+
+        RayCone() : width(0), spreadAngle(0) {}
 
+        RayCone(Float width, Float spreadAngle) : width(width), spreadAngle(spreadAngle) {}
+
+        Float WidthAt(Float t) const { return width + spreadAngle * t; }
+
+        //cone leaving a hit at distance t, surfaceSpread is the extra spread added by curvature or roughness
+        RayCone Propagate(Float t, Float surfaceSpread = 0) const {
+            return RayCone(WidthAt(t), spreadAngle + surfaceSpread);
+        }
     };
 
 /**************************************************class bound*********************************************************/
@@ -871,8 +924,13 @@ namespace sr {
         }
 
         void BoundingSphere(Point2<T> *center, Float *radius) const {
-            *center = (pMin + pMax) / 2;
-            *radius = Inside(*this, *center) ? Distance(*center, *pMax) : 0;
+            *center = pMin + (pMax - pMin) * T(0.5);
+            *radius = Inside(*this, *center) ? Distance(*center, pMax) : 0;
+        }
+
+        template<typename U>
+        explicit operator Bounds2<U>() const {
+            return Bounds2<U>((Point2<U>) pMin, (Point2<U>) pMax);
         }
 
         bool operator==(const Bounds2<T> &b) const {
@@ -947,8 +1005,8 @@ namespace sr {
         }
 
         void BoundingSphere(Point3<T> *center, Float *radius) const {
-            *center = (pMin + pMax) / 2;
-            *radius = Inside(*this, *center) ? Distance(*center, *pMax) : 0;
+            *center = pMin + (pMax - pMin) * T(0.5);
+            *radius = Inside(*this, *center) ? Distance(*center, pMax) : 0;
         }
 
         bool operator==(const Bounds3<T> &b) const {
@@ -959,7 +1017,24 @@ namespace sr {
             return pMin != b.pMin || pMax != b.pMax;
         }
 
-        inline bool IntersectP(const Ray &ray, Float *hitt0, Float *hitt1) const;
+        //parametric range of ray inside the box, clipped to [0, ray.tMax]
+        bool IntersectP(const Ray &ray, Float *hitt0, Float *hitt1) const {
+            Float t0 = 0, t1 = ray.tMax;
+            for (int i = 0; i < 3; ++i) {
+                Float invd = 1 / ray.d[i]; //d[i] is zero also ok.
+                Float tNear = (pMin[i] - ray.o[i]) * invd; //may be NAN
+                Float tFar = (pMax[i] - ray.o[i]) * invd;
+
+                //any condition contains NAN is always false
+                if (tNear > tFar) std::swap(tNear, tFar);
+                t0 = tNear > t0 ? tNear : t0;
+                t1 = tFar < t1 ? tFar : t1;
+                if (t0 > t1) return false;
+            }
+            if (hitt0) *hitt0 = t0;
+            if (hitt1) *hitt1 = t1;
+            return true;
+        }
 
         inline bool IntersectP(const Ray &ray, const Vector3f &invDir, const int dirIsNeg[3]) const;
     };
@@ -1006,6 +1081,23 @@ namespace sr {
         return Bounds3<T>(Min(b1.pMin, b2.pMin), Max(b1.pMax, b2.pMax));
     }
 
+    //pMin and pMax are set directly, an empty intersection must not be reordered into a valid box
+    template<typename T>
+    inline Bounds2<T> Intersect(const Bounds2<T> &b1, const Bounds2<T> &b2) {
+        Bounds2<T> res;
+        res.pMin = Max(b1.pMin, b2.pMin);
+        res.pMax = Min(b1.pMax, b2.pMax);
+        return res;
+    }
+
+    template<typename T>
+    inline Bounds3<T> Intersect(const Bounds3<T> &b1, const Bounds3<T> &b2) {
+        Bounds3<T> res;
+        res.pMin = Max(b1.pMin, b2.pMin);
+        res.pMax = Min(b1.pMax, b2.pMax);
+        return res;
+    }
+
     template<typename T>
     bool Overlaps(const Bounds2<T> &b1, const Bounds2<T> &b2) {
         bool x = (b1.pMax.x >= b2.pMin.x) && (b1.pMin.x <= b2.pMax.x);
@@ -1172,6 +1264,168 @@ namespace sr {
         return Bounds3iIterator(b, pEnd);
     }
 
+/****************************************************curve order iterator********************************************/
+
+    //Orders that keep consecutive points close together, for tiles of an image or pixels inside a tile:
+    //Morton is the Z-order curve, Hilbert never jumps between neighbours,
+    //Spiral starts at the center and walks outwards ring by ring so the middle of the image is ready first.
+    enum class CurveOrder {
+        Morton, Hilbert, Spiral
+    };
+
+    //Visits every point of a Bounds2i along a CurveOrder.
+    //The curve indexes a covering grid and indices outside the bounds are skipped. Morton and Hilbert tile the
+    //bounds with 2^k squares along the longer axis (at most 4x the area), Spiral covers the smallest centered
+    //square.
+    class Bounds2iCurveIterator : public std::forward_iterator_tag {
+    public:
+        Bounds2iCurveIterator(const Bounds2i &b, CurveOrder order, bool atEnd) : bounds(&b), order(order) {
+            Vector2i extent = b.Diagonal();
+            if (isCollapse(b)) {
+                count = index = 0;
+                return;
+            }
+            if (order == CurveOrder::Spiral) {
+                center = Point2i(b.pMin.x + (extent.x - 1) / 2, b.pMin.y + (extent.y - 1) / 2);
+                int r = std::max(std::max(center.x - b.pMin.x, b.pMax.x - 1 - center.x),
+                                 std::max(center.y - b.pMin.y, b.pMax.y - 1 - center.y));
+                count = uint64_t(2 * r + 1) * uint64_t(2 * r + 1);
+            } else {
+                int log2X = Log2Int(RoundUpPow2(extent.x)), log2Y = Log2Int(RoundUpPow2(extent.y));
+                log2Side = std::min(log2X, log2Y);
+                xMajor = log2X >= log2Y;
+                count = uint64_t(1) << (log2X + log2Y);
+            }
+            index = 0;
+            if (atEnd) {
+                index = count;
+            } else {
+                p = PointAt(0);
+                if (!InsideExclusive(*bounds, p)) advance();
+            }
+        }
+
+        Bounds2iCurveIterator operator++() {
+            advance();
+            return *this;
+        }
+
+        Bounds2iCurveIterator operator++(int) {
+            auto old = *this;
+            advance();
+            return old;
+        }
+
+        bool operator==(const Bounds2iCurveIterator &bi) const {
+            return index == bi.index && bounds == bi.bounds;
+        }
+
+        bool operator!=(const Bounds2iCurveIterator &bi) const {
+            return index != bi.index || bounds != bi.bounds;
+        }
+
+        Point2i operator*() const { return p; }
+
+    private:
+        const Bounds2i *bounds;
+        CurveOrder order;
+        uint64_t index, count;
+        Point2i p, center;
+        int log2Side = 0;
+        bool xMajor = true;
+
+        void advance() {
+            while (++index < count) {
+                p = PointAt(index);
+                if (InsideExclusive(*bounds, p)) return;
+            }
+        }
+
+        Point2i PointAt(uint64_t i) const {
+            if (order == CurveOrder::Spiral) return SpiralPoint(i);
+
+            //the curve fills one 2^log2Side square after the other along the longer axis
+            uint64_t block = i >> (2 * log2Side);
+            uint64_t local = i & ((uint64_t(1) << (2 * log2Side)) - 1);
+            int u, v;
+            if (order == CurveOrder::Morton) {
+                MortonDecode(local, &u, &v);
+            } else {
+                HilbertDecode(local, &u, &v);
+            }
+            //a hilbert square ends on the corner next to the following block if u runs along the long axis
+            int blockOffset = int(block << log2Side);
+            if (xMajor) return Point2i(bounds->pMin.x + blockOffset + u, bounds->pMin.y + v);
+            return Point2i(bounds->pMin.x + v, bounds->pMin.y + blockOffset + u);
+        }
+
+        static void MortonDecode(uint64_t i, int *u, int *v) {
+            *u = *v = 0;
+            for (int bit = 0; i; ++bit, i >>= 2) {
+                *u |= int(i & 1) << bit;
+                *v |= int((i >> 1) & 1) << bit;
+            }
+        }
+
+        void HilbertDecode(uint64_t i, int *u, int *v) const {
+            *u = *v = 0;
+            for (int s = 1; s < (1 << log2Side); s *= 2, i /= 4) {
+                int ru = int(1 & (i / 2));
+                int rv = int(1 & (i ^ uint64_t(ru)));
+                //rotate the sub-square
+                if (rv == 0) {
+                    if (ru == 1) {
+                        *u = s - 1 - *u;
+                        *v = s - 1 - *v;
+                    }
+                    std::swap(*u, *v);
+                }
+                *u += s * ru;
+                *v += s * rv;
+            }
+        }
+
+        //ring r > 0 starts at index (2r - 1)^2 and has 8r points, walked counterclockwise from the right edge
+        Point2i SpiralPoint(uint64_t i) const {
+            if (i == 0) return center;
+            int r = int((std::sqrt(double(i)) + 1) / 2);
+            while (uint64_t(2 * r - 1) * uint64_t(2 * r - 1) > i) --r;
+            while (uint64_t(2 * r + 1) * uint64_t(2 * r + 1) <= i) ++r;
+            int k = int(i - uint64_t(2 * r - 1) * uint64_t(2 * r - 1));
+            int side = k / (2 * r), pos = k % (2 * r);
+            switch (side) {
+                case 0:
+                    return Point2i(center.x + r, center.y - r + 1 + pos);
+                case 1:
+                    return Point2i(center.x + r - 1 - pos, center.y + r);
+                case 2:
+                    return Point2i(center.x - r, center.y + r - 1 - pos);
+                default:
+                    return Point2i(center.x - r + 1 + pos, center.y - r);
+            }
+        }
+    };
+
+    //range for adaptor: for (Point2i p : HilbertOrder(bounds)) {...}
+    class Bounds2iCurve {
+    public:
+        Bounds2iCurve(const Bounds2i &b, CurveOrder order) : bounds(b), order(order) {}
+
+        Bounds2iCurveIterator begin() const { return Bounds2iCurveIterator(bounds, order, false); }
+
+        Bounds2iCurveIterator end() const { return Bounds2iCurveIterator(bounds, order, true); }
+
+    private:
+        Bounds2i bounds;
+        CurveOrder order;
+    };
+
+    inline Bounds2iCurve MortonOrder(const Bounds2i &b) { return Bounds2iCurve(b, CurveOrder::Morton); }
+
+    inline Bounds2iCurve HilbertOrder(const Bounds2i &b) { return Bounds2iCurve(b, CurveOrder::Hilbert); }
+
+    inline Bounds2iCurve SpiralOrder(const Bounds2i &b) { return Bounds2iCurve(b, CurveOrder::Spiral); }
+
 /****************************************************geometry inline functions*****************************************/
 
     inline Vector3f SphericalDirection(Float sinTheta, Float cosTheta, Float phi){
@@ -1182,6 +1436,20 @@ namespace sr {
         return sinTheta * std::cos(phi) * x + sinTheta * std::sin(phi) * y + cosTheta * z;
     }
 
+    //moves p out of its error box along n, to the side w points to, so spawned rays do not hit the surface again
+    inline Point3f OffsetRayOrigin(const Point3f &p, const Vector3f &pError, const Normal3f &n, const Vector3f &w) {
+        Float d = std::abs(n.x) * pError.x + std::abs(n.y) * pError.y + std::abs(n.z) * pError.z;
+        Vector3f offset = d * Vector3f(n);
+        if (Dot(w, n) < 0) offset = -offset;
+        Point3f po = p + offset;
+        //round away from p so the offset survives the addition
+        for (int i = 0; i < 3; ++i) {
+            if (offset[i] > 0) po[i] = std::nextafter(po[i], Infinity);
+            else if (offset[i] < 0) po[i] = std::nextafter(po[i], -Infinity);
+        }
+        return po;
+    }
+
     inline Float SphericalTheta(const Vector3f& v){
         return std::acos(Clamp(v.z, -1, 1));
     }
@@ -0,0 +1,64 @@
+//
+// Created by 18310 on 2021/5/7.
+//
+
+#ifndef SIMPLERENDERER_GRID_H
+#define SIMPLERENDERER_GRID_H
+
+#include "medium.h"
+#include "transform.h"
+#include <memory>
+#include <vector>
+
+namespace sr {
+    //Density grid over the medium space box [0, 1]^3, scaled by sigma_a and sigma_s.
+    //Free flights are sampled with delta tracking and transmittance with ratio tracking, both against a coarse
+    //grid of per cell majorants walked with a 3D DDA: empty cells are skipped without a single collision and thin
+    //ones take steps as long as their own bound allows. majorantRes = 1 is a single global majorant.
+    //sigma_t must be gray, only its first channel is used.
+    class GridDensityMedium : public Medium {
+    public:
+        GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g, int nx, int ny, int nz,
+                          const Transform &mediumToWorld, const Float *d, int majorantRes = 16);
+
+        Spectrum Tr(const Ray &ray, Sampler &sampler) const override;
+
+        Spectrum Sample(const Ray &ray, Sampler &sampler, MediumInteraction *mi) const override;
+
+        //density at the medium space point p, trilinear between voxel centers and zero outside the grid
+        virtual Float Density(const Point3f &p) const;
+
+        //upper bound of Density over the medium space box b
+        virtual Float MaxDensity(const Bounds3f &b) const;
+
+    protected:
+        //for derived media that store their own density, they call BuildMajorantGrid once it is set
+        GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g, const Transform &mediumToWorld);
+
+        //res^3 cells of sigma_t * MaxDensity
+        void BuildMajorantGrid(int res);
+
+        Float D(const Point3i &p) const {
+            if (p.x < 0 || p.x >= nx || p.y < 0 || p.y >= ny || p.z < 0 || p.z >= nz) return 0;
+            return density[(p.z * ny + p.y) * nx + p.x];
+        }
+
+        const Spectrum sigma_a, sigma_s;
+        const Float sigma_t;
+        const HenyeyGreenstein phase;
+        const Transform WorldToMedium;
+        int nx = 0, ny = 0, nz = 0;
+        std::unique_ptr<Float[]> density;
+
+    private:
+        //calls f(t0, t1, sigma_maj) for the majorant cells along the medium space ray in order,
+        //f returns false to stop
+        template<typename F>
+        void TraverseMajorants(const Ray &ray, Float tMin, Float tMax, F f) const;
+
+        int majorantRes = 0;
+        std::vector<Float> majorants;
+    };
+}
+
+#endif //SIMPLERENDERER_GRID_H
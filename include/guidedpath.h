@@ -0,0 +1,84 @@
+//
+// Created by 18310 on 2021/5/10.
+//
+
+#ifndef SIMPLERENDERER_GUIDEDPATH_H
+#define SIMPLERENDERER_GUIDEDPATH_H
+
+#include "sr.h"
+#include "camera.h"
+#include "lightsampler.h"
+#include "progressive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "sdtree.h"
+#include <memory>
+
+namespace sr {
+
+    struct GuidedPathOptions {
+        int maxDepth = 8;
+        //false renders a plain path tracer with the same light sampling, for comparisons
+        bool guiding = true;
+        //share of directions drawn from the material at guided vertices
+        Float bsdfSamplingFraction = 0.5f;
+        //a spatial leaf splits above spatialThreshold * sqrt(2^k) samples after k training iterations
+        int64_t spatialThreshold = 12000;
+        //a directional quadrant subdivides above this share of its tree's energy
+        Float directionalThreshold = 0.01f;
+        //how the light for next event estimation is chosen
+        LightSampling lightSampling = LightSampling::Power;
+        //spectrum type the paths are traced with, SampleFunc dispatches to the kernel built for it
+        SpectrumRepresentation spectrum = SpectrumRepresentation::RGB;
+    };
+
+    template<typename SpectrumT>
+    struct GuidedPathKernel;
+
+    //Path tracer guided by a spatial-directional tree learned while it renders (Müller et al. 2017).
+    //Every diffuse vertex looks up the STree leaf around it and draws its next direction from the leaf's
+    //quadtree or the material, weighted by one sample MIS of both densities. The incident radiance found
+    //along every direction is splatted into the leaf's building tree with lock-free atomic adds, and between
+    //progressive passes, after 1, 2, 4, ... samples per pixel, the trees are refined and swapped in.
+    //Samples of every pass, including the early poorly guided ones, stay in the film. Paths are traced in
+    //options.spectrum, each representation with its own instantiation of the kernel.
+    class GuidedPathIntegrator {
+    public:
+        //sampler is a prototype cloned per thread
+        GuidedPathIntegrator(std::shared_ptr<const Camera> camera, std::unique_ptr<Sampler> sampler,
+                             const GuidedPathOptions &options);
+
+        //renders into the camera's film under the budgets of progressive, returns the completed passes
+        int Render(const Scene &scene, const ProgressiveOptions &progressive);
+
+        //sets up light sampling and an empty guiding tree for scene, Render calls it
+        void Preprocess(const Scene &scene);
+
+        //per sample work of Render for callers that schedule tiles themselves, valid after Preprocess.
+        //Trees are only refined by Render, so without it guiding has nothing to sample from.
+        PixelSampleFunc SampleFunc(const Scene &scene) const;
+
+        //training iterations finished by the last Render
+        int TrainingIterations() const { return iteration; }
+
+        std::size_t LeafCount() const { return sdTree ? sdTree->LeafCount() : 0; }
+
+    private:
+        template<typename SpectrumT>
+        friend struct GuidedPathKernel;
+
+        //cone is the camera footprint, used past the first hit where ray has no differentials left
+        template<typename SpectrumT>
+        SpectrumT Li(RayDifferentials ray, RayCone cone, const Scene &scene, Sampler &sampler,
+                     MemoryArena &arena) const;
+
+        std::shared_ptr<const Camera> camera;
+        std::unique_ptr<Sampler> samplerPrototype;
+        const GuidedPathOptions options;
+        std::unique_ptr<LightSampler> lightSampler;
+        std::unique_ptr<STree> sdTree;
+        int iteration = 0;
+    };
+}
+
+#endif //SIMPLERENDERER_GUIDEDPATH_H
@@ -0,0 +1,32 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#ifndef SIMPLERENDERER_HALTON_H
+#define SIMPLERENDERER_HALTON_H
+
+#include "sampler.h"
+#include <vector>
+
+namespace sr {
+    //Halton sequence with random digit permutations for every prime base, built once from the seed and
+    //shared by clones. Pixels are decorrelated by starting at a hashed offset into the sequence.
+    class HaltonSampler : public Sampler {
+    public:
+        HaltonSampler(int64_t samplesPerPixel, uint32_t seed = 0);
+
+        Float Get1D() override;
+
+        Point2f Get2D() override;
+
+        std::unique_ptr<Sampler> Clone() const override;
+
+    private:
+        Float SampleDimension(int dim) const;
+
+        //digit permutation of base Primes[i] starts at PrimeSum(i)
+        std::shared_ptr<const std::vector<uint16_t>> permutations;
+    };
+}
+
+#endif //SIMPLERENDERER_HALTON_H
@@ -0,0 +1,30 @@
+//
+// Created by 18310 on 2021/5/6.
+//
+
+#ifndef SIMPLERENDERER_HOMOGENEOUS_H
+#define SIMPLERENDERER_HOMOGENEOUS_H
+
+#include "medium.h"
+
+namespace sr {
+    //constant coefficients everywhere, transmittance and free flight sampling are closed form
+    class HomogeneousMedium : public Medium {
+    public:
+        HomogeneousMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g) : sigma_a(sigma_a),
+                                                                                       sigma_s(sigma_s),
+                                                                                       sigma_t(sigma_a + sigma_s),
+                                                                                       phase(g) {}
+
+        Spectrum Tr(const Ray &ray, Sampler &sampler) const override;
+
+        Spectrum Sample(const Ray &ray, Sampler &sampler, MediumInteraction *mi) const override;
+
+    private:
+        const Spectrum sigma_a, sigma_s, sigma_t;
+        //shared by every interaction of this medium
+        const HenyeyGreenstein phase;
+    };
+}
+
+#endif //SIMPLERENDERER_HOMOGENEOUS_H
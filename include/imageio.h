@@ -0,0 +1,22 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#ifndef SIMPLERENDERER_IMAGEIO_H
+#define SIMPLERENDERER_IMAGEIO_H
+
+#include "sr.h"
+#include "geometry.h"
+#include <memory>
+
+namespace sr {
+    //rgb holds 3 floats per pixel, row major with the top row first
+    //the format follows the extension: .pfm keeps floats, .ppm is clamped and sRGB encoded to 8 bits
+    //returns false and prints the reason to std::cerr on failure
+    bool WriteImage(const std::string &name, const Float *rgb, const Point2i &resolution);
+
+    //reads a .pfm, returns nullptr on failure
+    std::unique_ptr<Float[]> ReadImage(const std::string &name, Point2i *resolution);
+}
+
+#endif //SIMPLERENDERER_IMAGEIO_H
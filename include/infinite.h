@@ -0,0 +1,50 @@
+//
+// Created by 18310 on 2021/5/1.
+//
+
+#ifndef SIMPLERENDERER_INFINITE_H
+#define SIMPLERENDERER_INFINITE_H
+
+#include "light.h"
+#include "sampling.h"
+#include <memory>
+#include <vector>
+
+namespace sr {
+    //Environment light from an equirectangular .pfm: u follows phi, v follows theta from light space +z.
+    //The map is piecewise constant per texel and sampled in proportion to texel luminance times sin(theta),
+    //so the pdf matches the radiance exactly up to color.
+    class InfiniteAreaLight : public Light {
+    public:
+        //without a readable map the light is the constant L.
+        //importanceSample false samples directions uniformly over the sphere instead, for comparisons
+        InfiniteAreaLight(const Transform &LightToWorld, const Spectrum &L, int nSamples, const std::string &texmap,
+                          bool importanceSample = true);
+
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           VisibilityTester *vis) const override;
+
+        Float Pdf_Li(const Interaction &ref, const Vector3f &wi) const override;
+
+        Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time, Ray *ray, Normal3f *nLight,
+                           Float *pdfPos, Float *pdfDir) const override;
+
+        Spectrum Power() const override;
+
+        Spectrum Le(const RayDifferentials &r) const override;
+
+        void Preprocess(const Bounds3f &sceneBounds) override;
+
+    private:
+        //st in [0, 1]²
+        Spectrum Lookup(const Point2f &st) const;
+
+        Point2i resolution;
+        std::vector<Spectrum> Lmap;
+        std::unique_ptr<Distribution2D> distribution;
+        Point3f worldCenter;
+        Float worldRadius = 1e5f;
+    };
+}
+
+#endif //SIMPLERENDERER_INFINITE_H
@@ -20,7 +20,32 @@ namespace sr {
                     const MediumInterface &mediumInterface) :
                 p(p), time(time), pError(pError), wo(wo), n(n), mediumInterface(mediumInterface) {}
 
-        bool IsSurfaceInteraction() const { return n == Normal3f(); }
+        Interaction(const Point3f &p, Float time, const MediumInterface &mediumInterface) :
+                p(p), time(time), n(Normal3f()), mediumInterface(mediumInterface) {}
+
+        bool IsSurfaceInteraction() const { return n != Normal3f(); }
+
+        bool IsMediumInteraction() const { return !IsSurfaceInteraction(); }
+
+        //medium a ray leaving in direction w travels through
+        const Medium *GetMedium(const Vector3f &w) const {
+            if (IsSurfaceInteraction()) return Dot(w, n) > 0 ? mediumInterface.outside : mediumInterface.inside;
+            return mediumInterface.inside;
+        }
+
+        //medium of an interaction that is not on a transition surface
+        const Medium *GetMedium() const {
+            assert(mediumInterface.inside == mediumInterface.outside);
+            return mediumInterface.inside;
+        }
+
+        //rays leaving the interaction, origins are offset past pError and carry the medium on their side
+        Ray SpawnRay(const Vector3f &d) const;
+
+        //tMax stops just short of p2
+        Ray SpawnRayTo(const Point3f &p2) const;
+
+        Ray SpawnRayTo(const Interaction &it) const;
 
         Point3f p;
         Float time;
@@ -32,6 +57,45 @@ namespace sr {
         MediumInterface mediumInterface;
     };
 
+    //scattering point inside a medium, the normal stays zero
+    class MediumInteraction : public Interaction {
+    public:
+        MediumInteraction() : phase(nullptr) {}
+
+        MediumInteraction(const Point3f &p, const Vector3f &wo, Float time, const Medium *medium,
+                          const PhaseFunction *phase) : Interaction(p, time, medium), phase(phase) {
+            this->wo = wo;
+            pError = Vector3f(0, 0, 0);
+        }
+
+        //false when Medium::Sample did not scatter
+        bool IsValid() const { return phase != nullptr; }
+
+        const PhaseFunction *phase;
+    };
+
+    //orthonormal shading frame, materials evaluating in local coordinates only need this to convert directions
+    class ShadingFrame {
+    public:
+        ShadingFrame() {}
+
+        //s is projected onto the plane of n
+        ShadingFrame(const Vector3f &dir, const Normal3f &normal) : n(Normalize(normal)) {
+            Vector3f nv(n);
+            s = dir - Dot(dir, nv) * nv;
+            if (s.LengthSquared() == 0) CoordinateSystem(nv, &s, &t);
+            s = Normalize(s);
+            t = Cross(nv, s);
+        }
+
+        Vector3f ToLocal(const Vector3f &v) const { return Vector3f(Dot(v, s), Dot(v, t), Dot(v, n)); }
+
+        Vector3f FromLocal(const Vector3f &v) const { return v.x * s + v.y * t + v.z * Vector3f(n); }
+
+        Vector3f s, t;
+        Normal3f n;
+    };
+
     class SurfaceInteraction : public Interaction {
     public:
         Point2f uv;
@@ -52,6 +116,22 @@ namespace sr {
         } shading;
 
         void SetShadingGeometry(const Vector3f& dpdus, const Vector3f& dpdvs, const Normal3f& dndus, const Normal3f& dndvs, bool orientationIsAuthoritative);
+
+        //screen space derivatives of p and uv, zero when the ray carried no footprint
+        mutable Vector3f dpdx, dpdy;
+        mutable Float dudx = 0, dvdx = 0, dudy = 0, dvdy = 0;
+
+        void ComputeDifferentials(const RayDifferentials &ray) const;
+
+        //cone footprint for rays without differentials, tHit is the distance travelled by the cone
+        void ComputeDifferentials(const RayCone &cone, const Vector3f &d, Float tHit) const;
+
+        //mip level of a pyramid with nLevels levels, 0 is the finest, not clamped
+        Float MIPLevel(int nLevels) const;
+
+    private:
+        //uv derivatives from dpdx and dpdy
+        void ComputeUVDifferentials() const;
     };
 }
 #endif //SIMPLERENDERER_INTERACTION_H
@@ -0,0 +1,121 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#ifndef SIMPLERENDERER_LIGHT_H
+#define SIMPLERENDERER_LIGHT_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "transform.h"
+#include "spectrum.h"
+#include "interaction.h"
+
+namespace sr {
+    class Scene;
+
+    enum class LightFlags : int {
+        DeltaPosition = 1, DeltaDirection = 2, Area = 4, Infinite = 8
+    };
+
+    inline bool IsDeltaLight(int flags) {
+        return flags & (int) LightFlags::DeltaPosition || flags & (int) LightFlags::DeltaDirection;
+    }
+
+    //the segment a shadow ray has to test
+    class VisibilityTester {
+    public:
+        VisibilityTester() {}
+
+        VisibilityTester(const Interaction &p0, const Interaction &p1) : p0(p0), p1(p1) {}
+
+        const Interaction &P0() const { return p0; }
+
+        const Interaction &P1() const { return p1; }
+
+        bool Unoccluded(const Scene &scene) const;
+
+    private:
+        Interaction p0, p1;
+    };
+
+    //cone of directions around w, cosTheta = -1 is the whole sphere
+    struct DirectionCone {
+        Vector3f w;
+        Float cosTheta = Infinity;
+
+        DirectionCone() {}
+
+        DirectionCone(const Vector3f &w, Float cosTheta) : w(Normalize(w)), cosTheta(cosTheta) {}
+
+        bool IsEmpty() const { return cosTheta == Infinity; }
+
+        static DirectionCone EntireSphere() { return DirectionCone(Vector3f(0, 0, 1), -1); }
+    };
+
+    DirectionCone Union(const DirectionCone &a, const DirectionCone &b);
+
+    //spatial and directional emission bounds of a light or a group of lights, used by BVHLightSampler.
+    //Emission leaves around w within theta_o, and falls off to zero by theta_o + theta_e
+    struct LightBounds {
+        Bounds3f bounds;
+        //emitted power bound
+        Float phi = 0;
+        Vector3f w;
+        Float cosTheta_o = 1, cosTheta_e = 1;
+        bool twoSided = false;
+
+        LightBounds() {}
+
+        LightBounds(const Bounds3f &bounds, const Vector3f &w, Float phi, Float cosTheta_o, Float cosTheta_e,
+                    bool twoSided) : bounds(bounds), phi(phi), w(Normalize(w)), cosTheta_o(cosTheta_o),
+                                     cosTheta_e(cosTheta_e), twoSided(twoSided) {}
+
+        Point3f Centroid() const { return bounds.pMin + bounds.Diagonal() * Float(0.5); }
+
+        //conservative estimate of the light reaching p, n is the zero normal off surfaces
+        Float Importance(const Point3f &p, const Normal3f &n) const;
+    };
+
+    LightBounds Union(const LightBounds &a, const LightBounds &b);
+
+    class Light {
+    public:
+        Light(int flags, const Transform &LightToWorld, const MediumInterface &mediumInterface, int nSamples = 1);
+
+        virtual ~Light();
+
+        //incident radiance at ref from the direction *wi, *pdf is with respect to solid angle
+        virtual Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                   VisibilityTester *vis) const = 0;
+
+        virtual Float Pdf_Li(const Interaction &ref, const Vector3f &wi) const = 0;
+
+        //Ray leaving the light, for tracing from the light side. nLight is the normal at the ray origin,
+        //ray->d for lights without a surface. pdfPos is over area and pdfDir over solid angle, a delta
+        //distribution contributes a factor of 1.
+        virtual Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time, Ray *ray, Normal3f *nLight,
+                                   Float *pdfPos, Float *pdfDir) const = 0;
+
+        //total emitted power
+        virtual Spectrum Power() const = 0;
+
+        //radiance of rays escaping the scene, only infinite lights emit it
+        virtual Spectrum Le(const RayDifferentials &/*r*/) const { return Spectrum(0.f); }
+
+        //false for lights without finite bounds, which BVHLightSampler samples separately
+        virtual bool Bounds(LightBounds */*bounds*/) const { return false; }
+
+        //called once the scene extent is known, before rendering
+        virtual void Preprocess(const Bounds3f &/*sceneBounds*/) {}
+
+        const int flags;
+        const int nSamples;
+        const MediumInterface mediumInterface;
+
+    protected:
+        const Transform LightToWorld, WorldToLight;
+    };
+}
+
+#endif //SIMPLERENDERER_LIGHT_H
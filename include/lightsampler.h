@@ -0,0 +1,96 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#ifndef SIMPLERENDERER_LIGHTSAMPLER_H
+#define SIMPLERENDERER_LIGHTSAMPLER_H
+
+#include "light.h"
+#include "sampling.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace sr {
+
+    //chooses one light for a shading point
+    class LightSampler {
+    public:
+        virtual ~LightSampler();
+
+        //nullptr when no light can contribute at ref
+        virtual const Light *Sample(const Interaction &ref, Float u, Float *pmf) const = 0;
+
+        //probability that Sample(ref, ...) returns light
+        virtual Float PMF(const Interaction &ref, const Light *light) const = 0;
+    };
+
+    class UniformLightSampler : public LightSampler {
+    public:
+        explicit UniformLightSampler(const std::vector<std::shared_ptr<Light>> &lights) : lights(lights) {}
+
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+
+        Float PMF(const Interaction &ref, const Light *light) const override;
+
+    private:
+        std::vector<std::shared_ptr<Light>> lights;
+    };
+
+    //independent of the shading point, proportional to Power().y()
+    class PowerLightSampler : public LightSampler {
+    public:
+        explicit PowerLightSampler(const std::vector<std::shared_ptr<Light>> &lights);
+
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+
+        Float PMF(const Interaction &ref, const Light *light) const override;
+
+    private:
+        std::vector<std::shared_ptr<Light>> lights;
+        AliasTable aliasTable;
+        std::unordered_map<const Light *, int> lightToIndex;
+    };
+
+    //Bounding volume hierarchy over the lights' LightBounds, traversed by choosing a child in proportion
+    //to its importance at the shading point: O(log n) per sample, and far or back facing groups are rarely picked.
+    //Lights without bounds are chosen uniformly with probability nInfinite / (nInfinite + 1).
+    class BVHLightSampler : public LightSampler {
+    public:
+        explicit BVHLightSampler(const std::vector<std::shared_ptr<Light>> &lights);
+
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+
+        Float PMF(const Interaction &ref, const Light *light) const override;
+
+    private:
+        struct Node {
+            LightBounds lightBounds;
+            //interior: second child, the first one follows the node. leaf: index into boundedLights
+            int childOrLightIndex;
+            bool isLeaf;
+        };
+
+        //appends the subtree of bvhLights[start, end) and returns its bounds
+        LightBounds Build(std::vector<std::pair<int, LightBounds>> &bvhLights, int start, int end,
+                          uint64_t bitTrail, int depth);
+
+        Float InfiniteProbability() const {
+            return Float(infiniteLights.size()) / Float(infiniteLights.size() + (nodes.empty() ? 0 : 1));
+        }
+
+        std::vector<std::shared_ptr<Light>> boundedLights, infiniteLights;
+        std::vector<Node> nodes;
+        //path from the root to every bounded light, bit i set means child 1 at depth i
+        std::unordered_map<const Light *, uint64_t> lightToBitTrail;
+    };
+
+    enum class LightSampling {
+        Uniform, Power, BVH
+    };
+
+    std::unique_ptr<LightSampler> CreateLightSampler(LightSampling sampling,
+                                                     const std::vector<std::shared_ptr<Light>> &lights);
+}
+
+#endif //SIMPLERENDERER_LIGHTSAMPLER_H
@@ -0,0 +1,200 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#ifndef SIMPLERENDERER_LOWDISCREPANCY_H
+#define SIMPLERENDERER_LOWDISCREPANCY_H
+
+#include "sr.h"
+
+namespace sr {
+
+/*****************************************************hashing**********************************************************/
+
+    //64 bit finalizer, turns structured input into independent looking bits
+    inline uint64_t MixBits(uint64_t v) {
+        v ^= (v >> 31);
+        v *= 0x7fb5d329728ea185ull;
+        v ^= (v >> 27);
+        v *= 0x81dadef4bc2dd44dull;
+        v ^= (v >> 33);
+        return v;
+    }
+
+    inline uint64_t Hash(uint64_t a, uint64_t b, uint64_t c = 0) {
+        return MixBits(a ^ MixBits(b ^ MixBits(c)));
+    }
+
+    inline uint32_t ReverseBits32(uint32_t n) {
+        n = (n << 16) | (n >> 16);
+        n = ((n & 0x00ff00ff) << 8) | ((n & 0xff00ff00) >> 8);
+        n = ((n & 0x0f0f0f0f) << 4) | ((n & 0xf0f0f0f0) >> 4);
+        n = ((n & 0x33333333) << 2) | ((n & 0xcccccccc) >> 2);
+        n = ((n & 0x55555555) << 1) | ((n & 0xaaaaaaaa) >> 1);
+        return n;
+    }
+
+    //i-th element of a pseudo-random permutation of [0, l) selected by p, O(1) expected (Kensler 2013)
+    inline uint32_t PermutationElement(uint32_t i, uint32_t l, uint32_t p) {
+        uint32_t w = l - 1;
+        w |= w >> 1;
+        w |= w >> 2;
+        w |= w >> 4;
+        w |= w >> 8;
+        w |= w >> 16;
+        do {
+            i ^= p;
+            i *= 0xe170893d;
+            i ^= p >> 16;
+            i ^= (i & w) >> 4;
+            i ^= p >> 8;
+            i *= 0x0929eb3f;
+            i ^= p >> 23;
+            i ^= (i & w) >> 1;
+            i *= 1 | p >> 27;
+            i *= 0x6935fa69;
+            i ^= (i & w) >> 11;
+            i *= 0x74dcb303;
+            i ^= (i & w) >> 2;
+            i *= 0x9e501cc3;
+            i ^= (i & w) >> 2;
+            i *= 0xc860a3df;
+            i &= w;
+            i ^= i >> 5;
+        } while (i >= l);
+        return (i + p) % l;
+    }
+
+    inline Float UInt32ToFloat(uint32_t v) {
+        return std::min(Float(v * 2.3283064365386963e-10), OneMinusEpsilon);
+    }
+
+/*****************************************************sobol************************************************************/
+
+    //Generator matrices are built at compile time from Joe & Kuo's direction numbers (new-joe-kuo-6.21201).
+    //Dimension 0 is the van der Corput sequence, dimensions 0 and 1 form a (0, 2)-sequence.
+    static constexpr int NSobolDimensions = 21;
+    static constexpr int SobolMatrixSize = 32;
+
+    struct SobolTable {
+        uint32_t m[NSobolDimensions][SobolMatrixSize];
+    };
+
+    struct SobolDirection {
+        int s;        //degree of the primitive polynomial
+        uint32_t a;   //its inner coefficients
+        uint32_t m[7];
+    };
+
+    static constexpr SobolDirection SobolDirections[NSobolDimensions - 1] = {
+            {1, 0,  {1}},
+            {2, 1,  {1, 3}},
+            {3, 1,  {1, 3, 1}},
+            {3, 2,  {1, 1, 1}},
+            {4, 1,  {1, 1, 3,  3}},
+            {4, 4,  {1, 3, 5,  13}},
+            {5, 2,  {1, 1, 5,  5,  17}},
+            {5, 4,  {1, 1, 5,  5,  5}},
+            {5, 7,  {1, 1, 7,  11, 19}},
+            {5, 11, {1, 1, 5,  1,  1}},
+            {5, 13, {1, 1, 1,  3,  11}},
+            {5, 14, {1, 3, 5,  5,  31}},
+            {6, 1,  {1, 3, 3,  9,  7,  49}},
+            {6, 13, {1, 1, 1,  15, 21, 21}},
+            {6, 16, {1, 3, 1,  13, 27, 49}},
+            {6, 19, {1, 1, 1,  15, 7,  5}},
+            {6, 22, {1, 3, 1,  15, 13, 25}},
+            {6, 25, {1, 1, 5,  5,  19, 61}},
+            {7, 1,  {1, 3, 7,  11, 23, 15, 103}},
+            {7, 4,  {1, 3, 7,  13, 13, 15, 69}}
+    };
+
+    constexpr SobolTable ComputeSobolTable() {
+        SobolTable table{};
+        for (int k = 0; k < SobolMatrixSize; ++k) {
+            table.m[0][k] = 1u << (31 - k);
+        }
+        for (int d = 1; d < NSobolDimensions; ++d) {
+            const SobolDirection &dir = SobolDirections[d - 1];
+            uint32_t m[SobolMatrixSize + 1] = {};
+            for (int k = 1; k <= dir.s; ++k) m[k] = dir.m[k - 1];
+            //m_k = 2^s m_{k-s} ^ m_{k-s} ^ sum_j 2^j a_j m_{k-j}
+            for (int k = dir.s + 1; k <= SobolMatrixSize; ++k) {
+                uint32_t v = m[k - dir.s] ^ (m[k - dir.s] << dir.s);
+                for (int j = 1; j < dir.s; ++j) {
+                    if ((dir.a >> (dir.s - 1 - j)) & 1) v ^= m[k - j] << j;
+                }
+                m[k] = v;
+            }
+            for (int k = 1; k <= SobolMatrixSize; ++k) {
+                table.m[d][k - 1] = m[k] << (SobolMatrixSize - k);
+            }
+        }
+        return table;
+    }
+
+    static constexpr SobolTable SobolMatrices = ComputeSobolTable();
+
+    //raw 32 bit fraction of point a in dimension dim, only the low 32 bits of a are used
+    inline uint32_t SobolSampleBits(uint64_t a, int dim) {
+        assert(dim >= 0 && dim < NSobolDimensions);
+        //the matrix of dimension 0 reverses the bits
+        if (dim == 0) return ReverseBits32(uint32_t(a));
+        //one xor per set bit without a branch on each bit, scrambled indices have about half their bits set
+        uint32_t v = 0;
+        for (uint32_t bits = uint32_t(a); bits != 0; bits &= bits - 1)
+            v ^= SobolMatrices.m[dim][CountTrailingZeros(bits)];
+        return v;
+    }
+
+    //nested (Owen) scramble of a 32 bit fraction: every bit is flipped by a hash of the bits above it,
+    //so stratification is preserved while different seeds give independent point sets.
+    //Laine-Karras style hash on the reversed bits, where the carries of adds and multiplies by odd numbers and
+    //of xors with even multiples only move towards the high bits, i.e. the bits below in the fraction.
+    //A few multiplies instead of a MixBits per bit, which made this the cost of a Sobol or PMJ02 sample.
+    inline uint32_t OwenScramble(uint32_t v, uint32_t seed) {
+        v = ReverseBits32(v);
+        v ^= v * 0x3d20adeau;
+        v += seed;
+        v *= (seed >> 16) | 1u;
+        v ^= v * 0x05526c56u;
+        v ^= v * 0x53a22864u;
+        return ReverseBits32(v);
+    }
+
+/*****************************************************halton***********************************************************/
+
+    static constexpr int PrimeTableSize = 64;
+    static constexpr int Primes[PrimeTableSize] = {
+            2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+            59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+            137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+            227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311
+    };
+
+    //offset of every base's digit permutation inside one flat array
+    constexpr int PrimeSum(int n) {
+        int sum = 0;
+        for (int i = 0; i < n; ++i) sum += Primes[i];
+        return sum;
+    }
+
+    //radical inverse of a in Primes[baseIndex] with every digit mapped through perm
+    inline Float ScrambledRadicalInverse(int baseIndex, uint64_t a, const uint16_t *perm) {
+        const uint64_t base = Primes[baseIndex];
+        const Float invBase = Float(1) / Float(base);
+        uint64_t reversedDigits = 0;
+        Float invBaseN = 1;
+        while (a) {
+            uint64_t next = a / base;
+            uint64_t digit = a - next * base;
+            reversedDigits = reversedDigits * base + perm[digit];
+            invBaseN *= invBase;
+            a = next;
+        }
+        //the infinite tail of zero digits maps to perm[0] in every position
+        return std::min(invBaseN * (reversedDigits + invBase * perm[0] / (1 - invBase)), OneMinusEpsilon);
+    }
+}
+
+#endif //SIMPLERENDERER_LOWDISCREPANCY_H
@@ -0,0 +1,62 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#ifndef SIMPLERENDERER_MATERIAL_H
+#define SIMPLERENDERER_MATERIAL_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "spectrum.h"
+
+namespace sr {
+    //Fresnel reflectance of a dielectric interface, cosThetaI is negative on the inside
+    Float FrDielectric(Float cosThetaI, Float etaI, Float etaT);
+
+    inline Vector3f Reflect(const Vector3f &wo, const Vector3f &n) { return -wo + 2 * Dot(wo, n) * n; }
+
+    //false on total internal reflection, eta is etaI / etaT and n is on the side of wi
+    bool Refract(const Vector3f &wi, const Vector3f &n, Float eta, Vector3f *wt);
+
+    //Surface scattering of the renderer's integrators: a Lambertian lobe Kd, perfect specular reflection Kr and,
+    //when Kt is not black, a smooth dielectric of index eta whose Fresnel term splits Kr and Kt.
+    //Directions point away from the surface, n is the shading normal. f and Sample_f return the spectrum type of
+    //the calling kernel, RGBSpectrum or SampledSpectrum, from albedos converted once at construction.
+    class Material {
+    public:
+        Material(const Spectrum &Kd, const Spectrum &Kr = Spectrum(0.f), const Spectrum &Kt = Spectrum(0.f),
+                 Float eta = 1.5f);
+
+        bool HasDiffuse() const { return !Kd.IsBlack(); }
+
+        bool HasSpecular() const { return !Kr.IsBlack() || !Kt.IsBlack(); }
+
+        //the non delta part
+        template<typename SpectrumT = Spectrum>
+        SpectrumT f(const Vector3f &wo, const Vector3f &wi, const Normal3f &n) const;
+
+        //density of Sample_f returning wi through its non delta part
+        Float Pdf(const Vector3f &wo, const Vector3f &wi, const Normal3f &n) const;
+
+        //*specular is set for delta lobes, whose f and pdf include the delta and the lobe choice
+        template<typename SpectrumT = Spectrum>
+        SpectrumT Sample_f(const Vector3f &wo, const Normal3f &n, Float uc, const Point2f &u, Vector3f *wi,
+                           Float *pdf, bool *specular) const;
+
+        const Spectrum Kd, Kr, Kt;
+        const Float eta;
+
+    private:
+        //probability of choosing the diffuse lobe over the specular ones, from the rgb albedos whatever the
+        //kernel's representation, so every representation samples the same directions
+        Float DiffuseProbability() const;
+
+        //rgb or the matching sampled reflectance
+        template<typename SpectrumT>
+        static const SpectrumT &Albedo(const RGBSpectrum &rgb, const SampledSpectrum &sampled);
+
+        const SampledSpectrum sampledKd, sampledKr, sampledKt;
+    };
+}
+
+#endif //SIMPLERENDERER_MATERIAL_H
@@ -5,16 +5,67 @@
 #ifndef SIMPLERENDERER_MEDIUM_H
 #define SIMPLERENDERER_MEDIUM_H
 
+#include "sr.h"
+#include "geometry.h"
+#include "spectrum.h"
 
 namespace sr{
+    class Sampler;
+
+    class MediumInteraction;
+
+    //distribution of scattered directions inside a medium, wo and wi both point away from the scattering point
+    class PhaseFunction {
+    public:
+        virtual ~PhaseFunction();
+
+        virtual Float p(const Vector3f &wo, const Vector3f &wi) const = 0;
+
+        //samples wi, returns the value of p which is also its pdf
+        virtual Float Sample_p(const Vector3f &wo, Vector3f *wi, const Point2f &u) const = 0;
+    };
+
+    //Henyey-Greenstein lobe, cosTheta is between wo and wi, g > 0 scatters forward
+    inline Float PhaseHG(Float cosTheta, Float g) {
+        Float denom = 1 + g * g + 2 * g * cosTheta;
+        return Inv4Pi * (1 - g * g) / (denom * std::sqrt(denom));
+    }
+
+    class HenyeyGreenstein : public PhaseFunction {
+    public:
+        HenyeyGreenstein(Float g) : g(g) {}
+
+        Float p(const Vector3f &wo, const Vector3f &wi) const override;
+
+        Float Sample_p(const Vector3f &wo, Vector3f *wi, const Point2f &u) const override;
+
+    private:
+        const Float g;
+    };
+
     class Medium {
+    public:
+        virtual ~Medium();
+
+        //transmittance between ray.o and ray(ray.tMax), ray.d needs not be normalized
+        virtual Spectrum Tr(const Ray &ray, Sampler &sampler) const = 0;
 
+        //Samples a scattering point along the ray before ray.tMax and fills mi, which stays invalid
+        //(phase == nullptr) when the ray passed through. Returns transmittance times sigma_s over the pdf
+        //of the event, the throughput weight of the path segment either way.
+        virtual Spectrum Sample(const Ray &ray, Sampler &sampler, MediumInteraction *mi) const = 0;
     };
 
+    //media on the two sides of a surface, inside is the side opposite the normal
     class MediumInterface{
     public:
         MediumInterface(): outside(nullptr), inside(nullptr){}
         MediumInterface(const Medium* medium): outside(medium), inside(medium){}
+        MediumInterface(const Medium *inside, const Medium *outside) : outside(outside), inside(inside) {}
+
+        //surfaces that are not a transition only bound geometry, rays keep their medium
+        bool IsMediumTransition() const { return inside != outside; }
+
         const Medium *outside, *inside;
     };
 }
@@ -0,0 +1,129 @@
+//
+// Created by 18310 on 2021/5/2.
+//
+
+#ifndef SIMPLERENDERER_MEMORY_H
+#define SIMPLERENDERER_MEMORY_H
+
+#include "sr.h"
+#include <list>
+#include <new>
+#include <utility>
+
+#ifndef SIMPLERENDERER_L1_CACHE_LINE_SIZE
+#define SIMPLERENDERER_L1_CACHE_LINE_SIZE 64
+#endif
+
+//placement new of a Type from arena, e.g. BSDF *bsdf = ARENA_ALLOC(arena, BSDF)(si);
+#define ARENA_ALLOC(arena, Type) new ((arena).Alloc(sizeof(Type), alignof(Type))) Type
+
+namespace sr {
+
+    //cache line aligned allocation, release with FreeAligned
+    void *AllocAligned(std::size_t size);
+
+    template<typename T>
+    T *AllocAligned(std::size_t count) {
+        return (T *) AllocAligned(count * sizeof(T));
+    }
+
+    void FreeAligned(void *ptr);
+
+    //Fixed size array of default constructed T in cache line aligned storage. new T[n] ignores alignas
+    //before C++17, so arrays of over-aligned types such as MemoryArena go through this instead.
+    template<typename T>
+    class AlignedArray {
+    public:
+        static_assert(alignof(T) <= SIMPLERENDERER_L1_CACHE_LINE_SIZE, "AlignedArray: alignment above a cache line");
+
+        AlignedArray() {}
+
+        explicit AlignedArray(std::size_t n) : ptr(AllocAligned<T>(n)) {
+            if (n && !ptr) throw std::bad_alloc();
+            for (; size < n; ++size) new(&ptr[size]) T();
+        }
+
+        AlignedArray(AlignedArray &&other) noexcept : ptr(other.ptr), size(other.size) {
+            other.ptr = nullptr;
+            other.size = 0;
+        }
+
+        AlignedArray &operator=(AlignedArray &&other) noexcept {
+            std::swap(ptr, other.ptr);
+            std::swap(size, other.size);
+            return *this;
+        }
+
+        ~AlignedArray() {
+            for (std::size_t i = 0; i < size; ++i) ptr[i].~T();
+            FreeAligned(ptr);
+        }
+
+        T &operator[](std::size_t i) { return ptr[i]; }
+
+        const T &operator[](std::size_t i) const { return ptr[i]; }
+
+        std::size_t Size() const { return size; }
+
+    private:
+        T *ptr = nullptr;
+        std::size_t size = 0;
+    };
+
+    //Bump pointer allocator for short lived objects such as BSDFs and temporary interactions.
+    //Objects are never freed one by one and their destructors never run: Reset() releases everything at once
+    //and keeps the blocks for reuse, so a warmed up arena does not touch the global heap.
+    //Not thread safe, give every thread its own arena.
+    class alignas(SIMPLERENDERER_L1_CACHE_LINE_SIZE) MemoryArena {
+    public:
+        explicit MemoryArena(std::size_t blockSize = 262144) : blockSize(blockSize) {}
+
+        ~MemoryArena();
+
+        MemoryArena(const MemoryArena &) = delete;
+
+        MemoryArena &operator=(const MemoryArena &) = delete;
+
+        //aligned to 16 bytes or to align, a power of two up to the cache line size
+        void *Alloc(std::size_t nBytes, std::size_t align = 16) {
+            //blocks start cache line aligned, so aligning the position aligns the pointer
+            currentBlockPos = (currentBlockPos + align - 1) & ~(align - 1);
+            nBytes = (nBytes + 15) & ~std::size_t(15);
+            if (currentBlockPos + nBytes > currentAllocSize) NextBlock(nBytes);
+            void *ret = currentBlock + currentBlockPos;
+            currentBlockPos += nBytes;
+            return ret;
+        }
+
+        template<typename T>
+        T *Alloc(std::size_t n = 1, bool runConstructor = true) {
+            static_assert(alignof(T) <= SIMPLERENDERER_L1_CACHE_LINE_SIZE, "MemoryArena: alignment above a cache line");
+            T *ret = (T *) Alloc(n * sizeof(T), alignof(T));
+            if (runConstructor) {
+                for (std::size_t i = 0; i < n; ++i) new(&ret[i]) T();
+            }
+            return ret;
+        }
+
+        //invalidates every allocation
+        void Reset() {
+            currentBlockPos = 0;
+            availableBlocks.splice(availableBlocks.begin(), usedBlocks);
+        }
+
+        //bytes held by the arena, in use or not
+        std::size_t TotalAllocated() const;
+
+    private:
+        //retire the current block and continue in one that holds at least nBytes
+        void NextBlock(std::size_t nBytes);
+
+        const std::size_t blockSize;
+        std::size_t currentBlockPos = 0, currentAllocSize = 0;
+        uint8_t *currentBlock = nullptr;
+        //(size, block)
+        std::list<std::pair<std::size_t, uint8_t *>> usedBlocks, availableBlocks;
+    };
+}
+
+#endif //SIMPLERENDERER_MEMORY_H
@@ -0,0 +1,28 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#ifndef SIMPLERENDERER_ORTHOGRAPHIC_H
+#define SIMPLERENDERER_ORTHOGRAPHIC_H
+
+#include "camera.h"
+
+namespace sr {
+    //parallel projection along camera +z, with an optional thin lens focused at focalDistance
+    class OrthographicCamera : public ProjectiveCamera {
+    public:
+        OrthographicCamera(const Transform &cameraToWorld, const Bounds2f &screenWindow, Float shutterOpen,
+                           Float shutterClose, Float lensRadius, Float focalDistance, Film *film,
+                           const Medium *medium = nullptr);
+
+        Float GenerateRay(const CameraSample &sample, Ray *ray) const override;
+
+        Float GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const override;
+
+        RayCone GeneratePixelCone() const override;
+
+        void GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays, int64_t offset = 0) const override;
+    };
+}
+
+#endif //SIMPLERENDERER_ORTHOGRAPHIC_H
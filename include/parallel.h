@@ -0,0 +1,80 @@
+//
+// Created by 18310 on 2021/4/12.
+//
+
+#ifndef SIMPLERENDERER_PARALLEL_H
+#define SIMPLERENDERER_PARALLEL_H
+
+#include "sr.h"
+#include "geometry.h"
+#include <atomic>
+#include <functional>
+
+namespace sr {
+
+    //index of the calling thread inside ParallelFor, the thread that calls ParallelFor is always 0
+    extern thread_local int ThreadIndex;
+
+    //0 means use every hardware thread
+    void SetThreadCount(int nThreads);
+
+    int NumSystemCores();
+
+    //ThreadIndex is always smaller than this, use it to size per-thread storage
+    inline int MaxThreadIndex() { return NumSystemCores(); }
+
+    //run func(i) for i in [0, count), chunkSize iterations are handed out to a thread at a time
+    //calling ParallelFor from inside a ParallelFor runs the loop serially on the calling thread
+    //the worker threads are started once and reused by every later loop
+    void ParallelFor(const std::function<void(int64_t)> &func, int64_t count, int chunkSize = 1);
+
+    //run func(p) for every p in [0, count.x) x [0, count.y), one point per hand-out (e.g. image tiles)
+    void ParallelFor2D(const std::function<void(Point2i)> &func, const Point2i &count);
+
+    //Float that supports lock-free accumulation from several threads
+    class AtomicFloat {
+    public:
+        explicit AtomicFloat(Float v = 0) : bits(ToBits(v)) {}
+
+        AtomicFloat(const AtomicFloat &) = delete;
+
+        AtomicFloat &operator=(const AtomicFloat &) = delete;
+
+        operator Float() const { return FromBits(bits.load(std::memory_order_relaxed)); }
+
+        Float operator=(Float v) {
+            bits.store(ToBits(v), std::memory_order_relaxed);
+            return v;
+        }
+
+        void Add(Float v) {
+            Bits oldBits = bits.load(std::memory_order_relaxed), newBits;
+            do {
+                newBits = ToBits(FromBits(oldBits) + v);
+            } while (!bits.compare_exchange_weak(oldBits, newBits, std::memory_order_relaxed));
+        }
+
+    private:
+#ifdef SIMPLERENDERER_FLOAT_AS_DOUBLE
+        typedef uint64_t Bits;
+#else
+        typedef uint32_t Bits;
+#endif
+
+        static Bits ToBits(Float f) {
+            Bits b;
+            std::memcpy(&b, &f, sizeof(Float));
+            return b;
+        }
+
+        static Float FromBits(Bits b) {
+            Float f;
+            std::memcpy(&f, &b, sizeof(Float));
+            return f;
+        }
+
+        std::atomic<Bits> bits;
+    };
+}
+
+#endif //SIMPLERENDERER_PARALLEL_H
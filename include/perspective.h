@@ -0,0 +1,33 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#ifndef SIMPLERENDERER_PERSPECTIVE_H
+#define SIMPLERENDERER_PERSPECTIVE_H
+
+#include "camera.h"
+
+namespace sr {
+    //pinhole camera, or a thin lens camera focused at focalDistance when lensRadius > 0
+    class PerspectiveCamera : public ProjectiveCamera {
+    public:
+        //fov in degrees, along the shorter image axis for DefaultScreenWindow
+        PerspectiveCamera(const Transform &cameraToWorld, const Bounds2f &screenWindow, Float shutterOpen,
+                          Float shutterClose, Float lensRadius, Float focalDistance, Float fov, Film *film,
+                          const Medium *medium = nullptr);
+
+        Float GenerateRay(const CameraSample &sample, Ray *ray) const override;
+
+        Float GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const override;
+
+        RayCone GeneratePixelCone() const override;
+
+        void GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays, int64_t offset = 0) const override;
+
+    private:
+        //pFocus = focusScale * pCamera, the raster plane lies at constant camera z
+        Float focusScale;
+    };
+}
+
+#endif //SIMPLERENDERER_PERSPECTIVE_H
@@ -0,0 +1,27 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#ifndef SIMPLERENDERER_PMJ02_H
+#define SIMPLERENDERER_PMJ02_H
+
+#include "sampler.h"
+
+namespace sr {
+    //Progressive multi-jittered (0, 2) samples. Every 2D sample comes from the Owen scrambled (0, 2)-sequence
+    //formed by Sobol dimensions 0 and 1, which has the same elementary-interval stratification as pmj02,
+    //and every prefix of 2^k samples is stratified. Each dimension pair gets its own scramble, and every pair after
+    //the pixel pair an Owen scrambled sample index, which decorrelates it and keeps the prefixes stratified.
+    class PMJ02Sampler : public Sampler {
+    public:
+        PMJ02Sampler(int64_t samplesPerPixel, uint32_t seed = 0) : Sampler(samplesPerPixel, seed) {}
+
+        Float Get1D() override;
+
+        Point2f Get2D() override;
+
+        std::unique_ptr<Sampler> Clone() const override;
+    };
+}
+
+#endif //SIMPLERENDERER_PMJ02_H
@@ -0,0 +1,34 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#ifndef SIMPLERENDERER_POINT_H
+#define SIMPLERENDERER_POINT_H
+
+#include "light.h"
+
+namespace sr {
+    //isotropic point light at the light space origin, I is the radiant intensity
+    class PointLight : public Light {
+    public:
+        PointLight(const Transform &LightToWorld, const MediumInterface &mediumInterface, const Spectrum &I);
+
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           VisibilityTester *vis) const override;
+
+        Float Pdf_Li(const Interaction &ref, const Vector3f &wi) const override;
+
+        Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time, Ray *ray, Normal3f *nLight,
+                           Float *pdfPos, Float *pdfDir) const override;
+
+        Spectrum Power() const override;
+
+        bool Bounds(LightBounds *bounds) const override;
+
+    private:
+        const Point3f pLight;
+        const Spectrum I;
+    };
+}
+
+#endif //SIMPLERENDERER_POINT_H
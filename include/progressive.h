@@ -0,0 +1,89 @@
+//
+// Created by 18310 on 2021/4/24.
+//
+
+#ifndef SIMPLERENDERER_PROGRESSIVE_H
+#define SIMPLERENDERER_PROGRESSIVE_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "film.h"
+#include "memory.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace sr {
+
+    //evaluates sample sampleIndex of pixel pPixel and adds it to tile.
+    //arena belongs to the calling thread and is reset after every sample, allocate per sample scratch from it
+    typedef std::function<void(const Point2i &pPixel, int64_t sampleIndex, FilmTile *tile, MemoryArena &arena)>
+            PixelSampleFunc;
+
+    struct ProgressiveOptions {
+        int samplesPerPass = 1;
+        //0 means unlimited, at least one budget should be set
+        int64_t maxSamplesPerPixel = 0;
+        //seconds of wall-clock time, 0 means unlimited
+        double timeBudget = 0;
+        int tileSize = 16;
+        CurveOrder tileOrder = CurveOrder::Spiral;
+        //adaptive sampling: a tile whose Film::Error drops below errorThreshold stops receiving samples,
+        //0 disables it. Rendering ends early once every tile has converged.
+        Float errorThreshold = 0;
+        //samples every pixel gets before its tile may be retired
+        int64_t minAdaptiveSamples = 16;
+        //called on the rendering thread after every completed pass with a copy of the published snapshot,
+        //no lock is held so it may call GetSnapshot or Stop
+        std::function<void(const std::vector<Float> &rgb, int pass)> onPass;
+    };
+
+    //Renders passes of samplesPerPass samples over every tile until a budget runs out or Stop() is called.
+    //The film always holds a valid image because every pixel is normalized by its own filter weight, and
+    //each completed pass additionally publishes a snapshot in which every pixel has the same sample count.
+    class ProgressiveRenderer {
+    public:
+        ProgressiveRenderer(Film *film, PixelSampleFunc func, const ProgressiveOptions &options);
+
+        //blocks until the budget is used up, returns the number of completed passes
+        int Render();
+
+        //safe to call from any thread, the renderer stops within one tile row
+        void Stop() { stopRequested = true; }
+
+        //rgb of the film's cropped bounds after the last completed pass, false before the first pass
+        bool GetSnapshot(std::vector<Float> *rgb, int *pass = nullptr) const;
+
+        //samples taken by the pixels that were never retired
+        int64_t SamplesPerPixel() const { return samplesTaken; }
+
+        //tiles still receiving samples, after adaptive retirement and splitting
+        std::size_t ActiveTileCount() const { return activeTiles.size(); }
+
+    private:
+        bool OutOfTime() const;
+
+        double Elapsed() const;
+
+        //drop converged tiles and split the rest when there are fewer tiles than threads
+        void UpdateActiveTiles();
+
+        Film *film;
+        const PixelSampleFunc func;
+        const ProgressiveOptions options;
+        //one per thread, indexed by ThreadIndex
+        AlignedArray<MemoryArena> arenas;
+        std::vector<Bounds2i> activeTiles;
+
+        std::atomic<bool> stopRequested;
+        std::chrono::steady_clock::time_point startTime;
+        int64_t samplesTaken = 0;
+
+        mutable std::mutex snapshotMutex;
+        std::vector<Float> snapshot;
+        int snapshotPass = -1;
+    };
+}
+
+#endif //SIMPLERENDERER_PROGRESSIVE_H
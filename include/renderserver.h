@@ -0,0 +1,135 @@
+//
+// Created by 18310 on 2021/5/11.
+//
+
+#ifndef SIMPLERENDERER_RENDERSERVER_H
+#define SIMPLERENDERER_RENDERSERVER_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "film.h"
+#include "guidedpath.h"
+#include "memory.h"
+#include "scene.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sr {
+
+    //JobTiles never cuts tiles larger than this, which bounds the size of a tile message
+    static constexpr int MaxJobTileSize = 1024;
+
+    //largest Job payload a server accepts, an encoded RenderJob is far smaller
+    static constexpr std::size_t MaxRenderJobPayload = 1024;
+
+    //one render request, the camera is a perspective camera looking from eye at target
+    struct RenderJob {
+        Point3f eye, target = Point3f(0, 0, 1);
+        Vector3f up = Vector3f(0, 1, 0);
+        //degrees
+        Float fov = 45;
+        Point2i resolution = Point2i(640, 480);
+        //pixels to render, all zero for the whole image; otherwise pMin must be below pMax in x and y
+        Bounds2i crop = Bounds2i(Point2i(0, 0), Point2i(0, 0));
+        int64_t samplesPerPixel = 16;
+        int tileSize = 32;
+        uint32_t seed = 0;
+        SpectrumRepresentation spectrum = SpectrumRepresentation::RGB;
+    };
+
+    //what the server reports at the end of a job
+    struct RenderJobStats {
+        int64_t tiles = 0;
+        int64_t payloadBytes = 0;
+        double seconds = 0;
+    };
+
+    enum class RenderMessage : uint32_t {
+        //client: a RenderJob, answered by Tile messages and one JobDone or Error
+        Job = 1,
+        //client: stop the server after this connection
+        Shutdown,
+        //server: a FilmTile::Encode payload
+        Tile,
+        //server: the RenderJobStats of the job
+        JobDone,
+        //server: text of the reason the job was refused
+        Error
+    };
+
+    //job wire format, DecodeRenderJob is false for a malformed payload
+    void EncodeRenderJob(const RenderJob &job, std::vector<uint8_t> *payload);
+
+    bool DecodeRenderJob(const std::vector<uint8_t> &payload, RenderJob *job);
+
+    //empty for a job that can be rendered, otherwise the reason it cannot
+    std::string ValidateRenderJob(const RenderJob &job);
+
+    //film covering the job's resolution and crop
+    std::unique_ptr<Film> CreateJobFilm(const RenderJob &job, const std::string &filename);
+
+    //tiles of tileSize, at most MaxJobTileSize and the film's extent, partitioning film's sample bounds,
+    //in spiral order
+    std::vector<Bounds2i> JobTiles(const RenderJob &job, const Film &film);
+
+    //camera, path tracer in job.spectrum and JobTiles of one job on a resident scene, for whoever schedules the tiles
+    class JobContext {
+    public:
+        JobContext(const Scene &scene, const RenderJob &job, const GuidedPathOptions &options);
+
+        const std::vector<Bounds2i> &Tiles() const { return tiles; }
+
+        //every sample of tile t, on a thread with a valid ThreadIndex
+        std::unique_ptr<FilmTile> RenderTile(int t, MemoryArena &arena) const;
+
+    private:
+        const RenderJob job;
+        std::unique_ptr<Film> film;
+        std::shared_ptr<const Camera> camera;
+        std::unique_ptr<GuidedPathIntegrator> integrator;
+        PixelSampleFunc func;
+        std::vector<Bounds2i> tiles;
+    };
+
+    //Long running render process. The scene is built once and stays resident across jobs, together with the
+    //spectrum tables and texture caches of the process. Clients connect over a Unix domain socket and send jobs;
+    //every job renders its tiles in parallel with the path tracer and streams each tile back as soon as it is
+    //done. Counters and validation failures go to std::cerr after every job. Connections are served one at a
+    //time, a job already uses every thread. An idle client does not block Stop(), one that stalls in the middle
+    //of a message or stops reading tiles is dropped.
+    class RenderServer {
+    public:
+        //options configure the path tracer, guiding is turned off since jobs render a single pass
+        RenderServer(std::shared_ptr<const Scene> scene, const GuidedPathOptions &options = GuidedPathOptions());
+
+        //blocks serving clients until a Shutdown message or Stop(), false if path cannot be listened on
+        bool Serve(const std::string &path);
+
+        //safe to call from any thread, the job in progress is finished first
+        void Stop();
+
+        int64_t JobsServed() const { return jobsServed; }
+
+    private:
+        //false when the client is gone
+        bool Render(int fd, const RenderJob &job);
+
+        std::shared_ptr<const Scene> scene;
+        GuidedPathOptions options;
+        std::atomic<int> listenFd;
+        std::atomic<bool> stopRequested;
+        int64_t jobsServed = 0;
+    };
+
+    //Sends job to the server listening at path and merges the tiles into film as they arrive, calling onTile after
+    //each. film must have the job's resolution and crop. Returns false and prints the reason on failure.
+    bool RequestRender(const std::string &path, const RenderJob &job, Film *film, RenderJobStats *stats = nullptr,
+                       const std::function<void(const Bounds2i &tile)> &onTile = nullptr);
+
+    //asks the server at path to exit once the connection closes
+    bool RequestShutdown(const std::string &path);
+}
+
+#endif //SIMPLERENDERER_RENDERSERVER_H
@@ -0,0 +1,73 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#ifndef SIMPLERENDERER_SAMPLER_H
+#define SIMPLERENDERER_SAMPLER_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "lowdiscrepancy.h"
+#include <memory>
+
+namespace sr {
+
+    struct CameraSample {
+        //continuous raster position
+        Point2f pFilm;
+        Point2f pLens;
+        Float time = 0;
+    };
+
+    //Samplers are stateless in the sample index: StartPixelSample jumps straight to any sample of any pixel,
+    //so progressive passes and adaptive tiles can resume without replaying earlier samples.
+    //A sampler instance holds the current pixel and dimension, Clone() one for every thread.
+    class Sampler {
+    public:
+        //samplesPerPixel is a hint for samplers that stratify blocks of samples, more can be taken
+        Sampler(int64_t samplesPerPixel, uint32_t seed = 0) : samplesPerPixel(samplesPerPixel), seed(seed) {}
+
+        virtual ~Sampler();
+
+        //later Get1D/Get2D calls start at dimension dim
+        virtual void StartPixelSample(const Point2i &p, int64_t index, int dim = 0) {
+            pixel = p;
+            sampleIndex = index;
+            dimension = dim;
+        }
+
+        virtual Float Get1D() = 0;
+
+        virtual Point2f Get2D() = 0;
+
+        //position inside the pixel, the first 2D sample of every sample vector
+        virtual Point2f GetPixel2D() { return Get2D(); }
+
+        virtual std::unique_ptr<Sampler> Clone() const = 0;
+
+        //film position, time and lens position of the current sample of pRaster
+        CameraSample GetCameraSample(const Point2i &pRaster);
+
+        const int64_t samplesPerPixel;
+        const uint32_t seed;
+
+    protected:
+        //decorrelates pixels and dimensions
+        uint64_t PixelHash(int dim) const {
+            return Hash((uint64_t(uint32_t(pixel.x)) << 32) | uint32_t(pixel.y), uint64_t(dim), seed);
+        }
+
+        //shuffles the sample index inside every block of samplesPerPixel samples, used to pad dimensions
+        uint64_t PermutedIndex(uint64_t hash) const {
+            uint64_t n = uint64_t(std::max<int64_t>(samplesPerPixel, 1));
+            uint64_t block = uint64_t(sampleIndex) / n, local = uint64_t(sampleIndex) % n;
+            return block * n + PermutationElement(uint32_t(local), uint32_t(n), uint32_t(hash));
+        }
+
+        Point2i pixel;
+        int64_t sampleIndex = 0;
+        int dimension = 0;
+    };
+}
+
+#endif //SIMPLERENDERER_SAMPLER_H
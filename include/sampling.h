@@ -0,0 +1,93 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#ifndef SIMPLERENDERER_SAMPLING_H
+#define SIMPLERENDERER_SAMPLING_H
+
+#include "sr.h"
+#include "geometry.h"
+#include <memory>
+#include <vector>
+
+namespace sr {
+    //map [0, 1]² to the unit disk, keeps the stratification of u
+    Point2f ConcentricSampleDisk(const Point2f &u);
+
+    //directions over the unit sphere, uniform in solid angle
+    Vector3f UniformSampleSphere(const Point2f &u);
+
+    inline Float UniformSpherePdf() { return Inv4Pi; }
+
+    //directions inside the cone around +z with half angle acos(cosThetaMax), uniform in solid angle
+    Vector3f UniformSampleCone(const Point2f &u, Float cosThetaMax);
+
+    inline Float UniformConePdf(Float cosThetaMax) { return 1 / (2 * Pi * (1 - cosThetaMax)); }
+
+    //directions over the +z hemisphere with density cos(theta) / pi
+    inline Vector3f CosineSampleHemisphere(const Point2f &u) {
+        Point2f d = ConcentricSampleDisk(u);
+        Float z = SafeSqrt(1 - d.x * d.x - d.y * d.y);
+        return Vector3f(d.x, d.y, z);
+    }
+
+    inline Float CosineHemispherePdf(Float cosTheta) { return cosTheta * InvPi; }
+
+    //piecewise constant 1D distribution over [0, 1] proportional to f, sampled by binary search of the CDF
+    struct Distribution1D {
+        Distribution1D(const Float *f, int n);
+
+        int Count() const { return int(func.size()); }
+
+        //pdf is the density over [0, 1], off the index of the piece
+        Float SampleContinuous(Float u, Float *pdf, int *off = nullptr) const;
+
+        int SampleDiscrete(Float u, Float *pdf = nullptr, Float *uRemapped = nullptr) const;
+
+        Float DiscretePDF(int index) const { return func[index] / (funcInt * Count()); }
+
+        std::vector<Float> func, cdf;
+        Float funcInt;
+    };
+
+    //piecewise constant 2D distribution over [0, 1]², marginal over v and one conditional per row
+    class Distribution2D {
+    public:
+        //func holds nu * nv values, row major in v
+        Distribution2D(const Float *func, int nu, int nv);
+
+        Point2f SampleContinuous(const Point2f &u, Float *pdf) const;
+
+        Float Pdf(const Point2f &p) const;
+
+    private:
+        std::vector<std::unique_ptr<Distribution1D>> pConditionalV;
+        std::unique_ptr<Distribution1D> pMarginal;
+    };
+
+    //Walker's alias method, O(1) sampling of a discrete distribution proportional to weights
+    class AliasTable {
+    public:
+        AliasTable() {}
+
+        //weights need not be normalized, all zero weights give an empty table
+        explicit AliasTable(const std::vector<Float> &weights);
+
+        //returns the index, -1 for an empty table. uRemapped is u rescaled to [0, 1) for reuse
+        int Sample(Float u, Float *pmf = nullptr, Float *uRemapped = nullptr) const;
+
+        Float PMF(int index) const { return bins[index].p; }
+
+        std::size_t Size() const { return bins.size(); }
+
+    private:
+        struct Bin {
+            //q: probability of keeping the bin, p: pmf of the bin
+            Float q = 0, p = 0;
+            int alias = -1;
+        };
+        std::vector<Bin> bins;
+    };
+}
+
+#endif //SIMPLERENDERER_SAMPLING_H
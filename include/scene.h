@@ -0,0 +1,44 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#ifndef SIMPLERENDERER_SCENE_H
+#define SIMPLERENDERER_SCENE_H
+
+#include "sr.h"
+#include "shape.h"
+#include "material.h"
+#include "light.h"
+#include <memory>
+#include <vector>
+
+namespace sr {
+    struct Primitive {
+        std::shared_ptr<Shape> shape;
+        std::shared_ptr<Material> material;
+    };
+
+    //Shapes with their materials and the lights. Rays are tested against every shape with IntersectHit,
+    //there is no acceleration structure yet. Lights are preprocessed against the scene bounds on construction.
+    class Scene {
+    public:
+        Scene(std::vector<Primitive> primitives, std::vector<std::shared_ptr<Light>> lights);
+
+        //closest hit, *material may be nullptr for shapes without one
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect, const Material **material) const;
+
+        bool IntersectP(const Ray &ray) const;
+
+        const Bounds3f &WorldBound() const { return worldBound; }
+
+        const std::vector<Primitive> primitives;
+        const std::vector<std::shared_ptr<Light>> lights;
+        //lights that emit into rays leaving the scene
+        std::vector<std::shared_ptr<Light>> infiniteLights;
+
+    private:
+        Bounds3f worldBound;
+    };
+}
+
+#endif //SIMPLERENDERER_SCENE_H
@@ -0,0 +1,128 @@
+//
+// Created by 18310 on 2021/5/10.
+//
+
+#ifndef SIMPLERENDERER_SDTREE_H
+#define SIMPLERENDERER_SDTREE_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "parallel.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace sr {
+
+    //equal area map of the sphere to [0, 1]²: x = (1 - cos(theta)) / 2, y = phi / 2pi, so pdfs differ by 4pi
+    inline Point2f DirectionToCanonical(const Vector3f &w) {
+        Float theta = SphericalTheta(w), phi = SphericalPhi(w);
+        return Point2f(Clamp((1 - std::cos(theta)) * 0.5f, 0, OneMinusEpsilon), Clamp(phi * Inv2Pi, 0, OneMinusEpsilon));
+    }
+
+    inline Vector3f CanonicalToDirection(const Point2f &p) {
+        Float cosTheta = 1 - 2 * p.x;
+        return SphericalDirection(SafeSqrt(1 - cosTheta * cosTheta), cosTheta, 2 * Pi * p.y);
+    }
+
+    //Directional quadtree over the canonical square. Every node keeps the radiance splatted into its four
+    //quadrants, children exist where a quadrant held enough of the energy when the tree was refined.
+    class DTree {
+    public:
+        DTree() : nodes(1) {}
+
+        DTree(const DTree &t) : nodes(t.nodes), nSamples(t.nSamples.load(std::memory_order_relaxed)) {}
+
+        DTree &operator=(const DTree &t) {
+            nodes = t.nodes;
+            nSamples.store(t.nSamples.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        //lock-free, the structure must not change meanwhile
+        void Record(const Point2f &p, Float value);
+
+        void AddSample() { nSamples.fetch_add(1, std::memory_order_relaxed); }
+
+        int64_t SampleCount() const { return nSamples.load(std::memory_order_relaxed); }
+
+        void SetSampleCount(int64_t n) { nSamples.store(n, std::memory_order_relaxed); }
+
+        Float Total() const { return nodes[0].Total(); }
+
+        //density over the canonical square, divide by 4pi for solid angle
+        Float Pdf(Point2f p) const;
+
+        Point2f Sample(Point2f u) const;
+
+        //Rebuilds the structure from the energy of previous: quadrants holding more than threshold of the total
+        //are subdivided, the rest collapse. Sums start at zero.
+        void Refine(const DTree &previous, Float threshold, int maxDepth = 20);
+
+        std::size_t NodeCount() const { return nodes.size(); }
+
+    private:
+        struct Node {
+            Node() { child[0] = child[1] = child[2] = child[3] = 0; }
+
+            Node(const Node &n) { *this = n; }
+
+            Node &operator=(const Node &n) {
+                for (int i = 0; i < 4; ++i) {
+                    sum[i] = Float(n.sum[i]);
+                    child[i] = n.child[i];
+                }
+                return *this;
+            }
+
+            Float Total() const { return Float(sum[0]) + Float(sum[1]) + Float(sum[2]) + Float(sum[3]); }
+
+            //quadrant of p, x in bit 0 and y in bit 1
+            static int Quadrant(const Point2f &p) { return (p.x >= 0.5f ? 1 : 0) | (p.y >= 0.5f ? 2 : 0); }
+
+            AtomicFloat sum[4];
+            //0 for a leaf quadrant, the root is never a child
+            int child[4];
+        };
+
+        std::vector<Node> nodes;
+        std::atomic<int64_t> nSamples{0};
+    };
+
+    //the distribution being sampled this pass and the one being learned for the next
+    struct DTreeWrapper {
+        DTree sampling, building;
+    };
+
+    //Spatial binary tree over the scene bounds, children halve their parent along x, y, z in turn.
+    //Each leaf owns a DTreeWrapper.
+    class STree {
+    public:
+        explicit STree(const Bounds3f &bounds);
+
+        DTreeWrapper *Lookup(const Point3f &p) const;
+
+        //Ends a training pass: leaves with more than splitThreshold samples are split, children start from
+        //copies of their parent's trees, then every directional tree swaps its learned distribution in.
+        void Refine(int64_t splitThreshold, Float directionalThreshold);
+
+        std::size_t LeafCount() const;
+
+    private:
+        struct Node {
+            bool IsLeaf() const { return child[0] == 0; }
+
+            //axis this node splits, children split the next one
+            int axis = 0;
+            //0 for leaves
+            int child[2] = {0, 0};
+            //leaves only
+            std::unique_ptr<DTreeWrapper> dTree;
+        };
+
+        Bounds3f bounds;
+        std::vector<Node> nodes;
+    };
+}
+
+#endif //SIMPLERENDERER_SDTREE_H
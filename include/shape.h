@@ -6,13 +6,25 @@
 #define SIMPLERENDERER_SHAPE_H
 
 #include "transform.h"
+#include "medium.h"
 
 namespace sr {
+    //what traversal keeps of a candidate hit, the full SurfaceInteraction is built once for the closest one
+    struct HitRecord {
+        Float tHit = Infinity;
+        //shapes reset it to -1 on a hit, the caller that owns the shapes sets it afterwards
+        int primitiveId = -1;
+        //shape parameterization at the hit
+        Point2f uv;
+    };
+
     class Shape {
     public:
         const Transform *ObjectToWorld, *WorldToObject;
         const bool reverseOrientation;
         const bool transformSwapsHandedness;
+        //media inside and outside the surface, left empty the shape only bounds geometry
+        MediumInterface mediumInterface;
 
         Shape(const Transform *ObjectToWorld, const Transform *WorldToObject, bool reverseOrientation) : ObjectToWorld(
                 ObjectToWorld), WorldToObject(WorldToObject), reverseOrientation(reverseOrientation),
@@ -21,9 +33,25 @@ namespace sr {
 
         virtual Bounds3f ObjectBound() const = 0;
 
-        virtual bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect, bool testAlphaTexture = true) const = 0;
+        //closest hit along ray in (0, ray.tMax), overwrites the whole hit record only when there is one
+        virtual bool IntersectHit(const Ray &ray, HitRecord *hit, bool testAlphaTexture = true) const = 0;
+
+        //object space interaction of a hit found by IntersectHit with the same world space ray
+        virtual void ComputeObjectInteraction(const Ray &ray, const HitRecord &hit, SurfaceInteraction *isect) const = 0;
+
+        //world space interaction, ComputeObjectInteraction carried through ObjectToWorld
+        virtual void ComputeInteraction(const Ray &ray, const HitRecord &hit, SurfaceInteraction *isect) const;
+
+        //Object space shading: materials that evaluate in the local shading frame can keep the object space
+        //interaction for uv and texture lookups and only take its world position and shading frame from here,
+        //one point and two direction transforms instead of the full interaction transform.
+        //World directions such as wo = -ray.d and light directions go through frame->ToLocal.
+        void ComputeShadingFrame(const SurfaceInteraction &objectIsect, Point3f *pWorld, ShadingFrame *frame) const;
+
+        //IntersectHit followed by ComputeInteraction
+        virtual bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect, bool testAlphaTexture = true) const;
 
-        virtual bool IntersectP(const Ray& ray, bool testAlphaTexture);
+        virtual bool IntersectP(const Ray &ray, bool testAlphaTexture = true) const;
 
         virtual Float Area() const = 0;
 
@@ -0,0 +1,29 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#ifndef SIMPLERENDERER_SOBOL_H
+#define SIMPLERENDERER_SOBOL_H
+
+#include "sampler.h"
+
+namespace sr {
+    //Sobol sequence with Owen scrambling seeded per pixel and dimension.
+    //The first NSobolDimensions dimensions keep the sequence's joint stratification, later ones are padded
+    //with scrambled, index-shuffled copies of dimension 0.
+    class SobolSampler : public Sampler {
+    public:
+        SobolSampler(int64_t samplesPerPixel, uint32_t seed = 0) : Sampler(samplesPerPixel, seed) {}
+
+        Float Get1D() override;
+
+        Point2f Get2D() override;
+
+        std::unique_ptr<Sampler> Clone() const override;
+
+    private:
+        Float SampleDimension(int dim) const;
+    };
+}
+
+#endif //SIMPLERENDERER_SOBOL_H
@@ -0,0 +1,68 @@
+//
+// Created by 18310 on 2021/5/11.
+//
+
+#ifndef SIMPLERENDERER_SOCKET_H
+#define SIMPLERENDERER_SOCKET_H
+
+#include "sr.h"
+#include <vector>
+
+namespace sr {
+
+    //Blocking stream sockets carrying framed messages: a uint32 type, 4 bytes of padding and a uint64 payload
+    //size, then the payload. Values are in host byte order, both ends are expected to run on the same kind of
+    //machine. Functions return -1 or false and print the reason to std::cerr on failure.
+
+    //listening socket bound to a filesystem path. A stale socket file left there is replaced, but a path that
+    //is not a socket or that another process still listens on is refused
+    int ListenUnix(const std::string &path);
+
+    int ConnectUnix(const std::string &path);
+
+    //TCP with Nagle's algorithm off, host may be empty to listen on every interface
+    int ListenTCP(const std::string &host, int port);
+
+    int ConnectTCP(const std::string &host, int port);
+
+    //"tcp:<host>:<port>", "unix:<path>" or a bare path, which is a Unix socket
+    int ListenEndpoint(const std::string &endpoint);
+
+    int ConnectEndpoint(const std::string &endpoint);
+
+    //deletes the socket file of a Unix endpoint once its listener is closed
+    void RemoveEndpoint(const std::string &endpoint);
+
+    //blocks for the next client of a listening socket
+    int AcceptConnection(int listenFd);
+
+    void CloseSocket(int fd);
+
+    //receives on fd fail instead of blocking for longer than timeoutMs
+    void SetReceiveTimeout(int fd, int timeoutMs);
+
+    //sends on fd fail instead of blocking for longer than timeoutMs, e.g. when the peer stops reading
+    void SetSendTimeout(int fd, int timeoutMs);
+
+    //wakes up threads blocked on fd, AcceptConnection then fails
+    void ShutdownSocket(int fd);
+
+    //index in fds of a socket with data to read or a closed peer, -1 after timeoutMs (negative waits forever)
+    int WaitReadable(const std::vector<int> &fds, int timeoutMs);
+
+    bool SendMessage(int fd, uint32_t type, const void *payload, std::size_t size);
+
+    inline bool SendMessage(int fd, uint32_t type, const std::vector<uint8_t> &payload) {
+        return SendMessage(fd, type, payload.data(), payload.size());
+    }
+
+    //Largest payload ReceiveMessage accepts by default, well above any film tile JobTiles can produce.
+    //Receivers that only expect small requests pass a lower maxSize, so a forged header cannot make them
+    //allocate more than that.
+    static constexpr std::size_t MaxMessageSize = std::size_t(1) << 26;
+
+    //false on errors, for payloads above maxSize and when the peer closed the connection
+    bool ReceiveMessage(int fd, uint32_t *type, std::vector<uint8_t> *payload, std::size_t maxSize = MaxMessageSize);
+}
+
+#endif //SIMPLERENDERER_SOCKET_H
@@ -0,0 +1,30 @@
+//
+// Created by 18310 on 2021/5/8.
+//
+
+#ifndef SIMPLERENDERER_SPARSEGRID_H
+#define SIMPLERENDERER_SPARSEGRID_H
+
+#include "grid.h"
+#include "sparsevolume.h"
+
+namespace sr {
+    //GridDensityMedium over a memory mapped sparse volume, the majorant grid is built from the brick maxima
+    //so opening the medium reads the index and not the voxels
+    class SparseGridMedium : public GridDensityMedium {
+    public:
+        SparseGridMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g, const Transform &mediumToWorld,
+                         std::unique_ptr<SparseVolume> volume, int majorantRes = 16);
+
+        Float Density(const Point3f &p) const override { return volume->Lookup(p); }
+
+        Float MaxDensity(const Bounds3f &b) const override;
+
+        const SparseVolume &Volume() const { return *volume; }
+
+    private:
+        std::unique_ptr<SparseVolume> volume;
+    };
+}
+
+#endif //SIMPLERENDERER_SPARSEGRID_H
@@ -0,0 +1,98 @@
+//
+// Created by 18310 on 2021/5/8.
+//
+
+#ifndef SIMPLERENDERER_SPARSEVOLUME_H
+#define SIMPLERENDERER_SPARSEVOLUME_H
+
+#include "sr.h"
+#include "geometry.h"
+#include <functional>
+#include <memory>
+
+namespace sr {
+
+    //Sparse volume file (.srv): a scalar grid stored as 8^3 voxel bricks, only the non empty ones are written.
+    //Two level index: a top table over nodes of 16^3 bricks, and one table per non empty node giving the brick.
+    //  header: "SRVL" version resX resY resZ, then uint64 offsets and counts of the sections below
+    //  bricks: page aligned, 512 floats each, voxel (x, y, z) of a brick at (z * 8 + y) * 8 + x
+    //  brick max: one float per brick
+    //  top table: uint32 per node, 0 for an empty node, otherwise its node table index + 1
+    //  node tables: 16^3 uint32 each, 0 for an empty brick, otherwise its brick index + 1
+    //fillBrick gets the voxel coordinates of the brick's first voxel and writes its 512 values, returning false for
+    //a brick that is entirely zero. Voxels past the resolution are ignored.
+    //Returns false and prints the reason to std::cerr on failure.
+    bool WriteSparseVolume(const std::string &name, const Point3i &resolution,
+                           const std::function<bool(const Point3i &brickOrigin, float *voxels)> &fillBrick);
+
+    //read side of a .srv file, memory mapped so only the bricks a render touches are paged in
+    class SparseVolume {
+    public:
+        static constexpr int BrickLog2 = 3, BrickRes = 1 << BrickLog2, BrickVoxels = BrickRes * BrickRes * BrickRes;
+        static constexpr int NodeLog2 = 4, NodeRes = 1 << NodeLog2, NodeBricks = NodeRes * NodeRes * NodeRes;
+
+        //returns nullptr on failure, including sections past the end of the file and indices out of range
+        static std::unique_ptr<SparseVolume> Open(const std::string &name);
+
+        ~SparseVolume();
+
+        Point3i Resolution() const { return resolution; }
+
+        //voxel value, zero outside the grid and in empty bricks
+        Float Lookup(const Point3i &p) const {
+            const float *brick = Brick(p);
+            return brick ? brick[BrickOffset(p)] : 0;
+        }
+
+        //trilinear between voxel centers at the point p of [0, 1]^3
+        Float Lookup(const Point3f &p) const;
+
+        //bound of the voxels in b from the per brick maxima, conservative by up to a brick
+        Float MaxValue(const Bounds3i &b) const;
+
+        int64_t BrickCount() const { return nBricks; }
+
+        std::size_t MappedBytes() const { return size; }
+
+        //pages of the mapping currently in memory, from mincore
+        std::size_t ResidentBytes() const;
+
+        //process wide page fault counts from getrusage
+        static void PageFaults(int64_t *minor, int64_t *major);
+
+    private:
+        SparseVolume() {}
+
+        static int BrickOffset(const Point3i &p) {
+            return (((p.z & (BrickRes - 1)) << BrickLog2 | (p.y & (BrickRes - 1))) << BrickLog2) |
+                   (p.x & (BrickRes - 1));
+        }
+
+        int BrickIndex(int bx, int by, int bz) const {
+            int nx = bx >> NodeLog2, ny = by >> NodeLog2, nz = bz >> NodeLog2;
+            uint32_t node = top[(nz * nodes.y + ny) * nodes.x + nx];
+            if (node == 0) return -1;
+            int local = (((bz & (NodeRes - 1)) << NodeLog2 | (by & (NodeRes - 1))) << NodeLog2) | (bx & (NodeRes - 1));
+            return int(nodeTables[int64_t(node - 1) * NodeBricks + local]) - 1;
+        }
+
+        const float *Brick(const Point3i &p) const {
+            if (p.x < 0 || p.y < 0 || p.z < 0 || p.x >= resolution.x || p.y >= resolution.y || p.z >= resolution.z)
+                return nullptr;
+            int b = BrickIndex(p.x >> BrickLog2, p.y >> BrickLog2, p.z >> BrickLog2);
+            return b < 0 ? nullptr : bricks + int64_t(b) * BrickVoxels;
+        }
+
+        Point3i resolution, nodes;
+        int64_t nBricks = 0;
+        //views into the mapping
+        const float *bricks = nullptr, *brickMax = nullptr;
+        const uint32_t *top = nullptr, *nodeTables = nullptr;
+        //the mapping, or a heap copy where mmap is not available
+        void *data = nullptr;
+        std::size_t size = 0;
+        bool mapped = false;
+    };
+}
+
+#endif //SIMPLERENDERER_SPARSEVOLUME_H
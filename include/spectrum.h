@@ -6,7 +6,9 @@
 #define SIMPLERENDERER_SPECTRUM_H
 
 #include "sr.h"
+#include "stats.h"
 #include <vector>
+#include <utility>
 
 namespace sr {
 
@@ -32,6 +34,12 @@ namespace sr {
 
     extern Float InterpolateSpectrumSamples(const Float *lambda, const Float *v, int n, Float l);
 
+    //Planck's law, lambda in nm, Le is the emitted radiance at temperature T (kelvin)
+    extern void Blackbody(const Float *lambda, int n, Float T, Float *Le);
+
+    //blackbody emission scaled so that its peak wavelength has value 1
+    extern void BlackbodyNormalized(const Float *lambda, int n, Float T, Float *Le);
+
     //samples' wavelengths and lambda
     static const int nRGB2SpectSamples = 32;
     extern const Float RGB2SpectLambda[nRGB2SpectSamples];
@@ -81,24 +89,38 @@ namespace sr {
         template<int n>
         friend inline CoefficientSpectrum<n> Pow(CoefficientSpectrum<n> &cs, Float e);
 
+        //compact storage decodes straight into c
+        template<int n>
+        friend class HalfSpectrum;
+
     public:
 
         static const int nSamples = nSpectrumSamples;
 
         CoefficientSpectrum(Float v = 0.0f) {
-            assert(!std::isnan(v));
+            SR_VALIDATE(!std::isnan(v));
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 c[i] = v;
             }
         }
 
         CoefficientSpectrum(const CoefficientSpectrum &cs) {
-            assert(!cs.HasNans());
+            SR_VALIDATE(!cs.HasNans());
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 c[i] = cs[i];
             }
         }
 
+        //v holds one value per coefficient, for code that works on the coefficients of any representation
+        static CoefficientSpectrum FromCoefficients(const Float *v) {
+            CoefficientSpectrum res;
+            for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
+                res.c[i] = v[i];
+            }
+            SR_VALIDATE(!res.HasNans());
+            return res;
+        }
+
         bool HasNans() const {
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 if (std::isnan(c[i])) {
@@ -127,15 +149,15 @@ namespace sr {
         }
 
         CoefficientSpectrum &operator+=(const CoefficientSpectrum &cs) {
-            assert(!cs.HasNans());
+            SR_VALIDATE(!cs.HasNans());
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 c[i] += cs[i];
             }
             return *this;
         }
 
-        CoefficientSpectrum operator+(const CoefficientSpectrum &cs) {
-            assert(!cs.HasNans());
+        CoefficientSpectrum operator+(const CoefficientSpectrum &cs) const {
+            SR_VALIDATE(!cs.HasNans());
             CoefficientSpectrum res = *this;
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 res.c[i] += cs[i];
@@ -144,18 +166,19 @@ namespace sr {
         }
 
         CoefficientSpectrum &operator-=(const CoefficientSpectrum &cs) {
-            assert(!cs.HasNans());
+            SR_VALIDATE(!cs.HasNans());
             *this += -cs;
             return *this;
         }
 
         CoefficientSpectrum operator-(const CoefficientSpectrum &cs) const {
-            assert(!cs.HasNans());
-            return *this += -cs;
+            SR_VALIDATE(!cs.HasNans());
+            CoefficientSpectrum res = *this;
+            return res += -cs;
         }
 
         CoefficientSpectrum &operator*=(const CoefficientSpectrum &cs) {
-            assert(!cs.HasNans());
+            SR_VALIDATE(!cs.HasNans());
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 c[i] *= cs[i];
             }
@@ -163,16 +186,16 @@ namespace sr {
         }
 
         CoefficientSpectrum operator*(const CoefficientSpectrum &cs) const {
-            assert(!cs.HasNans());
+            SR_VALIDATE(!cs.HasNans());
             CoefficientSpectrum res = *this;
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
-                res[i] = c[i] * cs[i];
+                res.c[i] = c[i] * cs[i];
             }
             return res;
         }
 
         CoefficientSpectrum &operator*=(Float t) {
-            assert(!std::isnan(t));
+            SR_VALIDATE(!std::isnan(t));
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 c[i] *= t;
             }
@@ -180,7 +203,7 @@ namespace sr {
         }
 
         CoefficientSpectrum operator*(Float t) const {
-            assert(!std::isnan(t));
+            SR_VALIDATE(!std::isnan(t));
             CoefficientSpectrum res = *this;
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
                 res.c[i] = c[i] * t;
@@ -189,19 +212,19 @@ namespace sr {
         }
 
         friend CoefficientSpectrum operator*(Float t, const CoefficientSpectrum &cs) {
-            assert(!std::isnan(t) && !cs.HasNans());
+            SR_VALIDATE(!std::isnan(t) && !cs.HasNans());
             return cs * t;
         }
 
         CoefficientSpectrum &operator/=(Float t) {
-            assert(!std::isnan(t) && t != 0);
+            SR_VALIDATE(!std::isnan(t) && t != 0);
             Float invt = 1.0f / t;
             *this *= invt;
             return *this;
         }
 
         CoefficientSpectrum operator/(Float t) const {
-            assert(!std::isnan(t) && t != 0);
+            SR_VALIDATE(!std::isnan(t) && t != 0);
             Float invt = 1.0f / t;
             return *this * invt;
         }
@@ -234,6 +257,12 @@ namespace sr {
             return true;
         }
 
+        Float MaxComponentValue() const {
+            Float m = c[0];
+            for (std::size_t i = 1; i < nSpectrumSamples; ++i) m = std::max(m, c[i]);
+            return m;
+        }
+
         CoefficientSpectrum Clamp(Float low = 0, Float high = Infinity) const {
             CoefficientSpectrum res;
             for (std::size_t i = 0; i < nSpectrumSamples; ++i) {
@@ -255,7 +284,7 @@ namespace sr {
         for (std::size_t i = 0; i < n; ++i) {
             res.c[i] = std::sqrt(cs[i]);
         }
-        assert(!res.HasNans());
+        SR_VALIDATE(!res.HasNans());
         return res;
     }
 
@@ -265,7 +294,7 @@ namespace sr {
         for (std::size_t i = 0; i < n; ++i) {
             res.c[i] = std::exp(cs[i]);
         }
-        assert(!res.HasNans());
+        SR_VALIDATE(!res.HasNans());
         return res;
     }
 
@@ -275,7 +304,7 @@ namespace sr {
         for (std::size_t i = 0; i < n; ++i) {
             res.c[i] = std::pow(cs[i], e);
         }
-        assert(!res.HasNans());
+        SR_VALIDATE(!res.HasNans());
         return res;
     }
 
@@ -297,7 +326,7 @@ namespace sr {
         static SampledSpectrum FromSampled(const Float *lambda, const Float *v, int n);
 
         //initialize X, Y, Z, rgb illuminant spectrum and rgb reflectance spectrum
-        //use Spectrum::Init() when using PBRT::Init()
+        //only the first call does the work, later calls return once it is done
         static void Init();
 
         //From X, Y, Z spectrum to xyz coefficient
@@ -315,8 +344,18 @@ namespace sr {
 
         RGBSpectrum ToRGBSpectrum() const;
 
+        //bulk conversion of n contiguous spectra, xyz and rgb hold n interleaved triples, runs Init() first
+        static void ToXYZ(const SampledSpectrum *s, int64_t n, Float *xyz);
+
+        static void ToRGB(const SampledSpectrum *s, int64_t n, Float *rgb);
+
     private:
+        static void InitTables();
+
         static SampledSpectrum X, Y, Z;
+        //X, Y, Z premultiplied by the integration scale and the XYZ to RGB matrix,
+        //so that ToRGB is a single dot product per channel
+        static SampledSpectrum rgbR, rgbG, rgbB;
         static SampledSpectrum rgbRefl2SpectWhite, rgbRefl2SpectCyan, rgbRefl2SpectMagenta, rgbRefl2SpectYellow;
         static SampledSpectrum rgbRefl2SpectRed, rgbRefl2SpectGreen, rgbRefl2SpectBlue;
 
@@ -329,7 +368,7 @@ namespace sr {
     public:
         RGBSpectrum(Float v = 0.0f) : CoefficientSpectrum<3>(v) {}
 
-        RGBSpectrum(CoefficientSpectrum<3> &v) : CoefficientSpectrum<3>(v) {}
+        RGBSpectrum(const CoefficientSpectrum<3> &v) : CoefficientSpectrum<3>(v) {}
 
         static RGBSpectrum FromRGB(const Float rgb[3], SpectrumType type = SpectrumType::Reflectance);
 
@@ -348,5 +387,38 @@ namespace sr {
 
     };
 
+    //Spectral representation chosen at scene load. Spectrum (sr.h) stays the compile-time default for
+    //code that is not templated on the representation.
+    enum class SpectrumRepresentation {
+        RGB, Sampled
+    };
+
+    //accepts "rgb" and "sampled", returns false for anything else
+    bool ParseSpectrumRepresentation(const std::string &name, SpectrumRepresentation *rep);
+
+    const char *SpectrumRepresentationName(SpectrumRepresentation rep);
+
+    //Render kernels are class templates on the spectrum type exposing a static Run(...). Every
+    //representation gets its own instantiation with fully inlined spectrum arithmetic; this picks one
+    //at runtime and sets up the sampled tables before the first sampled kernel runs, e.g.
+    //  DispatchSpectrum<GuidedPathKernel>(options.spectrum, integrator, scene, samplers);
+    template<template<typename> class Kernel, typename... Args>
+    inline auto DispatchSpectrum(SpectrumRepresentation rep, Args &&... args)
+    -> decltype(Kernel<RGBSpectrum>::Run(std::forward<Args>(args)...)) {
+        switch (rep) {
+            case SpectrumRepresentation::Sampled:
+                SampledSpectrum::Init();
+                return Kernel<SampledSpectrum>::Run(std::forward<Args>(args)...);
+            case SpectrumRepresentation::RGB:
+            default:
+                return Kernel<RGBSpectrum>::Run(std::forward<Args>(args)...);
+        }
+    }
+
+    //resolve a whole spectral framebuffer of xRes * yRes pixels, rows are converted in parallel
+    void SpectralImageToXYZ(const SampledSpectrum *pixels, int xRes, int yRes, Float *xyz);
+
+    void SpectralImageToRGB(const SampledSpectrum *pixels, int xRes, int yRes, Float *rgb);
+
 }
 #endif //SIMPLERENDERER_SPECTRUM_H
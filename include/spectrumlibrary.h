@@ -0,0 +1,49 @@
+//
+// Created by 18310 on 2021/4/14.
+//
+
+#ifndef SIMPLERENDERER_SPECTRUMLIBRARY_H
+#define SIMPLERENDERER_SPECTRUMLIBRARY_H
+
+#include "spectrum.h"
+#include <vector>
+
+namespace sr {
+
+    //Measured spectra (metal IORs, illuminants, blackbodies...) resampled once onto the render's grid.
+    //Entries are keyed by a hash of the raw samples, so the same data referenced by many materials
+    //is sorted and resampled only the first time. A hash hit only counts when the stored samples
+    //match as well. Returned entries are never moved or freed.
+    class SpectrumLibrary {
+    public:
+        struct Entry {
+            uint64_t hash;
+            //the samples as added, compared on a hash hit
+            std::vector<Float> lambda, v;
+            SampledSpectrum sampled;
+            RGBSpectrum rgb;
+        };
+
+        static uint64_t HashSamples(const Float *lambda, const Float *v, int n);
+
+        //returns the cached entry if the same samples were added before
+        static const Entry &Add(const Float *lambda, const Float *v, int n);
+
+        //also makes the entry reachable by name, a name can be rebound to other data
+        static const Entry &Add(const std::string &name, const Float *lambda, const Float *v, int n);
+
+        //normalized blackbody emission at temperature T (kelvin), named "blackbody:<T>" with T printed as %a
+        //nullptr if T is not a positive temperature
+        static const Entry *AddBlackbody(Float T);
+
+        //nullptr if nothing was registered
+        static const Entry *Find(const std::string &name);
+
+        //an entry added with this hash, the samples of colliding entries tell them apart
+        static const Entry *Find(uint64_t hash);
+
+        static std::size_t Size();
+    };
+}
+
+#endif //SIMPLERENDERER_SPECTRUMLIBRARY_H
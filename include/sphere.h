@@ -20,14 +20,16 @@ namespace sr{
                                                        thetaMax(std::acos(Clamp(zMax / radius, -1, 1))) {}
         Bounds3f ObjectBound() const override;
 
-        bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect, bool testAlphaTexture = true) const override;
+        bool IntersectHit(const Ray &ray, HitRecord *hit, bool testAlphaTexture = true) const override;
+
+        void ComputeObjectInteraction(const Ray &ray, const HitRecord &hit, SurfaceInteraction *isect) const override;
 
         Float Area() const override;
 
     private:
         const Float radius;
         const Float zMin, zMax;
-        const Float thetaMin, thetaMax, phiMax;
+        const Float phiMax, thetaMin, thetaMax;
     };
 }
 
@@ -0,0 +1,39 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#ifndef SIMPLERENDERER_SPOT_H
+#define SIMPLERENDERER_SPOT_H
+
+#include "light.h"
+
+namespace sr {
+    //point light shining down light space +z, full intensity inside falloffStart and none past totalWidth (degrees)
+    class SpotLight : public Light {
+    public:
+        SpotLight(const Transform &LightToWorld, const MediumInterface &mediumInterface, const Spectrum &I,
+                  Float totalWidth, Float falloffStart);
+
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           VisibilityTester *vis) const override;
+
+        Float Pdf_Li(const Interaction &ref, const Vector3f &wi) const override;
+
+        Spectrum Sample_Le(const Point2f &u1, const Point2f &u2, Float time, Ray *ray, Normal3f *nLight,
+                           Float *pdfPos, Float *pdfDir) const override;
+
+        Spectrum Power() const override;
+
+        bool Bounds(LightBounds *bounds) const override;
+
+        //w is in world space, pointing away from the light
+        Float Falloff(const Vector3f &w) const;
+
+    private:
+        const Point3f pLight;
+        const Spectrum I;
+        const Float cosTotalWidth, cosFalloffStart;
+    };
+}
+
+#endif //SIMPLERENDERER_SPOT_H
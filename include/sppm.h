@@ -0,0 +1,48 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#ifndef SIMPLERENDERER_SPPM_H
+#define SIMPLERENDERER_SPPM_H
+
+#include "sr.h"
+#include "camera.h"
+#include "sampler.h"
+#include "scene.h"
+#include <memory>
+
+namespace sr {
+    //Stochastic progressive photon mapping. Every iteration
+    //  1. traces one camera path per pixel through specular bounces to its first diffuse hit, the visible point,
+    //     and adds direct lighting there,
+    //  2. inserts the visible points into a hashed uniform grid over their bounds, cells sized by the largest
+    //     search radius, with lock-free pushes onto per cell lists,
+    //  3. traces photonsPerIteration photon paths from the lights, each hit after the first bounce adds its flux
+    //     to the visible points within their radius with atomic adds,
+    //  4. shrinks every radius from the photons it received, keeping alpha = 2/3 of the new ones.
+    //Caustics seen directly or through specular surfaces converge without the variance of path tracing.
+    //Photon indices are distributed over threads with ParallelFor, the grid is read only during step 3.
+    class SPPMIntegrator {
+    public:
+        //sampler is a prototype cloned per thread, initialSearchRadius is in world units
+        SPPMIntegrator(std::shared_ptr<const Camera> camera, std::unique_ptr<Sampler> sampler, int nIterations,
+                       int photonsPerIteration, int maxDepth, Float initialSearchRadius);
+
+        void Render(const Scene &scene);
+
+        //photon paths traced by the last Render and the seconds it spent in photon passes
+        int64_t PhotonPaths() const { return photonPaths; }
+
+        double PhotonSeconds() const { return photonSeconds; }
+
+    private:
+        std::shared_ptr<const Camera> camera;
+        std::unique_ptr<Sampler> samplerPrototype;
+        const int nIterations, photonsPerIteration, maxDepth;
+        const Float initialSearchRadius;
+        int64_t photonPaths = 0;
+        double photonSeconds = 0;
+    };
+}
+
+#endif //SIMPLERENDERER_SPPM_H
@@ -13,6 +13,8 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <limits>
+#include <cstdint>
 
 namespace sr {
 
@@ -35,6 +37,21 @@ namespace sr {
     static constexpr Float MaxFloat = std::numeric_limits<Float>::max();
     static constexpr Float MinFloat = std::numeric_limits<Float>::min();
     static constexpr Float Infinity = std::numeric_limits<Float>::infinity();
+    //half an ulp of 1, bounds the relative rounding error of one operation
+    static constexpr Float MachineEpsilon = std::numeric_limits<Float>::epsilon() * 0.5;
+
+    //conservative bound (1 + eps)^n - 1 on the error of n operations
+    inline constexpr Float gamma(int n) { return (n * MachineEpsilon) / (1 - n * MachineEpsilon); }
+
+    //fraction of a shadow ray left unchecked in front of its target
+    static constexpr Float ShadowEpsilon = 0.0001;
+
+    //largest Float below 1, samples are kept inside [0, 1)
+#ifdef SIMPLERENDERER_FLOAT_AS_DOUBLE
+    static constexpr Float OneMinusEpsilon = 0.99999999999999989;
+#else
+    static constexpr Float OneMinusEpsilon = 0.99999994f;
+#endif
 
 
     // class
@@ -75,6 +92,8 @@ namespace sr {
 
     class SurfaceInteraction;
 
+    class ShadingFrame;
+
     class Shape;
 
     template<int nSpectrumSamples>
@@ -88,7 +107,7 @@ namespace sr {
 
     //functions
     //Lerp of two values
-    inline Float Lerp(Float t, Float v1, Float v2) { return (1 - t) * v1 + v2; }
+    inline Float Lerp(Float t, Float v1, Float v2) { return (1 - t) * v1 + t * v2; }
 
     //solve quadratic equation: at²+bt+c=0
     inline bool Quadratic(Float a, Float b, Float c, Float *t0, Float *t1){
@@ -120,12 +139,44 @@ namespace sr {
         return val < lo ? lo : (val > hi ? hi : val);
     }
 
+    //sqrt and inverse trigonometric functions tolerant of arguments slightly out of range by rounding error
+    inline Float SafeSqrt(Float x) { return std::sqrt(std::max(x, Float(0))); }
+
+    inline Float SafeASin(Float x) { return std::asin(Clamp(x, -1, 1)); }
+
+    inline Float SafeACos(Float x) { return std::acos(Clamp(x, -1, 1)); }
+
     //log2(x) function
     inline Float Log2(Float x) {
         const Float invLog2 = 1.442695040888963387004650940071;
         return std::log(x) * invLog2;
     }
 
+    //floor(log2(v)), v > 0
+    inline int Log2Int(uint64_t v) {
+        int res = 0;
+        while (v >>= 1) ++res;
+        return res;
+    }
+
+    //index of the lowest set bit, v > 0
+    inline int CountTrailingZeros(uint32_t v) {
+#if defined(__GNUC__)
+        return __builtin_ctz(v);
+#else
+        int res = 0;
+        for (; !(v & 1); v >>= 1) ++res;
+        return res;
+#endif
+    }
+
+    inline bool IsPowerOf2(uint64_t v) { return v && !(v & (v - 1)); }
+
+    inline uint64_t RoundUpPow2(uint64_t v) {
+        if (v <= 1) return 1;
+        return uint64_t(1) << (Log2Int(v - 1) + 1);
+    }
+
     template<typename Predicate>
     inline int FindInterval(int size, const Predicate &pred) {
         int first = 0, len = size;
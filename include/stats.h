@@ -0,0 +1,101 @@
+//
+// Created by 18310 on 2021/4/18.
+//
+
+#ifndef SIMPLERENDERER_STATS_H
+#define SIMPLERENDERER_STATS_H
+
+#include "sr.h"
+#include <atomic>
+
+#ifndef SIMPLERENDERER_VALIDATION_LEVEL
+#define SIMPLERENDERER_VALIDATION_LEVEL 2
+#endif
+
+#ifndef SIMPLERENDERER_VALIDATION_SAMPLE_RATE
+#define SIMPLERENDERER_VALIDATION_SAMPLE_RATE 64
+#endif
+
+namespace sr {
+
+    //Statistics channel: named counters and per call site validation failures, printed by PrintStats.
+    //Counters register themselves on construction and live until exit, declare them static.
+    class StatCounter {
+    public:
+        explicit StatCounter(const char *title);
+
+        void Add(int64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+
+        StatCounter &operator++() {
+            Add();
+            return *this;
+        }
+
+        int64_t Value() const { return value.load(std::memory_order_relaxed); }
+
+        void Reset() { value.store(0, std::memory_order_relaxed); }
+
+        const char *Title() const { return title; }
+
+    private:
+        const char *title;
+        std::atomic<int64_t> value;
+    };
+
+    //one per SR_VALIDATE expression, only constructed the first time that check fails
+    class ValidationSite {
+    public:
+        ValidationSite(const char *expr, const char *file, int line);
+
+        void Report() { failures.fetch_add(1, std::memory_order_relaxed); }
+
+        const char *expr, *file;
+        int line;
+        std::atomic<int64_t> failures;
+    };
+
+    //counters that are not zero, then the total and per site counts of validation failures if there were any
+    void PrintStats(std::ostream &out);
+
+    void ClearStats();
+
+    //sum of the counters titled title, 0 if there are none
+    int64_t StatCounterValue(const std::string &title);
+
+    //sum over every call site
+    int64_t ValidationFailureCount();
+
+    //counter used by SR_VALIDATE in sampled mode, one check per SIMPLERENDERER_VALIDATION_SAMPLE_RATE per thread
+    inline bool ValidationSampleThisCheck() {
+        static thread_local uint32_t count = 0;
+        return ++count % SIMPLERENDERER_VALIDATION_SAMPLE_RATE == 0;
+    }
+}
+
+#define SR_STAT_COUNTER(title, var) static sr::StatCounter var(title)
+
+//Validation levels (SIMPLERENDERER_VALIDATION_LEVEL, set from CMake's SR_VALIDATION_LEVEL):
+//  0 off: checks compile to nothing, the expression is not evaluated
+//  1 sampled: every thread evaluates one in SIMPLERENDERER_VALIDATION_SAMPLE_RATE checks
+//  2 full: every check is evaluated
+//Failures are counted per call site instead of aborting, see PrintStats.
+#define SR_VALIDATE_REPORT(cond)                                                        \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            static sr::ValidationSite validationSite(#cond, __FILE__, __LINE__);        \
+            validationSite.Report();                                                    \
+        }                                                                               \
+    } while (false)
+
+#if SIMPLERENDERER_VALIDATION_LEVEL == 0
+#define SR_VALIDATE(cond) ((void)0)
+#elif SIMPLERENDERER_VALIDATION_LEVEL == 1
+#define SR_VALIDATE(cond)                                                               \
+    do {                                                                                \
+        if (sr::ValidationSampleThisCheck()) SR_VALIDATE_REPORT(cond);                  \
+    } while (false)
+#else
+#define SR_VALIDATE(cond) SR_VALIDATE_REPORT(cond)
+#endif
+
+#endif //SIMPLERENDERER_STATS_H
@@ -0,0 +1,183 @@
+//
+// Created by 18310 on 2021/4/29.
+//
+
+#ifndef SIMPLERENDERER_TEXTURECACHE_H
+#define SIMPLERENDERER_TEXTURECACHE_H
+
+#include "sr.h"
+#include "geometry.h"
+#include "spectrum.h"
+#include "compactspectrum.h"
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLERENDERER_HAVE_PREAD
+#endif
+
+namespace sr {
+
+    //Tiled texture file (.srt): a MIP pyramid cut into fixed size square tiles of float rgb,
+    //so any tile of any level can be read with one positioned read. Offsets are 64 bit.
+    //  header: "SRTX" version width height tileSize nLevels (uint32 each)
+    //  then every level from the finest, tiles row major, edge tiles padded to full size
+    //rgb is laid out as in WriteImage. Returns false and prints the reason to std::cerr on failure.
+    bool WriteTiledImage(const std::string &name, const Float *rgb, const Point2i &resolution, int tileSize = 64);
+
+    struct TextureTile {
+        //tileSize * tileSize rgb texels, kept as half floats so the cache budget holds twice the tiles
+        std::vector<HalfSpectrum<3>> texels;
+
+        std::size_t Bytes() const { return texels.size() * sizeof(HalfSpectrum<3>); }
+    };
+
+    //read side of a .srt file, tiles are read on demand and concurrently with pread where available
+    class TiledImage {
+    public:
+        //returns nullptr on failure
+        static std::unique_ptr<TiledImage> Open(const std::string &name);
+
+        ~TiledImage();
+
+        bool ReadTile(int level, const Point2i &tile, TextureTile *out) const;
+
+        int Levels() const { return int(levels.size()); }
+
+        Point2i LevelResolution(int level) const { return levels[level].resolution; }
+
+        Point2i LevelTiles(int level) const { return levels[level].tiles; }
+
+        int TileSize() const { return tileSize; }
+
+        //bytes of a tile in the file, float rgb
+        std::size_t TileBytes() const { return std::size_t(3) * tileSize * tileSize * sizeof(float); }
+
+    private:
+        struct Level {
+            Point2i resolution, tiles;
+            int64_t offset;
+        };
+
+        TiledImage() {}
+
+        //false unless all bytes were read
+        bool ReadAt(int64_t offset, void *data, std::size_t bytes) const;
+
+        std::string name;
+#ifdef SIMPLERENDERER_HAVE_PREAD
+        int fd = -1;
+#else
+        FILE *fp = nullptr;
+        //file position is shared, reads are serialized per file
+        mutable std::mutex ioMutex;
+#endif
+        int tileSize = 0;
+        std::vector<Level> levels;
+    };
+
+    //Texture tile cache with a hard memory budget.
+    //Tiles live in nShards shards, each holding at most maxBytes / nShards. A shard is a chained hash that hits
+    //read without a lock: readers only register in the shard's reader count for the current epoch, and evicted
+    //nodes are deleted once every reader that could still reach them has left. Misses take the shard's mutex
+    //to insert and to evict with the clock algorithm, an LRU approximation in which a hit only sets a flag.
+    //Every thread also keeps a small direct mapped cache of the tiles it touched last.
+    //Thread cache references and evicted nodes awaiting deletion may keep a few tiles alive beyond the budget.
+    //Counters: "Texture cache/..." in PrintStats.
+    class TextureCache {
+    public:
+        TextureCache(std::size_t maxBytes, int nShards = 16);
+
+        ~TextureCache();
+
+        //returns the texture id, -1 on failure. Add textures before lookups start, this is not thread safe
+        int AddTexture(const std::string &filename);
+
+        int Levels(int texture) const { return images[texture]->Levels(); }
+
+        //nullptr when the tile cannot be read
+        std::shared_ptr<const TextureTile> GetTile(int texture, int level, const Point2i &tile);
+
+        //repeat wrapping
+        RGBSpectrum Texel(int texture, int level, const Point2i &st);
+
+        RGBSpectrum Bilerp(int texture, int level, const Point2f &st);
+
+        //trilinear lookup, width is the footprint in [0, 1] texture space
+        RGBSpectrum Lookup(int texture, const Point2f &st, Float width);
+
+        //footprint from the interaction's uv differentials
+        RGBSpectrum Lookup(int texture, const SurfaceInteraction &si);
+
+        std::size_t ResidentBytes() const;
+
+        const std::size_t maxBytes;
+
+    private:
+        struct Node {
+            uint64_t key;
+            std::shared_ptr<const TextureTile> tile;
+            std::atomic<Node *> next;
+            //set by hits, cleared by the clock hand
+            std::atomic<bool> referenced;
+        };
+
+        struct Shard {
+            //taken by misses only
+            std::mutex mutex;
+            std::unique_ptr<std::atomic<Node *>[]> buckets;
+            uint64_t nBuckets = 0;
+            //resident nodes, the clock hand sweeps from the front
+            std::deque<Node *> clock;
+            std::size_t bytes = 0;
+            //readers in flight per epoch parity
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<int> readers[2] = {{0}, {0}};
+            //unlinked nodes: retired since the last epoch flip, and waiting for the readers of the old epoch
+            std::vector<Node *> retired, waiting;
+            int waitingParity = 0;
+
+            ~Shard();
+
+            //registers a reader in the current epoch, returns the parity to leave with
+            int EnterRead() {
+                while (true) {
+                    uint64_t e = epoch.load();
+                    readers[e & 1].fetch_add(1);
+                    if (epoch.load() == e) return int(e & 1);
+                    readers[e & 1].fetch_sub(1);
+                }
+            }
+
+            void LeaveRead(int parity) { readers[parity].fetch_sub(1); }
+
+            //caller holds mutex, deletes waiting nodes once their readers left and starts a new epoch for retired ones
+            void Reclaim();
+        };
+
+        static uint64_t TileKey(int texture, int level, const Point2i &tile) {
+            return (uint64_t(texture) << 48) | (uint64_t(level) << 40) | (uint64_t(tile.y) << 20) | uint64_t(tile.x);
+        }
+
+        //level is continuous, blends the two nearest levels
+        RGBSpectrum LookupLevel(int texture, const Point2f &st, Float level);
+
+        std::shared_ptr<const TextureTile> LoadTile(int texture, int level, const Point2i &tile, uint64_t key);
+
+        Shard &ShardOf(uint64_t key) const;
+
+        std::atomic<Node *> &BucketOf(const Shard &shard, uint64_t key) const;
+
+        //distinguishes caches in the per thread tile cache
+        const uint64_t cacheId;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::size_t shardBytes;
+        std::vector<std::unique_ptr<TiledImage>> images;
+    };
+}
+
+#endif //SIMPLERENDERER_TEXTURECACHE_H
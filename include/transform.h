@@ -49,6 +49,8 @@ namespace sr{
 
         inline Ray operator()(const Ray& r) const;
 
+        inline RayDifferentials operator()(const RayDifferentials& r) const;
+
         //template function's definition and declaration must be inside one .h file
         //or leads to linking error!
         template<typename T>
@@ -72,6 +74,9 @@ namespace sr{
     Transform Rotate(Float theta, const Vector3f& axis);
     //Change from world coordinate to camera coordinate
     Transform LookAt(const Point3f& pos, const Point3f& look, const Vector3f& up);
+    //camera space to [-1, 1]² screen space, z mapped to [0, 1] between near and far plane
+    Transform Orthographic(Float zNear, Float zFar);
+    Transform Perspective(Float fov, Float zNear, Float zFar);
 
 
     template<typename T>
@@ -94,18 +99,27 @@ namespace sr{
     }
 
 
+    //normals transform by the inverse transpose, read straight from mInv's columns
     template<typename T>
     Normal3<T> Transform::operator()(const Normal3<T> &n) const {
-        Matrix4x4 nm = Transpose(mInv);
         T x = n.x, y = n.y, z = n.z;
-        return Normal3<T>(nm.m[0][0] * x + nm.m[0][1] * y + nm.m[0][2] * z,
-                          nm.m[1][0] * x + nm.m[1][1] * y + nm.m[1][2] * z,
-                          nm.m[2][0] * x + nm.m[2][1] * y + nm.m[2][2] * z);
+        return Normal3<T>(mInv.m[0][0] * x + mInv.m[1][0] * y + mInv.m[2][0] * z,
+                          mInv.m[0][1] * x + mInv.m[1][1] * y + mInv.m[2][1] * z,
+                          mInv.m[0][2] * x + mInv.m[1][2] * y + mInv.m[2][2] * z);
     }
 
-    //todo
     Ray Transform::operator()(const Ray &r) const {
-        return r;
+        return Ray((*this)(r.o), (*this)(r.d), r.tMax, r.time, r.medium);
+    }
+
+    RayDifferentials Transform::operator()(const RayDifferentials &r) const {
+        RayDifferentials res((*this)(Ray(r)));
+        res.hasDifferentials = r.hasDifferentials;
+        res.rxOrigin = (*this)(r.rxOrigin);
+        res.ryOrigin = (*this)(r.ryOrigin);
+        res.rxDirection = (*this)(r.rxDirection);
+        res.ryDirection = (*this)(r.ryDirection);
+        return res;
     }
 
     template<typename T>
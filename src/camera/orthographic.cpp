@@ -0,0 +1,88 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#include "orthographic.h"
+#include "sampling.h"
+
+namespace sr {
+
+    OrthographicCamera::OrthographicCamera(const Transform &cameraToWorld, const Bounds2f &screenWindow,
+                                           Float shutterOpen, Float shutterClose, Float lensRadius,
+                                           Float focalDistance, Film *film, const Medium *medium)
+            : ProjectiveCamera(cameraToWorld, Orthographic(0, 1), screenWindow, shutterOpen, shutterClose,
+                               lensRadius, focalDistance, film, medium) {}
+
+    Float OrthographicCamera::GenerateRay(const CameraSample &sample, Ray *ray) const {
+        Point3f o = pWorld0 + sample.pFilm.x * dxWorld + sample.pFilm.y * dyWorld;
+        Vector3f d = forwardWorld;
+        if (lensRadius > 0) {
+            Point2f pLens = ConcentricSampleDisk(sample.pLens);
+            Vector3f offset = pLens.x * lensU + pLens.y * lensV;
+            d = Normalize(focalDistance * forwardWorld - offset);
+            o += offset;
+        }
+        *ray = Ray(o, d, Infinity, SampleTime(sample.time), medium);
+        return 1;
+    }
+
+    Float OrthographicCamera::GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const {
+        Point3f o = pWorld0 + sample.pFilm.x * dxWorld + sample.pFilm.y * dyWorld;
+        Vector3f d = forwardWorld;
+        if (lensRadius > 0) {
+            Point2f pLens = ConcentricSampleDisk(sample.pLens);
+            Vector3f offset = pLens.x * lensU + pLens.y * lensV;
+            d = Normalize(focalDistance * forwardWorld - offset);
+            o += offset;
+        }
+        *rd = RayDifferentials(o, d, Infinity, SampleTime(sample.time), medium);
+        rd->rxOrigin = o + dxWorld;
+        rd->ryOrigin = o + dyWorld;
+        rd->rxDirection = rd->ryDirection = d;
+        rd->hasDifferentials = true;
+        return 1;
+    }
+
+    RayCone OrthographicCamera::GeneratePixelCone() const {
+        return RayCone(dxWorld.Length(), 0);
+    }
+
+    void OrthographicCamera::GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays,
+                                          int64_t offset) const {
+        assert(offset + n <= int64_t(rays->Size()));
+        Float *ox = &rays->ox[offset], *oy = &rays->oy[offset], *oz = &rays->oz[offset];
+        Float *dx = &rays->dx[offset], *dy = &rays->dy[offset], *dz = &rays->dz[offset];
+        Float *time = &rays->time[offset];
+        if (lensRadius > 0) {
+            for (int64_t i = 0; i < n; ++i) {
+                const CameraSample &s = samples[i];
+                Point2f pLens = ConcentricSampleDisk(s.pLens);
+                Float offX = pLens.x * lensU.x + pLens.y * lensV.x;
+                Float offY = pLens.x * lensU.y + pLens.y * lensV.y;
+                Float offZ = pLens.x * lensU.z + pLens.y * lensV.z;
+                Float x = focalDistance * forwardWorld.x - offX;
+                Float y = focalDistance * forwardWorld.y - offY;
+                Float z = focalDistance * forwardWorld.z - offZ;
+                Float invLen = 1 / std::sqrt(x * x + y * y + z * z);
+                ox[i] = pWorld0.x + s.pFilm.x * dxWorld.x + s.pFilm.y * dyWorld.x + offX;
+                oy[i] = pWorld0.y + s.pFilm.x * dxWorld.y + s.pFilm.y * dyWorld.y + offY;
+                oz[i] = pWorld0.z + s.pFilm.x * dxWorld.z + s.pFilm.y * dyWorld.z + offZ;
+                dx[i] = x * invLen;
+                dy[i] = y * invLen;
+                dz[i] = z * invLen;
+                time[i] = SampleTime(s.time);
+            }
+        } else {
+            for (int64_t i = 0; i < n; ++i) {
+                const CameraSample &s = samples[i];
+                ox[i] = pWorld0.x + s.pFilm.x * dxWorld.x + s.pFilm.y * dyWorld.x;
+                oy[i] = pWorld0.y + s.pFilm.x * dxWorld.y + s.pFilm.y * dyWorld.y;
+                oz[i] = pWorld0.z + s.pFilm.x * dxWorld.z + s.pFilm.y * dyWorld.z;
+                dx[i] = forwardWorld.x;
+                dy[i] = forwardWorld.y;
+                dz[i] = forwardWorld.z;
+                time[i] = SampleTime(s.time);
+            }
+        }
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#include "perspective.h"
+#include "sampling.h"
+
+namespace sr {
+
+    PerspectiveCamera::PerspectiveCamera(const Transform &cameraToWorld, const Bounds2f &screenWindow,
+                                         Float shutterOpen, Float shutterClose, Float lensRadius,
+                                         Float focalDistance, Float fov, Film *film, const Medium *medium)
+            : ProjectiveCamera(cameraToWorld, Perspective(fov, 1e-2f, 1000.f), screenWindow, shutterOpen,
+                               shutterClose, lensRadius, focalDistance, film, medium) {
+        focusScale = focalDistance / pCamera0.z;
+    }
+
+    Float PerspectiveCamera::GenerateRay(const CameraSample &sample, Ray *ray) const {
+        Point3f o = originWorld;
+        Vector3f d = vWorld0 + sample.pFilm.x * dxWorld + sample.pFilm.y * dyWorld;
+        if (lensRadius > 0) {
+            Point2f pLens = ConcentricSampleDisk(sample.pLens);
+            Vector3f offset = pLens.x * lensU + pLens.y * lensV;
+            d = focusScale * d - offset;
+            o += offset;
+        }
+        *ray = Ray(o, Normalize(d), Infinity, SampleTime(sample.time), medium);
+        return 1;
+    }
+
+    Float PerspectiveCamera::GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const {
+        Point3f o = originWorld;
+        Vector3f d = vWorld0 + sample.pFilm.x * dxWorld + sample.pFilm.y * dyWorld;
+        Vector3f dx = d + dxWorld, dy = d + dyWorld;
+        if (lensRadius > 0) {
+            //the offset rays go through the same lens point
+            Point2f pLens = ConcentricSampleDisk(sample.pLens);
+            Vector3f offset = pLens.x * lensU + pLens.y * lensV;
+            d = focusScale * d - offset;
+            dx = focusScale * dx - offset;
+            dy = focusScale * dy - offset;
+            o += offset;
+        }
+        *rd = RayDifferentials(o, Normalize(d), Infinity, SampleTime(sample.time), medium);
+        rd->rxOrigin = rd->ryOrigin = o;
+        rd->rxDirection = Normalize(dx);
+        rd->ryDirection = Normalize(dy);
+        rd->hasDifferentials = true;
+        return 1;
+    }
+
+    RayCone PerspectiveCamera::GeneratePixelCone() const {
+        //angle subtended by one pixel at the image center
+        return RayCone(0, std::atan(dyCamera.Length() / std::abs(pCamera0.z)));
+    }
+
+    void PerspectiveCamera::GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays,
+                                         int64_t offset) const {
+        assert(offset + n <= int64_t(rays->Size()));
+        Float *ox = &rays->ox[offset], *oy = &rays->oy[offset], *oz = &rays->oz[offset];
+        Float *dx = &rays->dx[offset], *dy = &rays->dy[offset], *dz = &rays->dz[offset];
+        Float *time = &rays->time[offset];
+        //lens branch hoisted out of the loops, the pinhole loop is straight line code
+        if (lensRadius > 0) {
+            for (int64_t i = 0; i < n; ++i) {
+                const CameraSample &s = samples[i];
+                Point2f pLens = ConcentricSampleDisk(s.pLens);
+                Float offX = pLens.x * lensU.x + pLens.y * lensV.x;
+                Float offY = pLens.x * lensU.y + pLens.y * lensV.y;
+                Float offZ = pLens.x * lensU.z + pLens.y * lensV.z;
+                Float x = focusScale * (vWorld0.x + s.pFilm.x * dxWorld.x + s.pFilm.y * dyWorld.x) - offX;
+                Float y = focusScale * (vWorld0.y + s.pFilm.x * dxWorld.y + s.pFilm.y * dyWorld.y) - offY;
+                Float z = focusScale * (vWorld0.z + s.pFilm.x * dxWorld.z + s.pFilm.y * dyWorld.z) - offZ;
+                Float invLen = 1 / std::sqrt(x * x + y * y + z * z);
+                ox[i] = originWorld.x + offX;
+                oy[i] = originWorld.y + offY;
+                oz[i] = originWorld.z + offZ;
+                dx[i] = x * invLen;
+                dy[i] = y * invLen;
+                dz[i] = z * invLen;
+                time[i] = SampleTime(s.time);
+            }
+        } else {
+            for (int64_t i = 0; i < n; ++i) {
+                const CameraSample &s = samples[i];
+                Float x = vWorld0.x + s.pFilm.x * dxWorld.x + s.pFilm.y * dyWorld.x;
+                Float y = vWorld0.y + s.pFilm.x * dxWorld.y + s.pFilm.y * dyWorld.y;
+                Float z = vWorld0.z + s.pFilm.x * dxWorld.z + s.pFilm.y * dyWorld.z;
+                Float invLen = 1 / std::sqrt(x * x + y * y + z * z);
+                ox[i] = originWorld.x;
+                oy[i] = originWorld.y;
+                oz[i] = originWorld.z;
+                dx[i] = x * invLen;
+                dy[i] = y * invLen;
+                dz[i] = z * invLen;
+                time[i] = SampleTime(s.time);
+            }
+        }
+    }
+}
@@ -0,0 +1,114 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#include "camera.h"
+#include "film.h"
+
+namespace sr {
+
+    void RayBatch::Resize(std::size_t n) {
+        ox.resize(n);
+        oy.resize(n);
+        oz.resize(n);
+        dx.resize(n);
+        dy.resize(n);
+        dz.resize(n);
+        time.resize(n);
+    }
+
+    void RayBatch::Set(std::size_t i, const Ray &r) {
+        ox[i] = r.o.x;
+        oy[i] = r.o.y;
+        oz[i] = r.o.z;
+        dx[i] = r.d.x;
+        dy[i] = r.d.y;
+        dz[i] = r.d.z;
+        time[i] = r.time;
+    }
+
+    Camera::Camera(const Transform &cameraToWorld, Float shutterOpen, Float shutterClose, Film *film,
+                   const Medium *medium) : cameraToWorld(cameraToWorld), shutterOpen(shutterOpen),
+                                           shutterClose(shutterClose), film(film), medium(medium) {}
+
+    Camera::~Camera() {}
+
+    Float Camera::GenerateRayDifferential(const CameraSample &sample, RayDifferentials *rd) const {
+        Ray r;
+        Float wt = GenerateRay(sample, &r);
+        *rd = RayDifferentials(r);
+        if (wt == 0) return 0;
+
+        CameraSample shift = sample;
+        shift.pFilm.x += 1;
+        Ray rx;
+        if (GenerateRay(shift, &rx) == 0) return 0;
+        shift.pFilm = Point2f(sample.pFilm.x, sample.pFilm.y + 1);
+        Ray ry;
+        if (GenerateRay(shift, &ry) == 0) return 0;
+
+        rd->rxOrigin = rx.o;
+        rd->rxDirection = rx.d;
+        rd->ryOrigin = ry.o;
+        rd->ryDirection = ry.d;
+        rd->hasDifferentials = true;
+        return wt;
+    }
+
+    void Camera::GenerateRays(const CameraSample *samples, int64_t n, RayBatch *rays, int64_t offset) const {
+        assert(offset + n <= int64_t(rays->Size()));
+        Ray r;
+        for (int64_t i = 0; i < n; ++i) {
+            GenerateRay(samples[i], &r);
+            rays->Set(offset + i, r);
+        }
+    }
+
+    void Camera::GenerateRowRays(Sampler &sampler, int y, int x0, int x1, int64_t sampleIndex,
+                                 std::vector<CameraSample> *samples, RayBatch *rays) const {
+        int n = std::max(x1 - x0, 0);
+        samples->resize(n);
+        for (int x = x0; x < x1; ++x) {
+            Point2i p(x, y);
+            sampler.StartPixelSample(p, sampleIndex);
+            (*samples)[x - x0] = sampler.GetCameraSample(p);
+        }
+        rays->Resize(n);
+        GenerateRays(samples->data(), n, rays);
+    }
+
+    Bounds2f DefaultScreenWindow(const Point2i &resolution) {
+        Float aspect = Float(resolution.x) / Float(resolution.y);
+        if (aspect > 1) return Bounds2f(Point2f(-aspect, -1), Point2f(aspect, 1));
+        return Bounds2f(Point2f(-1, -1 / aspect), Point2f(1, 1 / aspect));
+    }
+
+    ProjectiveCamera::ProjectiveCamera(const Transform &cameraToWorld, const Transform &cameraToScreen,
+                                       const Bounds2f &screenWindow, Float shutterOpen, Float shutterClose,
+                                       Float lensRadius, Float focalDistance, Film *film, const Medium *medium)
+            : Camera(cameraToWorld, shutterOpen, shutterClose, film, medium), cameraToScreen(cameraToScreen),
+              rasterToCamera(Matrix4x4()), screenToRaster(Matrix4x4()), rasterToScreen(Matrix4x4()),
+              lensRadius(lensRadius), focalDistance(focalDistance) {
+        //screen window to [0, resolution], y flipped
+        screenToRaster = Scale(Float(film->fullResolution.x), Float(film->fullResolution.y), 1) *
+                         Scale(1 / (screenWindow.pMax.x - screenWindow.pMin.x),
+                               1 / (screenWindow.pMin.y - screenWindow.pMax.y), 1) *
+                         Translate(Vector3f(-screenWindow.pMin.x, -screenWindow.pMax.y, 0));
+        rasterToScreen = Inverse(screenToRaster);
+        rasterToCamera = Inverse(cameraToScreen) * rasterToScreen;
+
+        //rasterToCamera is projective, but constant on the z = 0 plane, so three points fix the affine map
+        pCamera0 = rasterToCamera(Point3f(0, 0, 0));
+        dxCamera = rasterToCamera(Point3f(1, 0, 0)) - pCamera0;
+        dyCamera = rasterToCamera(Point3f(0, 1, 0)) - pCamera0;
+
+        pWorld0 = cameraToWorld(pCamera0);
+        vWorld0 = cameraToWorld(Vector3f(pCamera0.x, pCamera0.y, pCamera0.z));
+        dxWorld = cameraToWorld(dxCamera);
+        dyWorld = cameraToWorld(dyCamera);
+        originWorld = cameraToWorld(Point3f(0, 0, 0));
+        forwardWorld = cameraToWorld(Vector3f(0, 0, 1));
+        lensU = cameraToWorld(Vector3f(lensRadius, 0, 0));
+        lensV = cameraToWorld(Vector3f(0, lensRadius, 0));
+    }
+}
@@ -0,0 +1,476 @@
+//
+// Created by 18310 on 2021/5/12.
+//
+
+#include "distributed.h"
+#include "parallel.h"
+#include "socket.h"
+#include "stats.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+namespace sr {
+
+    enum class DistributedMessage : uint32_t {
+        //worker: int32 thread count
+        Hello = 16,
+        //coordinator: JobHeader then the RenderJob
+        Job,
+        //coordinator: int32 tile indices to render
+        Tiles,
+        //worker: TileDoneHeader then the FilmTile payload
+        TileDone,
+        //coordinator: every tile of the job is merged, drop the rest
+        JobEnd,
+        //coordinator: exit
+        Shutdown
+    };
+
+    struct JobHeader {
+        int32_t jobId;
+        uint32_t encoding;
+    };
+
+    struct TileDoneHeader {
+        int32_t jobId;
+        int32_t tile;
+        double seconds;
+    };
+
+    void DistributedReport::Print(std::ostream &os) const {
+        double busy = 0, firstIdle = seconds;
+        for (const DistributedWorkerReport &w : workers) {
+            busy += w.busySeconds;
+            if (!w.lost) firstIdle = std::min(firstIdle, w.finishSeconds);
+        }
+        std::ios::fmtflags flags = os.flags();
+        os << std::fixed << std::setprecision(3);
+        os << "Distributed render:\n";
+        os << "    seconds: " << seconds << ", tiles: " << tiles << ", workers: " << workers.size() << "\n";
+        if (seconds > 0 && !workers.empty())
+            os << "    parallel efficiency: " << 100 * busy / (seconds * workers.size()) << "%\n";
+        os << "    straggler tail: " << seconds - firstIdle << " s after the first worker ran out of tiles\n";
+        for (std::size_t i = 0; i < workers.size(); ++i) {
+            const DistributedWorkerReport &w = workers[i];
+            os << "    worker " << i << ": " << w.threads << " threads, " << w.tiles << " tiles, " << w.stolen
+               << " stolen, " << w.duplicates << " duplicates, busy " << w.busySeconds << " s, finished at "
+               << w.finishSeconds << " s, " << w.payloadBytes << " bytes" << (w.lost ? ", lost" : "") << "\n";
+        }
+        os << "    transfer: " << payloadBytes << " bytes, " << floatBytes << " as float tiles, ratio "
+           << (payloadBytes > 0 ? double(floatBytes) / payloadBytes : 0) << ", merging " << mergeSeconds << " s ("
+           << (seconds > 0 ? 100 * mergeSeconds / seconds : 0) << "% of the render)\n";
+        os << "    discarded results: " << discardedResults << "\n";
+        for (const auto &t : slowestTiles) {
+            os << "    slow tile [" << t.first.pMin.x << ", " << t.first.pMin.y << "] - [" << t.first.pMax.x << ", "
+               << t.first.pMax.y << "]: " << t.second << " s\n";
+        }
+        os.flags(flags);
+    }
+
+    RenderCoordinator::RenderCoordinator(const std::string &endpoint, const DistributedOptions &options)
+            : endpoint(endpoint), options(options) {}
+
+    RenderCoordinator::~RenderCoordinator() {
+        for (const Worker &w : workers) {
+            SendMessage(w.fd, uint32_t(DistributedMessage::Shutdown), nullptr, 0);
+            CloseSocket(w.fd);
+        }
+        if (listenFd >= 0) {
+            CloseSocket(listenFd);
+            RemoveEndpoint(endpoint);
+        }
+    }
+
+    bool RenderCoordinator::Listen() {
+        listenFd = ListenEndpoint(endpoint);
+        return listenFd >= 0;
+    }
+
+    bool RenderCoordinator::AcceptWorker() {
+        int fd = AcceptConnection(listenFd);
+        if (fd < 0) return false;
+        uint32_t type;
+        std::vector<uint8_t> payload;
+        int32_t threads = 0;
+        if (!ReceiveMessage(fd, &type, &payload, sizeof(threads)) || type != uint32_t(DistributedMessage::Hello) ||
+            payload.size() != sizeof(threads)) {
+            std::cerr << "RenderCoordinator: a connection did not introduce itself as a worker\n";
+            CloseSocket(fd);
+            return false;
+        }
+        std::memcpy(&threads, payload.data(), sizeof(threads));
+        workers.push_back(Worker{fd, std::max(1, int(threads))});
+        return true;
+    }
+
+    int RenderCoordinator::WaitForWorkers(int n, double timeoutSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        while (listenFd >= 0 && WorkerCount() < n) {
+            double left = timeoutSeconds - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (left <= 0 || WaitReadable(std::vector<int>{listenFd}, int(left * 1000)) < 0) break;
+            AcceptWorker();
+        }
+        return WorkerCount();
+    }
+
+    bool RenderCoordinator::Render(const RenderJob &job, Film *film, DistributedReport *report) {
+        std::string error = ValidateRenderJob(job);
+        if (!error.empty() || listenFd < 0) {
+            std::cerr << "RenderCoordinator: " << (error.empty() ? "not listening" : error) << "\n";
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+        ++jobId;
+        const std::vector<Bounds2i> tiles = JobTiles(job, *film);
+        const int nTiles = int(tiles.size());
+        std::vector<uint8_t> jobPayload(sizeof(JobHeader));
+        JobHeader header{jobId, uint32_t(options.encoding)};
+        std::memcpy(jobPayload.data(), &header, sizeof(header));
+        EncodeRenderJob(job, &jobPayload);
+
+        struct WorkerState {
+            //handed out next, stolen from the back
+            std::deque<int> queue;
+            //(tile, seconds when it was sent or, once another result frees a thread for it, started)
+            std::vector<std::pair<int, double>> outstanding;
+            DistributedWorkerReport report;
+            bool alive = true;
+        };
+        std::vector<WorkerState> state;
+        //tiles of lost workers, handed out before anything else
+        std::deque<int> orphans;
+        std::vector<char> done(nTiles, 0), duplicated(nTiles, 0);
+        int nDone = 0;
+        //summed over merged tiles
+        double tileSeconds = 0;
+        DistributedReport stats;
+
+        auto lose = [&](int w) {
+            WorkerState &s = state[w];
+            if (!s.alive) return;
+            std::cerr << "RenderCoordinator: lost worker " << w << "\n";
+            s.alive = false;
+            s.report.lost = true;
+            CloseSocket(workers[w].fd);
+            for (int t : s.queue) orphans.push_back(t);
+            for (const auto &o : s.outstanding) {
+                if (!done[o.first]) orphans.push_back(o.first);
+            }
+            s.queue.clear();
+            s.outstanding.clear();
+        };
+
+        //tops up worker w to threads + prefetch tiles in flight
+        auto fill = [&](int w) {
+            WorkerState &s = state[w];
+            if (!s.alive) return;
+            std::vector<int32_t> batch;
+            while (int(s.outstanding.size()) < workers[w].threads + options.prefetch) {
+                int t = -1;
+                if (!orphans.empty()) {
+                    t = orphans.front();
+                    orphans.pop_front();
+                } else if (!s.queue.empty()) {
+                    t = s.queue.front();
+                    s.queue.pop_front();
+                } else {
+                    int victim = -1;
+                    for (int v = 0; v < int(state.size()); ++v) {
+                        if (v != w && state[v].alive && !state[v].queue.empty() &&
+                            (victim < 0 || state[v].queue.size() > state[victim].queue.size()))
+                            victim = v;
+                    }
+                    if (victim >= 0) {
+                        //the back half keeps both runs contiguous in the spiral
+                        std::deque<int> &q = state[victim].queue;
+                        std::size_t n = (q.size() + 1) / 2;
+                        for (std::size_t i = 0; i < n; ++i) {
+                            s.queue.push_front(q.back());
+                            q.pop_back();
+                        }
+                        s.report.stolen += int64_t(n);
+                        continue;
+                    }
+                    if (!options.duplicateStragglers || nDone == 0) break;
+                    //workers render in the order tiles were sent, so the first threads outstanding ones are in
+                    //progress, a copy is made of the one running longest once it passes twice the mean tile time
+                    double cutoff = elapsed() - 2 * tileSeconds / nDone, oldest = Infinity;
+                    for (int v = 0; v < int(state.size()); ++v) {
+                        if (v == w || !state[v].alive) continue;
+                        int inProgress = std::min(int(state[v].outstanding.size()), workers[v].threads);
+                        for (int i = 0; i < inProgress; ++i) {
+                            const auto &o = state[v].outstanding[i];
+                            if (!done[o.first] && !duplicated[o.first] && o.second < cutoff && o.second < oldest) {
+                                oldest = o.second;
+                                t = o.first;
+                            }
+                        }
+                    }
+                    if (t < 0) break;
+                    duplicated[t] = 1;
+                    ++s.report.duplicates;
+                }
+                if (done[t]) continue;
+                batch.push_back(t);
+                s.outstanding.emplace_back(t, elapsed());
+            }
+            if (!batch.empty() && !SendMessage(workers[w].fd, uint32_t(DistributedMessage::Tiles), batch.data(),
+                                               batch.size() * sizeof(int32_t)))
+                lose(w);
+        };
+
+        auto join = [&](int w) {
+            state.emplace_back();
+            state[w].report.threads = workers[w].threads;
+            if (!SendMessage(workers[w].fd, uint32_t(DistributedMessage::Job), jobPayload)) lose(w);
+        };
+
+        //contiguous runs of the spiral in proportion to thread counts
+        int totalThreads = 0;
+        for (const Worker &w : workers) totalThreads += w.threads;
+        int next = 0, threadsSoFar = 0;
+        for (int w = 0; w < WorkerCount(); ++w) {
+            join(w);
+            threadsSoFar += workers[w].threads;
+            int end = int(int64_t(nTiles) * threadsSoFar / totalThreads);
+            for (; next < end; ++next) state[w].queue.push_back(next);
+        }
+        for (; next < nTiles; ++next) orphans.push_back(next);
+        for (int w = 0; w < WorkerCount(); ++w) fill(w);
+
+        std::vector<int> fds, owners;
+        std::vector<uint8_t> payload;
+        while (nDone < nTiles) {
+            fds.clear();
+            owners.clear();
+            for (int w = 0; w < WorkerCount(); ++w) {
+                if (!state[w].alive) continue;
+                fds.push_back(workers[w].fd);
+                owners.push_back(w);
+            }
+            bool anyAlive = !fds.empty();
+            fds.push_back(listenFd);
+            //idle workers are looked at again every so often for tiles that became stragglers meanwhile
+            int timeoutMs = !anyAlive ? int(options.workerTimeout * 1000) : options.duplicateStragglers ? 50 : -1;
+            int ready = WaitReadable(fds, timeoutMs);
+            if (ready < 0 && anyAlive) {
+                for (int v = 0; v < WorkerCount(); ++v) fill(v);
+                continue;
+            }
+            if (ready < 0) {
+                std::cerr << "RenderCoordinator: no workers left\n";
+                break;
+            }
+            if (ready == int(fds.size()) - 1) {
+                //a late worker starts empty and steals
+                if (AcceptWorker()) {
+                    join(WorkerCount() - 1);
+                    fill(WorkerCount() - 1);
+                }
+                continue;
+            }
+
+            int w = owners[ready];
+            WorkerState &s = state[w];
+            auto mergeStart = std::chrono::steady_clock::now();
+            uint32_t type;
+            TileDoneHeader tileHeader;
+            if (!ReceiveMessage(workers[w].fd, &type, &payload) || type != uint32_t(DistributedMessage::TileDone) ||
+                payload.size() < sizeof(tileHeader)) {
+                lose(w);
+                for (int v = 0; v < WorkerCount(); ++v) fill(v);
+                continue;
+            }
+            std::memcpy(&tileHeader, payload.data(), sizeof(tileHeader));
+            int t = tileHeader.tile;
+            //late copies of the previous job's tiles
+            if (tileHeader.jobId != jobId || t < 0 || t >= nTiles) continue;
+            for (std::size_t i = 0; i < s.outstanding.size(); ++i) {
+                if (s.outstanding[i].first == t) {
+                    s.outstanding.erase(s.outstanding.begin() + i);
+                    //the prefetched tile the freed thread picks up
+                    int started = workers[w].threads - 1;
+                    if (started < int(s.outstanding.size()))
+                        s.outstanding[started].second = std::max(s.outstanding[started].second, elapsed());
+                    break;
+                }
+            }
+            if (done[t]) {
+                ++stats.discardedResults;
+            } else {
+                std::unique_ptr<FilmTile> tile = film->DecodeFilmTile(payload.data() + sizeof(tileHeader),
+                                                                      payload.size() - sizeof(tileHeader));
+                if (!tile) {
+                    std::cerr << "RenderCoordinator: worker " << w << " sent a tile that does not fit the film\n";
+                    orphans.push_back(t);
+                    lose(w);
+                    for (int v = 0; v < WorkerCount(); ++v) fill(v);
+                    continue;
+                }
+                film->MergeFilmTile(*tile);
+                done[t] = 1;
+                ++nDone;
+                s.report.tiles++;
+                s.report.busySeconds += tileHeader.seconds / workers[w].threads;
+                tileSeconds += tileHeader.seconds;
+                s.report.finishSeconds = elapsed();
+                s.report.payloadBytes += int64_t(payload.size());
+                stats.payloadBytes += int64_t(payload.size());
+                stats.floatBytes += int64_t(sizeof(tileHeader) + 5 * sizeof(int32_t) +
+                                            std::size_t(tile->GetPixelBounds().SurfaceArea()) * 4 * sizeof(float));
+                stats.slowestTiles.emplace_back(tiles[t], tileHeader.seconds);
+                std::sort(stats.slowestTiles.begin(), stats.slowestTiles.end(),
+                          [](const std::pair<Bounds2i, double> &a, const std::pair<Bounds2i, double> &b) {
+                              return a.second > b.second;
+                          });
+                if (int(stats.slowestTiles.size()) > options.slowestTiles) stats.slowestTiles.pop_back();
+            }
+            stats.mergeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+            fill(w);
+        }
+
+        for (int w = 0; w < WorkerCount(); ++w) {
+            if (state[w].alive) SendMessage(workers[w].fd, uint32_t(DistributedMessage::JobEnd), nullptr, 0);
+        }
+        //lost workers are not offered the next job
+        std::vector<Worker> alive;
+        for (int w = 0; w < WorkerCount(); ++w) {
+            stats.workers.push_back(state[w].report);
+            if (state[w].alive) alive.push_back(workers[w]);
+        }
+        workers.swap(alive);
+        stats.seconds = elapsed();
+        stats.tiles = nDone;
+        if (report) *report = stats;
+        return nDone == nTiles;
+    }
+
+    //tiles handed to a worker, Close() ends the job and drops the rest
+    class TileQueue {
+    public:
+        void Push(const int32_t *tiles, std::size_t n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed) return;
+            queue.insert(queue.end(), tiles, tiles + n);
+            cv.notify_all();
+        }
+
+        void Close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            queue.clear();
+            cv.notify_all();
+        }
+
+        //blocks for the next tile, false once closed
+        bool Pop(int *tile) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return closed || !queue.empty(); });
+            if (closed) return false;
+            *tile = queue.front();
+            queue.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<int32_t> queue;
+        bool closed = false;
+    };
+
+    bool RunRenderWorker(const std::string &endpoint, std::shared_ptr<const Scene> scene,
+                         const GuidedPathOptions &options) {
+        int fd = ConnectEndpoint(endpoint);
+        if (fd < 0) return false;
+        const int32_t nThreads = MaxThreadIndex();
+        if (!SendMessage(fd, uint32_t(DistributedMessage::Hello), &nThreads, sizeof(nThreads))) {
+            CloseSocket(fd);
+            return false;
+        }
+        //tiles render in one pass, there is nothing to train the guide on
+        GuidedPathOptions opts = options;
+        opts.guiding = false;
+        AlignedArray<MemoryArena> arenas(nThreads);
+
+        bool ok = true, shutdown = false;
+        uint32_t type;
+        std::vector<uint8_t> payload;
+        while (ok && !shutdown) {
+            if (!ReceiveMessage(fd, &type, &payload)) {
+                std::cerr << "RunRenderWorker: lost the coordinator\n";
+                ok = false;
+                break;
+            }
+            if (type == uint32_t(DistributedMessage::Shutdown)) break;
+            if (type != uint32_t(DistributedMessage::Job) || payload.size() < sizeof(JobHeader)) continue;
+            JobHeader header;
+            std::memcpy(&header, payload.data(), sizeof(header));
+            RenderJob job;
+            if (!DecodeRenderJob(std::vector<uint8_t>(payload.begin() + sizeof(header), payload.end()), &job) ||
+                !ValidateRenderJob(job).empty() || header.encoding > uint32_t(TileEncoding::Compressed)) {
+                std::cerr << "RunRenderWorker: invalid job\n";
+                ok = false;
+                break;
+            }
+            JobContext context(*scene, job, opts);
+            const int32_t nTiles = int32_t(context.Tiles().size());
+
+            //the main thread renders, this one takes assignments as they come
+            TileQueue queue;
+            std::thread receiver([&]() {
+                uint32_t msgType;
+                std::vector<uint8_t> msg;
+                while (true) {
+                    if (!ReceiveMessage(fd, &msgType, &msg)) {
+                        std::cerr << "RunRenderWorker: lost the coordinator\n";
+                        ok = false;
+                        break;
+                    }
+                    if (msgType == uint32_t(DistributedMessage::Tiles)) {
+                        std::vector<int32_t> tiles(msg.size() / sizeof(int32_t));
+                        std::memcpy(tiles.data(), msg.data(), tiles.size() * sizeof(int32_t));
+                        tiles.erase(std::remove_if(tiles.begin(), tiles.end(),
+                                                   [&](int32_t t) { return t < 0 || t >= nTiles; }), tiles.end());
+                        queue.Push(tiles.data(), tiles.size());
+                    } else if (msgType == uint32_t(DistributedMessage::JobEnd)) {
+                        break;
+                    } else if (msgType == uint32_t(DistributedMessage::Shutdown)) {
+                        shutdown = true;
+                        break;
+                    }
+                }
+                queue.Close();
+            });
+
+            std::mutex sendMutex;
+            ParallelFor([&](int64_t) {
+                int t;
+                std::vector<uint8_t> result;
+                while (queue.Pop(&t)) {
+                    auto tileStart = std::chrono::steady_clock::now();
+                    std::unique_ptr<FilmTile> tile = context.RenderTile(t, arenas[ThreadIndex]);
+                    TileDoneHeader done{header.jobId, t, std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - tileStart).count()};
+                    result.resize(sizeof(done));
+                    std::memcpy(result.data(), &done, sizeof(done));
+                    tile->Encode(&result, TileEncoding(header.encoding));
+                    std::lock_guard<std::mutex> lock(sendMutex);
+                    //a failed send also fails the receiver, which closes the queue
+                    SendMessage(fd, uint32_t(DistributedMessage::TileDone), result);
+                }
+            }, nThreads);
+            receiver.join();
+            //counters and validation failures of this job only
+            PrintStats(std::cerr);
+            ClearStats();
+        }
+        CloseSocket(fd);
+        return ok;
+    }
+}
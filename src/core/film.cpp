@@ -0,0 +1,322 @@
+//
+// Created by 18310 on 2021/4/21.
+//
+
+#include "film.h"
+#include "imageio.h"
+#include "compactspectrum.h"
+
+namespace sr {
+
+    void FilmTile::AddSampleXYZ(const Point2f &pFilm, const Float *xyz, Float sampleWeight) {
+        //pixel (x, y) is centered at (x + 0.5, y + 0.5)
+        Float dx = pFilm.x - 0.5f, dy = pFilm.y - 0.5f;
+        int x0 = std::max((int) std::ceil(dx - filterRadius.x), pixelBounds.pMin.x);
+        int y0 = std::max((int) std::ceil(dy - filterRadius.y), pixelBounds.pMin.y);
+        int x1 = std::min((int) std::floor(dx + filterRadius.x) + 1, pixelBounds.pMax.x);
+        int y1 = std::min((int) std::floor(dy + filterRadius.y) + 1, pixelBounds.pMax.y);
+
+        for (int y = y0; y < y1; ++y) {
+            int iy = std::min((int) (std::abs((y - dy) * invFilterRadius.y) * filterTableWidth),
+                              filterTableWidth - 1);
+            for (int x = x0; x < x1; ++x) {
+                int ix = std::min((int) (std::abs((x - dx) * invFilterRadius.x) * filterTableWidth),
+                                  filterTableWidth - 1);
+                Float filterWeight = filterTable[iy * filterTableWidth + ix];
+                FilmTilePixel &pixel = GetPixel(Point2i(x, y));
+                Float w = sampleWeight * filterWeight;
+                pixel.xyz[0] += xyz[0] * w;
+                pixel.xyz[1] += xyz[1] * w;
+                pixel.xyz[2] += xyz[2] * w;
+                pixel.filterWeightSum += filterWeight;
+            }
+        }
+    }
+
+    //bytes of one pixel in a Float or Half payload
+    static std::size_t EncodedPixelSize(TileEncoding encoding) {
+        return encoding == TileEncoding::Half ? 3 * sizeof(uint16_t) + sizeof(float) : 4 * sizeof(float);
+    }
+
+    //PackBits style: a control byte c < 128 is followed by c + 1 literal bytes, c >= 128 by one byte that is
+    //repeated c - 125 times (3 to 130)
+    static void RunLengthEncode(const uint8_t *in, std::size_t n, std::vector<uint8_t> *out) {
+        std::size_t i = 0;
+        while (i < n) {
+            std::size_t run = 1;
+            while (i + run < n && run < 130 && in[i + run] == in[i]) ++run;
+            if (run >= 3) {
+                out->push_back(uint8_t(run + 125));
+                out->push_back(in[i]);
+                i += run;
+                continue;
+            }
+            //literals up to the next run of 3
+            std::size_t start = i;
+            while (i < n && i - start < 128 && !(i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2])) ++i;
+            out->push_back(uint8_t(i - start - 1));
+            out->insert(out->end(), in + start, in + i);
+        }
+    }
+
+    //false unless the input decodes to exactly n bytes
+    static bool RunLengthDecode(const uint8_t *in, std::size_t size, uint8_t *out, std::size_t n) {
+        const uint8_t *end = in + size;
+        std::size_t o = 0;
+        while (in < end) {
+            uint8_t c = *in++;
+            std::size_t count = c < 128 ? std::size_t(c) + 1 : std::size_t(c) - 125;
+            if (n - o < count) return false;
+            if (c < 128) {
+                if (std::size_t(end - in) < count) return false;
+                std::memcpy(out + o, in, count);
+                in += count;
+            } else {
+                if (in == end) return false;
+                std::memset(out + o, *in++, count);
+            }
+            o += count;
+        }
+        return o == n;
+    }
+
+    void FilmTile::Encode(std::vector<uint8_t> *payload, TileEncoding encoding) const {
+        int32_t bounds[4] = {pixelBounds.pMin.x, pixelBounds.pMin.y, pixelBounds.pMax.x, pixelBounds.pMax.y};
+        uint32_t format = uint32_t(encoding);
+        std::size_t offset = payload->size();
+        std::size_t pixelBytes = encoding == TileEncoding::Compressed ? 0 : pixels.size() * EncodedPixelSize(encoding);
+        payload->resize(offset + sizeof(bounds) + sizeof(format) + pixelBytes);
+        uint8_t *p = payload->data() + offset;
+        std::memcpy(p, bounds, sizeof(bounds));
+        p += sizeof(bounds);
+        std::memcpy(p, &format, sizeof(format));
+        p += sizeof(format);
+        if (encoding == TileEncoding::Compressed) {
+            //byte b of channel c of pixel i goes to planes[(4 * c + b) * n + i]
+            std::size_t n = pixels.size();
+            std::vector<uint8_t> planes(16 * n);
+            uint32_t previous[4] = {0, 0, 0, 0};
+            for (std::size_t i = 0; i < n; ++i) {
+                const FilmTilePixel &pixel = pixels[i];
+                float v[4] = {float(pixel.xyz[0]), float(pixel.xyz[1]), float(pixel.xyz[2]),
+                              float(pixel.filterWeightSum)};
+                uint32_t bits[4];
+                std::memcpy(bits, v, sizeof(v));
+                for (int c = 0; c < 4; ++c) {
+                    uint32_t delta = bits[c] ^ previous[c];
+                    previous[c] = bits[c];
+                    for (int b = 0; b < 4; ++b) planes[(4 * c + b) * n + i] = uint8_t(delta >> (8 * b));
+                }
+            }
+            RunLengthEncode(planes.data(), planes.size(), payload);
+            return;
+        }
+        for (const FilmTilePixel &pixel : pixels) {
+            float weight = float(pixel.filterWeightSum);
+            if (encoding == TileEncoding::Half) {
+                //means stay in the range of binary16 where the sums would not
+                float invWeight = weight != 0 ? 1 / weight : 0;
+                uint16_t h[3];
+                for (int i = 0; i < 3; ++i)
+                    h[i] = FloatToHalf(Clamp(float(pixel.xyz[i]) * invWeight, -65504.f, 65504.f));
+                std::memcpy(p, h, sizeof(h));
+                std::memcpy(p + sizeof(h), &weight, sizeof(weight));
+                p += sizeof(h) + sizeof(weight);
+            } else {
+                float v[4] = {float(pixel.xyz[0]), float(pixel.xyz[1]), float(pixel.xyz[2]), weight};
+                std::memcpy(p, v, sizeof(v));
+                p += sizeof(v);
+            }
+        }
+    }
+
+    Film::Film(const Point2i &resolution, const Bounds2f &cropWindow, std::unique_ptr<Filter> filt,
+               const std::string &filename, Float scale) : fullResolution(resolution), filter(std::move(filt)),
+                                                            filename(filename), scale(scale) {
+        croppedPixelBounds.pMin = Point2i((int) std::ceil(fullResolution.x * cropWindow.pMin.x),
+                                          (int) std::ceil(fullResolution.y * cropWindow.pMin.y));
+        croppedPixelBounds.pMax = Point2i((int) std::ceil(fullResolution.x * cropWindow.pMax.x),
+                                          (int) std::ceil(fullResolution.y * cropWindow.pMax.y));
+        pixels.reset(new Pixel[std::max(0, croppedPixelBounds.SurfaceArea())]);
+
+        //sample the filter at the center of every table cell
+        for (int y = 0; y < filterTableWidth; ++y) {
+            for (int x = 0; x < filterTableWidth; ++x) {
+                Point2f p((x + 0.5f) * filter->radius.x / filterTableWidth,
+                          (y + 0.5f) * filter->radius.y / filterTableWidth);
+                filterTable[y * filterTableWidth + x] = filter->Evaluate(p);
+            }
+        }
+    }
+
+    Bounds2i Film::GetSampleBounds() const {
+        Bounds2i res;
+        res.pMin = Point2i((int) std::floor(croppedPixelBounds.pMin.x + 0.5f - filter->radius.x),
+                           (int) std::floor(croppedPixelBounds.pMin.y + 0.5f - filter->radius.y));
+        res.pMax = Point2i((int) std::ceil(croppedPixelBounds.pMax.x - 0.5f + filter->radius.x),
+                           (int) std::ceil(croppedPixelBounds.pMax.y - 0.5f + filter->radius.y));
+        return res;
+    }
+
+    std::unique_ptr<FilmTile> Film::GetFilmTile(const Bounds2i &sampleBounds) const {
+        //every pixel a sample in sampleBounds can reach through the filter
+        Bounds2i tileBounds;
+        tileBounds.pMin = Point2i((int) std::ceil(sampleBounds.pMin.x - 0.5f - filter->radius.x),
+                                  (int) std::ceil(sampleBounds.pMin.y - 0.5f - filter->radius.y));
+        tileBounds.pMax = Point2i((int) std::floor(sampleBounds.pMax.x - 0.5f + filter->radius.x) + 1,
+                                  (int) std::floor(sampleBounds.pMax.y - 0.5f + filter->radius.y) + 1);
+        Bounds2i pixelBounds = Intersect(tileBounds, croppedPixelBounds);
+        return std::unique_ptr<FilmTile>(new FilmTile(pixelBounds, filter->radius, filterTable, filterTableWidth,
+                                                      pixelStats.get(), GetSampleBounds()));
+    }
+
+    void Film::MergeFilmTile(const FilmTile &tile) {
+        //tiles only overlap in their filter borders, so the CAS loops rarely retry
+        for (Point2i p : tile.GetPixelBounds()) {
+            const FilmTilePixel &tilePixel = tile.GetPixel(p);
+            if (tilePixel.filterWeightSum == 0) continue;
+            Pixel &pixel = GetPixel(p);
+            pixel.xyz[0].Add(tilePixel.xyz[0]);
+            pixel.xyz[1].Add(tilePixel.xyz[1]);
+            pixel.xyz[2].Add(tilePixel.xyz[2]);
+            pixel.filterWeightSum.Add(tilePixel.filterWeightSum);
+        }
+    }
+
+    std::unique_ptr<FilmTile> Film::DecodeFilmTile(const uint8_t *payload, std::size_t size) const {
+        int32_t bounds[4];
+        uint32_t format;
+        if (size < sizeof(bounds) + sizeof(format)) return nullptr;
+        std::memcpy(bounds, payload, sizeof(bounds));
+        std::memcpy(&format, payload + sizeof(bounds), sizeof(format));
+        if (format > uint32_t(TileEncoding::Compressed)) return nullptr;
+        TileEncoding encoding = TileEncoding(format);
+        Bounds2i pixelBounds;
+        pixelBounds.pMin = Point2i(bounds[0], bounds[1]);
+        pixelBounds.pMax = Point2i(bounds[2], bounds[3]);
+        if (pixelBounds.pMin.x > pixelBounds.pMax.x || pixelBounds.pMin.y > pixelBounds.pMax.y ||
+            pixelBounds.pMin.x < croppedPixelBounds.pMin.x || pixelBounds.pMin.y < croppedPixelBounds.pMin.y ||
+            pixelBounds.pMax.x > croppedPixelBounds.pMax.x || pixelBounds.pMax.y > croppedPixelBounds.pMax.y)
+            return nullptr;
+        std::size_t n = std::size_t(pixelBounds.SurfaceArea());
+        if (encoding != TileEncoding::Compressed &&
+            size != sizeof(bounds) + sizeof(format) + n * EncodedPixelSize(encoding))
+            return nullptr;
+
+        //only merged, the tile never filters samples
+        std::unique_ptr<FilmTile> tile(new FilmTile(pixelBounds, filter->radius, filterTable, filterTableWidth));
+        const uint8_t *p = payload + sizeof(bounds) + sizeof(format);
+        if (encoding == TileEncoding::Compressed) {
+            std::vector<uint8_t> planes(16 * n);
+            if (!RunLengthDecode(p, size - sizeof(bounds) - sizeof(format), planes.data(), planes.size()))
+                return nullptr;
+            uint32_t previous[4] = {0, 0, 0, 0};
+            std::size_t i = 0;
+            for (Point2i pt : pixelBounds) {
+                float v[4];
+                for (int c = 0; c < 4; ++c) {
+                    uint32_t delta = 0;
+                    for (int b = 0; b < 4; ++b) delta |= uint32_t(planes[(4 * c + b) * n + i]) << (8 * b);
+                    previous[c] ^= delta;
+                }
+                std::memcpy(v, previous, sizeof(v));
+                FilmTilePixel &pixel = tile->GetPixel(pt);
+                pixel.xyz[0] = v[0];
+                pixel.xyz[1] = v[1];
+                pixel.xyz[2] = v[2];
+                pixel.filterWeightSum = v[3];
+                ++i;
+            }
+            return tile;
+        }
+        for (Point2i pt : pixelBounds) {
+            FilmTilePixel &pixel = tile->GetPixel(pt);
+            if (encoding == TileEncoding::Half) {
+                uint16_t h[3];
+                float weight;
+                std::memcpy(h, p, sizeof(h));
+                std::memcpy(&weight, p + sizeof(h), sizeof(weight));
+                p += sizeof(h) + sizeof(weight);
+                for (int i = 0; i < 3; ++i) pixel.xyz[i] = HalfToFloat(h[i]) * weight;
+                pixel.filterWeightSum = weight;
+            } else {
+                float v[4];
+                std::memcpy(v, p, sizeof(v));
+                p += sizeof(v);
+                pixel.xyz[0] = v[0];
+                pixel.xyz[1] = v[1];
+                pixel.xyz[2] = v[2];
+                pixel.filterWeightSum = v[3];
+            }
+        }
+        return tile;
+    }
+
+    void Film::GetRGB(Float *rgb) const {
+        int offset = 0;
+        for (Point2i p : croppedPixelBounds) {
+            const Pixel &pixel = GetPixel(p);
+            Float xyz[3] = {pixel.xyz[0], pixel.xyz[1], pixel.xyz[2]};
+            Float *out = rgb + 3 * offset++;
+            XYZToRGB(xyz, out);
+            Float weightSum = pixel.filterWeightSum;
+            Float invWeight = weightSum != 0 ? scale / weightSum : 0;
+            out[0] = std::max((Float) 0, out[0] * invWeight);
+            out[1] = std::max((Float) 0, out[1] * invWeight);
+            out[2] = std::max((Float) 0, out[2] * invWeight);
+        }
+    }
+
+    bool Film::WriteImage() const {
+        Vector2i extent = croppedPixelBounds.Diagonal();
+        std::vector<Float> rgb(3 * std::max(0, extent.x * extent.y));
+        GetRGB(rgb.data());
+        return sr::WriteImage(filename, rgb.data(), Point2i(extent.x, extent.y));
+    }
+
+    void Film::Clear() {
+        int nPixels = std::max(0, croppedPixelBounds.SurfaceArea());
+        for (int i = 0; i < nPixels; ++i) {
+            pixels[i].xyz[0] = 0;
+            pixels[i].xyz[1] = 0;
+            pixels[i].xyz[2] = 0;
+            pixels[i].filterWeightSum = 0;
+        }
+        if (pixelStats) EnablePixelStatistics();
+    }
+
+    template<typename SpectrumType>
+    void Film::SetImage(const SpectrumType *img) {
+        int nPixels = std::max(0, croppedPixelBounds.SurfaceArea());
+        for (int i = 0; i < nPixels; ++i) {
+            Float xyz[3];
+            img[i].ToXYZ(xyz);
+            pixels[i].xyz[0] = xyz[0];
+            pixels[i].xyz[1] = xyz[1];
+            pixels[i].xyz[2] = xyz[2];
+            pixels[i].filterWeightSum = 1;
+        }
+    }
+
+    template void Film::SetImage<RGBSpectrum>(const RGBSpectrum *img);
+
+    template void Film::SetImage<SampledSpectrum>(const SampledSpectrum *img);
+
+    void Film::EnablePixelStatistics() {
+        pixelStats.reset(new VarianceEstimator[std::max(0, GetSampleBounds().SurfaceArea())]);
+    }
+
+    Float Film::Error(const Bounds2i &sampleBounds) const {
+        if (!pixelStats) return Infinity;
+        Bounds2i statsBounds = GetSampleBounds();
+        Bounds2i b = Intersect(sampleBounds, statsBounds);
+        if (isCollapse(b)) return 0;
+        int width = statsBounds.pMax.x - statsBounds.pMin.x;
+        double sum = 0;
+        for (Point2i p : b) {
+            double e = pixelStats[(p.y - statsBounds.pMin.y) * width + (p.x - statsBounds.pMin.x)].RelativeError();
+            sum += e * e;
+        }
+        return Float(std::sqrt(sum / b.SurfaceArea()));
+    }
+}
@@ -0,0 +1,9 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#include "filter.h"
+
+namespace sr {
+    Filter::~Filter() {}
+}
@@ -0,0 +1,113 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#include "imageio.h"
+#include <cstdio>
+#include <vector>
+
+namespace sr {
+
+    static bool HasExtension(const std::string &name, const std::string &ext) {
+        if (name.size() < ext.size()) return false;
+        std::string tail = name.substr(name.size() - ext.size());
+        std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+        return tail == ext;
+    }
+
+    static bool IsLittleEndian() {
+        uint32_t one = 1;
+        unsigned char first;
+        std::memcpy(&first, &one, 1);
+        return first == 1;
+    }
+
+    static Float GammaCorrect(Float v) {
+        if (v <= 0.0031308f) return 12.92f * v;
+        return 1.055f * std::pow(v, (Float) (1.f / 2.4f)) - 0.055f;
+    }
+
+    static bool WritePFM(const std::string &name, const Float *rgb, const Point2i &res) {
+        FILE *fp = std::fopen(name.c_str(), "wb");
+        if (!fp) return false;
+        //a negative scale marks little endian data, rows are stored bottom to top
+        std::fprintf(fp, "PF\n%d %d\n%s\n", res.x, res.y, IsLittleEndian() ? "-1" : "1");
+        std::vector<float> row(3 * res.x);
+        bool ok = true;
+        for (int y = res.y - 1; y >= 0 && ok; --y) {
+            for (int i = 0; i < 3 * res.x; ++i) row[i] = float(rgb[3 * y * res.x + i]);
+            ok = std::fwrite(row.data(), sizeof(float), row.size(), fp) == row.size();
+        }
+        return std::fclose(fp) == 0 && ok;
+    }
+
+    static bool WritePPM(const std::string &name, const Float *rgb, const Point2i &res) {
+        FILE *fp = std::fopen(name.c_str(), "wb");
+        if (!fp) return false;
+        std::fprintf(fp, "P6\n%d %d\n255\n", res.x, res.y);
+        std::vector<unsigned char> bytes(3 * res.x * res.y);
+        for (std::size_t i = 0; i < bytes.size(); ++i) {
+            bytes[i] = (unsigned char) Clamp(255.f * GammaCorrect(rgb[i]) + 0.5f, 0, 255);
+        }
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+        return std::fclose(fp) == 0 && ok;
+    }
+
+    bool WriteImage(const std::string &name, const Float *rgb, const Point2i &resolution) {
+        bool ok;
+        if (HasExtension(name, ".pfm")) {
+            ok = WritePFM(name, rgb, resolution);
+        } else if (HasExtension(name, ".ppm")) {
+            ok = WritePPM(name, rgb, resolution);
+        } else {
+            std::cerr << "WriteImage: unsupported extension of \"" << name << "\"\n";
+            return false;
+        }
+        if (!ok) std::cerr << "WriteImage: failed to write \"" << name << "\"\n";
+        return ok;
+    }
+
+    std::unique_ptr<Float[]> ReadImage(const std::string &name, Point2i *resolution) {
+        if (!HasExtension(name, ".pfm")) {
+            std::cerr << "ReadImage: only .pfm is supported, got \"" << name << "\"\n";
+            return nullptr;
+        }
+        FILE *fp = std::fopen(name.c_str(), "rb");
+        if (!fp) {
+            std::cerr << "ReadImage: cannot open \"" << name << "\"\n";
+            return nullptr;
+        }
+        char magic[3] = {0, 0, 0};
+        int width, height;
+        double scale;
+        std::unique_ptr<Float[]> rgb;
+        if (std::fscanf(fp, "%2s %d %d %lf", magic, &width, &height, &scale) == 4 && std::fgetc(fp) != EOF &&
+            width > 0 && height > 0 && (std::strcmp(magic, "PF") == 0 || std::strcmp(magic, "Pf") == 0)) {
+            int nChannels = magic[1] == 'F' ? 3 : 1;
+            bool swap = (scale < 0) != IsLittleEndian();
+            std::vector<float> data(std::size_t(nChannels) * width * height);
+            if (std::fread(data.data(), sizeof(float), data.size(), fp) == data.size()) {
+                rgb.reset(new Float[3 * width * height]);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        for (int c = 0; c < 3; ++c) {
+                            float v = data[nChannels * ((height - 1 - y) * width + x) + (nChannels == 3 ? c : 0)];
+                            if (swap) {
+                                unsigned char b[4];
+                                std::memcpy(b, &v, 4);
+                                std::swap(b[0], b[3]);
+                                std::swap(b[1], b[2]);
+                                std::memcpy(&v, b, 4);
+                            }
+                            rgb[3 * (y * width + x) + c] = v * std::abs(scale);
+                        }
+                    }
+                }
+                *resolution = Point2i(width, height);
+            }
+        }
+        std::fclose(fp);
+        if (!rgb) std::cerr << "ReadImage: \"" << name << "\" is not a valid pfm\n";
+        return rgb;
+    }
+}
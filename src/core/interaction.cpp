@@ -6,6 +6,24 @@
 
 namespace sr {
 
+    Ray Interaction::SpawnRay(const Vector3f &d) const {
+        Point3f o = OffsetRayOrigin(p, pError, n, d);
+        return Ray(o, d, Infinity, time, GetMedium(d));
+    }
+
+    Ray Interaction::SpawnRayTo(const Point3f &p2) const {
+        Point3f o = OffsetRayOrigin(p, pError, n, p2 - p);
+        Vector3f d = p2 - o;
+        return Ray(o, d, 1 - ShadowEpsilon, time, GetMedium(d));
+    }
+
+    Ray Interaction::SpawnRayTo(const Interaction &it) const {
+        Point3f o = OffsetRayOrigin(p, pError, n, it.p - p);
+        Point3f target = OffsetRayOrigin(it.p, it.pError, it.n, o - it.p);
+        Vector3f d = target - o;
+        return Ray(o, d, 1 - ShadowEpsilon, time, GetMedium(d));
+    }
+
     SurfaceInteraction::SurfaceInteraction(const Point3f &p, const Vector3f &pError, const Vector3f &wo, Float time,
                                            const Point2f &uv, const Vector3f &dpdu, const Vector3f &dpdv,
                                            const Normal3f &dndu, const Normal3f &dndv, const Shape *shape)
@@ -45,4 +63,81 @@ namespace sr {
         shading.dndv = dndvs;
 
     }
+
+    void SurfaceInteraction::ComputeDifferentials(const RayDifferentials &ray) const {
+        if (!ray.hasDifferentials) {
+            dpdx = dpdy = Vector3f(0, 0, 0);
+            dudx = dvdx = dudy = dvdy = 0;
+            return;
+        }
+        //intersect the offset rays with the tangent plane at p
+        Float d = Dot(n, Vector3f(p));
+        Float tx = -(Dot(n, Vector3f(ray.rxOrigin)) - d) / Dot(n, ray.rxDirection);
+        Float ty = -(Dot(n, Vector3f(ray.ryOrigin)) - d) / Dot(n, ray.ryDirection);
+        if (std::isinf(tx) || std::isnan(tx) || std::isinf(ty) || std::isnan(ty)) {
+            dpdx = dpdy = Vector3f(0, 0, 0);
+            dudx = dvdx = dudy = dvdy = 0;
+            return;
+        }
+        dpdx = (ray.rxOrigin + tx * ray.rxDirection) - p;
+        dpdy = (ray.ryOrigin + ty * ray.ryDirection) - p;
+        ComputeUVDifferentials();
+    }
+
+    void SurfaceInteraction::ComputeDifferentials(const RayCone &cone, const Vector3f &d, Float tHit) const {
+        Float width = cone.WidthAt(tHit);
+        Float cosTheta = AbsDot(n, d);
+        if (width <= 0 || cosTheta == 0) {
+            dpdx = dpdy = Vector3f(0, 0, 0);
+            dudx = dvdx = dudy = dvdy = 0;
+            return;
+        }
+        //the footprint is stretched by 1 / cos along the projected ray direction
+        Vector3f nv(n);
+        Vector3f a = d - Dot(d, nv) * nv;
+        if (a.LengthSquared() == 0) a = dpdu;
+        a = Normalize(a);
+        Vector3f b = Cross(nv, a);
+        dpdx = a * (width / std::max(cosTheta, Float(1e-3)));
+        dpdy = b * width;
+        ComputeUVDifferentials();
+    }
+
+    void SurfaceInteraction::ComputeUVDifferentials() const {
+        //least squares for dp = dpdu * du + dpdv * dv, dropping the axis where n is largest
+        int dim[2];
+        if (std::abs(n.x) > std::abs(n.y) && std::abs(n.x) > std::abs(n.z)) {
+            dim[0] = 1;
+            dim[1] = 2;
+        } else if (std::abs(n.y) > std::abs(n.z)) {
+            dim[0] = 0;
+            dim[1] = 2;
+        } else {
+            dim[0] = 0;
+            dim[1] = 1;
+        }
+        Float a00 = dpdu[dim[0]], a01 = dpdv[dim[0]];
+        Float a10 = dpdu[dim[1]], a11 = dpdv[dim[1]];
+        Float det = a00 * a11 - a01 * a10;
+        if (std::abs(det) < 1e-12f) {
+            dudx = dvdx = dudy = dvdy = 0;
+            return;
+        }
+        Float invDet = 1 / det;
+        Float bx0 = dpdx[dim[0]], bx1 = dpdx[dim[1]];
+        Float by0 = dpdy[dim[0]], by1 = dpdy[dim[1]];
+        dudx = (a11 * bx0 - a01 * bx1) * invDet;
+        dvdx = (a00 * bx1 - a10 * bx0) * invDet;
+        dudy = (a11 * by0 - a01 * by1) * invDet;
+        dvdy = (a00 * by1 - a10 * by0) * invDet;
+        if (std::isnan(dudx) || std::isnan(dvdx) || std::isnan(dudy) || std::isnan(dvdy)) {
+            dudx = dvdx = dudy = dvdy = 0;
+        }
+    }
+
+    Float SurfaceInteraction::MIPLevel(int nLevels) const {
+        Float width = 2 * std::max(std::max(std::abs(dudx), std::abs(dudy)),
+                                   std::max(std::abs(dvdx), std::abs(dvdy)));
+        return nLevels - 1 + std::log2(std::max(width, Float(1e-8)));
+    }
 }
@@ -0,0 +1,95 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#include "light.h"
+#include "scene.h"
+
+namespace sr {
+
+    Light::Light(int flags, const Transform &LightToWorld, const MediumInterface &mediumInterface, int nSamples)
+            : flags(flags), nSamples(std::max(1, nSamples)), mediumInterface(mediumInterface),
+              LightToWorld(LightToWorld), WorldToLight(Inverse(LightToWorld)) {}
+
+    Light::~Light() {}
+
+    bool VisibilityTester::Unoccluded(const Scene &scene) const {
+        return !scene.IntersectP(p0.SpawnRayTo(p1));
+    }
+
+    /**************************************************light bounds*********************************************************/
+
+    DirectionCone Union(const DirectionCone &a, const DirectionCone &b) {
+        if (a.IsEmpty()) return b;
+        if (b.IsEmpty()) return a;
+        //one cone may already contain the other
+        Float theta_a = SafeACos(a.cosTheta), theta_b = SafeACos(b.cosTheta);
+        Float theta_d = SafeACos(Dot(a.w, b.w));
+        if (std::min(theta_d + theta_b, Pi) <= theta_a) return a;
+        if (std::min(theta_d + theta_a, Pi) <= theta_b) return b;
+
+        Float theta_o = (theta_a + theta_d + theta_b) / 2;
+        if (theta_o >= Pi) return DirectionCone::EntireSphere();
+        //rotate a.w toward b.w until the cone just covers both
+        Float theta_r = theta_o - theta_a;
+        Vector3f wr = Cross(a.w, b.w);
+        if (wr.LengthSquared() == 0) return DirectionCone::EntireSphere();
+        Vector3f w = Rotate(Degrees(theta_r), wr)(a.w);
+        return DirectionCone(w, std::cos(theta_o));
+    }
+
+    LightBounds Union(const LightBounds &a, const LightBounds &b) {
+        if (a.phi == 0) return b;
+        if (b.phi == 0) return a;
+        DirectionCone cone = Union(DirectionCone(a.w, a.cosTheta_o), DirectionCone(b.w, b.cosTheta_o));
+        return LightBounds(Union(a.bounds, b.bounds), cone.w, a.phi + b.phi, cone.cosTheta,
+                           std::min(a.cosTheta_e, b.cosTheta_e), a.twoSided || b.twoSided);
+    }
+
+    //cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a and b
+    static inline Float CosSubClamped(Float sinA, Float cosA, Float sinB, Float cosB) {
+        if (cosA > cosB) return 1;
+        return cosA * cosB + sinA * sinB;
+    }
+
+    static inline Float SinSubClamped(Float sinA, Float cosA, Float sinB, Float cosB) {
+        if (cosA > cosB) return 0;
+        return sinA * cosB - cosA * sinB;
+    }
+
+    Float LightBounds::Importance(const Point3f &p, const Normal3f &n) const {
+        Point3f pc = Centroid();
+        Float d2 = DistanceSquared(p, pc);
+        //do not let the importance blow up when p is near or inside the bounds
+        d2 = std::max(d2, bounds.Diagonal().Length() / 2);
+
+        Vector3f wi = Normalize(p - pc);
+        Float cosTheta_w = Dot(w, wi);
+        if (twoSided) cosTheta_w = std::abs(cosTheta_w);
+        Float sinTheta_w = SafeSqrt(1 - cosTheta_w * cosTheta_w);
+
+        //angle subtended by the bounds from p
+        Point3f center;
+        Float radius;
+        bounds.BoundingSphere(&center, &radius);
+        Float cosTheta_b = -1;
+        Float dc2 = DistanceSquared(p, center);
+        if (dc2 > radius * radius) cosTheta_b = SafeSqrt(1 - radius * radius / dc2);
+        Float sinTheta_b = SafeSqrt(1 - cosTheta_b * cosTheta_b);
+
+        //smallest angle between the emission cone and the direction to p
+        Float sinTheta_o = SafeSqrt(1 - cosTheta_o * cosTheta_o);
+        Float cosTheta_x = CosSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+        Float sinTheta_x = SinSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, cosTheta_o);
+        Float cosThetap = CosSubClamped(sinTheta_x, cosTheta_x, sinTheta_b, cosTheta_b);
+        if (cosThetap <= cosTheta_e) return 0;
+
+        Float importance = phi * cosThetap / d2;
+        if (n != Normal3f()) {
+            Float cosTheta_i = AbsDot(wi, n);
+            Float sinTheta_i = SafeSqrt(1 - cosTheta_i * cosTheta_i);
+            importance *= CosSubClamped(sinTheta_i, cosTheta_i, sinTheta_b, cosTheta_b);
+        }
+        return std::max<Float>(importance, 0);
+    }
+}
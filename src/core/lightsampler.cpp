@@ -0,0 +1,172 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#include "lightsampler.h"
+
+namespace sr {
+
+    LightSampler::~LightSampler() {}
+
+    const Light *UniformLightSampler::Sample(const Interaction &/*ref*/, Float u, Float *pmf) const {
+        if (lights.empty()) return nullptr;
+        int index = std::min<int>(int(u * lights.size()), int(lights.size()) - 1);
+        *pmf = 1 / Float(lights.size());
+        return lights[index].get();
+    }
+
+    Float UniformLightSampler::PMF(const Interaction &/*ref*/, const Light */*light*/) const {
+        return lights.empty() ? 0 : 1 / Float(lights.size());
+    }
+
+    PowerLightSampler::PowerLightSampler(const std::vector<std::shared_ptr<Light>> &lights) : lights(lights) {
+        std::vector<Float> power;
+        for (std::size_t i = 0; i < lights.size(); ++i) {
+            power.push_back(std::max<Float>(lights[i]->Power().y(), 0));
+            lightToIndex[lights[i].get()] = int(i);
+        }
+        //fall back to uniform when nothing reports power
+        bool allZero = true;
+        for (Float p : power) allZero &= p == 0;
+        if (allZero) std::fill(power.begin(), power.end(), Float(1));
+        aliasTable = AliasTable(power);
+    }
+
+    const Light *PowerLightSampler::Sample(const Interaction &/*ref*/, Float u, Float *pmf) const {
+        int index = aliasTable.Sample(u, pmf);
+        return index < 0 ? nullptr : lights[index].get();
+    }
+
+    Float PowerLightSampler::PMF(const Interaction &/*ref*/, const Light *light) const {
+        auto iter = lightToIndex.find(light);
+        return iter == lightToIndex.end() ? 0 : aliasTable.PMF(iter->second);
+    }
+
+    /**************************************************light BVH*********************************************************/
+
+    BVHLightSampler::BVHLightSampler(const std::vector<std::shared_ptr<Light>> &lights) {
+        std::vector<std::pair<int, LightBounds>> bvhLights;
+        for (const auto &light : lights) {
+            LightBounds lb;
+            if (!light->Bounds(&lb)) {
+                infiniteLights.push_back(light);
+            } else if (lb.phi > 0) {
+                bvhLights.push_back(std::make_pair(int(boundedLights.size()), lb));
+                boundedLights.push_back(light);
+            }
+        }
+        if (!bvhLights.empty()) Build(bvhLights, 0, int(bvhLights.size()), 0, 0);
+    }
+
+    LightBounds BVHLightSampler::Build(std::vector<std::pair<int, LightBounds>> &bvhLights, int start, int end,
+                                       uint64_t bitTrail, int depth) {
+        if (end - start == 1) {
+            const auto &light = bvhLights[start];
+            nodes.push_back(Node{light.second, light.first, true});
+            lightToBitTrail[boundedLights[light.first].get()] = bitTrail;
+            return light.second;
+        }
+        //median split of the centroids along the widest axis
+        Bounds3f centroidBounds(bvhLights[start].second.Centroid());
+        for (int i = start + 1; i < end; ++i) centroidBounds = Union(centroidBounds, bvhLights[i].second.Centroid());
+        Vector3f extent = centroidBounds.Diagonal();
+        int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+        int mid = (start + end) / 2;
+        std::nth_element(&bvhLights[start], &bvhLights[mid], &bvhLights[end - 1] + 1,
+                         [axis](const std::pair<int, LightBounds> &a, const std::pair<int, LightBounds> &b) {
+                             return a.second.Centroid()[axis] < b.second.Centroid()[axis];
+                         });
+
+        //the bit trail holds 64 levels, a median split of up to 2^64 lights never goes deeper
+        assert(depth < 64);
+        int nodeIndex = int(nodes.size());
+        nodes.push_back(Node{LightBounds(), -1, false});
+        LightBounds lb0 = Build(bvhLights, start, mid, bitTrail, depth + 1);
+        nodes[nodeIndex].childOrLightIndex = int(nodes.size());
+        LightBounds lb1 = Build(bvhLights, mid, end, bitTrail | (uint64_t(1) << depth), depth + 1);
+        nodes[nodeIndex].lightBounds = Union(lb0, lb1);
+        return nodes[nodeIndex].lightBounds;
+    }
+
+    const Light *BVHLightSampler::Sample(const Interaction &ref, Float u, Float *pmf) const {
+        Float pInfinite = InfiniteProbability();
+        if (u < pInfinite) {
+            u /= pInfinite;
+            int index = std::min<int>(int(u * infiniteLights.size()), int(infiniteLights.size()) - 1);
+            *pmf = pInfinite / infiniteLights.size();
+            return infiniteLights[index].get();
+        }
+        if (nodes.empty()) return nullptr;
+
+        u = std::min<Float>((u - pInfinite) / (1 - pInfinite), OneMinusEpsilon);
+        int nodeIndex = 0;
+        Float p = 1 - pInfinite;
+        while (true) {
+            const Node &node = nodes[nodeIndex];
+            if (node.isLeaf) {
+                //a single light at the root was never weighed against a sibling
+                if (nodeIndex > 0 || node.lightBounds.Importance(ref.p, ref.n) > 0) {
+                    *pmf = p;
+                    return boundedLights[node.childOrLightIndex].get();
+                }
+                return nullptr;
+            }
+            Float c0 = nodes[nodeIndex + 1].lightBounds.Importance(ref.p, ref.n);
+            Float c1 = nodes[node.childOrLightIndex].lightBounds.Importance(ref.p, ref.n);
+            if (c0 == 0 && c1 == 0) return nullptr;
+            //reuse u for the next level
+            Float p0 = c0 / (c0 + c1);
+            if (u < p0) {
+                nodeIndex = nodeIndex + 1;
+                u = std::min<Float>(u / p0, OneMinusEpsilon);
+                p *= p0;
+            } else {
+                nodeIndex = node.childOrLightIndex;
+                u = std::min<Float>((u - p0) / (1 - p0), OneMinusEpsilon);
+                p *= 1 - p0;
+            }
+        }
+    }
+
+    Float BVHLightSampler::PMF(const Interaction &ref, const Light *light) const {
+        auto iter = lightToBitTrail.find(light);
+        if (iter == lightToBitTrail.end()) {
+            for (const auto &l : infiniteLights) {
+                if (l.get() == light) return InfiniteProbability() / infiniteLights.size();
+            }
+            return 0;
+        }
+        uint64_t bitTrail = iter->second;
+        Float p = 1 - InfiniteProbability();
+        int nodeIndex = 0;
+        while (!nodes[nodeIndex].isLeaf) {
+            const Node &node = nodes[nodeIndex];
+            Float c0 = nodes[nodeIndex + 1].lightBounds.Importance(ref.p, ref.n);
+            Float c1 = nodes[node.childOrLightIndex].lightBounds.Importance(ref.p, ref.n);
+            if (c0 == 0 && c1 == 0) return 0;
+            if (bitTrail & 1) {
+                p *= c1 / (c0 + c1);
+                nodeIndex = node.childOrLightIndex;
+            } else {
+                p *= c0 / (c0 + c1);
+                nodeIndex = nodeIndex + 1;
+            }
+            bitTrail >>= 1;
+        }
+        if (nodeIndex == 0 && nodes[0].lightBounds.Importance(ref.p, ref.n) == 0) return 0;
+        return p;
+    }
+
+    std::unique_ptr<LightSampler> CreateLightSampler(LightSampling sampling,
+                                                     const std::vector<std::shared_ptr<Light>> &lights) {
+        switch (sampling) {
+            case LightSampling::Uniform:
+                return std::unique_ptr<LightSampler>(new UniformLightSampler(lights));
+            case LightSampling::BVH:
+                return std::unique_ptr<LightSampler>(new BVHLightSampler(lights));
+            case LightSampling::Power:
+            default:
+                return std::unique_ptr<LightSampler>(new PowerLightSampler(lights));
+        }
+    }
+}
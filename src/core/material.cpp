@@ -0,0 +1,122 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#include "material.h"
+#include "sampling.h"
+
+namespace sr {
+
+    Float FrDielectric(Float cosThetaI, Float etaI, Float etaT) {
+        cosThetaI = Clamp(cosThetaI, -1, 1);
+        if (cosThetaI <= 0) {
+            std::swap(etaI, etaT);
+            cosThetaI = -cosThetaI;
+        }
+        Float sinThetaI = SafeSqrt(1 - cosThetaI * cosThetaI);
+        Float sinThetaT = etaI / etaT * sinThetaI;
+        if (sinThetaT >= 1) return 1;
+        Float cosThetaT = SafeSqrt(1 - sinThetaT * sinThetaT);
+        Float rParl = ((etaT * cosThetaI) - (etaI * cosThetaT)) / ((etaT * cosThetaI) + (etaI * cosThetaT));
+        Float rPerp = ((etaI * cosThetaI) - (etaT * cosThetaT)) / ((etaI * cosThetaI) + (etaT * cosThetaT));
+        return (rParl * rParl + rPerp * rPerp) / 2;
+    }
+
+    bool Refract(const Vector3f &wi, const Vector3f &n, Float eta, Vector3f *wt) {
+        Float cosThetaI = Dot(n, wi);
+        Float sin2ThetaT = eta * eta * std::max(Float(0), 1 - cosThetaI * cosThetaI);
+        if (sin2ThetaT >= 1) return false;
+        Float cosThetaT = std::sqrt(1 - sin2ThetaT);
+        *wt = eta * -wi + (eta * cosThetaI - cosThetaT) * n;
+        return true;
+    }
+
+    static SampledSpectrum SampledReflectance(const RGBSpectrum &rgb) {
+        SampledSpectrum::Init();
+        return SampledSpectrum(rgb, SpectrumType::Reflectance);
+    }
+
+    Material::Material(const Spectrum &Kd, const Spectrum &Kr, const Spectrum &Kt, Float eta)
+            : Kd(Kd), Kr(Kr), Kt(Kt), eta(eta), sampledKd(SampledReflectance(Kd)),
+              sampledKr(SampledReflectance(Kr)), sampledKt(SampledReflectance(Kt)) {}
+
+    template<>
+    const RGBSpectrum &Material::Albedo<RGBSpectrum>(const RGBSpectrum &rgb, const SampledSpectrum &) {
+        return rgb;
+    }
+
+    template<>
+    const SampledSpectrum &Material::Albedo<SampledSpectrum>(const RGBSpectrum &, const SampledSpectrum &sampled) {
+        return sampled;
+    }
+
+    Float Material::DiffuseProbability() const {
+        if (!HasSpecular()) return 1;
+        if (!HasDiffuse()) return 0;
+        Float d = Kd.MaxComponentValue(), s = std::max(Kr.MaxComponentValue(), Kt.MaxComponentValue());
+        return d / (d + s);
+    }
+
+    template<typename SpectrumT>
+    SpectrumT Material::f(const Vector3f &wo, const Vector3f &wi, const Normal3f &n) const {
+        if (!HasDiffuse() || Dot(wo, n) * Dot(wi, n) <= 0) return SpectrumT(0.f);
+        return Albedo<SpectrumT>(Kd, sampledKd) * InvPi;
+    }
+
+    Float Material::Pdf(const Vector3f &wo, const Vector3f &wi, const Normal3f &n) const {
+        if (!HasDiffuse() || Dot(wo, n) * Dot(wi, n) <= 0) return 0;
+        return DiffuseProbability() * AbsDot(wi, n) * InvPi;
+    }
+
+    template<typename SpectrumT>
+    SpectrumT Material::Sample_f(const Vector3f &wo, const Normal3f &n, Float uc, const Point2f &u, Vector3f *wi,
+                                 Float *pdf, bool *specular) const {
+        Float pDiffuse = DiffuseProbability();
+        Vector3f nv(n);
+        if (uc < pDiffuse) {
+            //cosine weighted around the normal on the side of wo
+            Vector3f s, t;
+            CoordinateSystem(nv, &s, &t);
+            Vector3f w = CosineSampleHemisphere(u);
+            Float side = Dot(wo, nv) < 0 ? -1 : 1;
+            *wi = w.x * s + w.y * t + (side * w.z) * nv;
+            *specular = false;
+            *pdf = pDiffuse * w.z * InvPi;
+            return *pdf == 0 ? SpectrumT(0.f) : Albedo<SpectrumT>(Kd, sampledKd) * InvPi;
+        }
+
+        //reuse uc to choose between the specular lobes
+        uc = pDiffuse < 1 ? (uc - pDiffuse) / (1 - pDiffuse) : 0;
+        *specular = true;
+        Float cosThetaO = Dot(wo, nv);
+        if (cosThetaO == 0) {
+            *pdf = 0;
+            return SpectrumT(0.f);
+        }
+        Float F = Kt.IsBlack() ? 1 : FrDielectric(cosThetaO, 1, eta);
+        if (uc < F) {
+            *wi = Reflect(wo, nv);
+            *pdf = (1 - pDiffuse) * F;
+            return Albedo<SpectrumT>(Kr, sampledKr) * (F / std::abs(cosThetaO));
+        }
+        //transmission through a dielectric, eta is inside over outside
+        bool entering = cosThetaO > 0;
+        Float etaRatio = entering ? 1 / eta : eta;
+        if (!Refract(wo, entering ? nv : -nv, etaRatio, wi)) {
+            *pdf = 0;
+            return SpectrumT(0.f);
+        }
+        *pdf = (1 - pDiffuse) * (1 - F);
+        return Albedo<SpectrumT>(Kt, sampledKt) * ((1 - F) / AbsDot(*wi, nv));
+    }
+
+    template RGBSpectrum Material::f<RGBSpectrum>(const Vector3f &, const Vector3f &, const Normal3f &) const;
+
+    template SampledSpectrum Material::f<SampledSpectrum>(const Vector3f &, const Vector3f &, const Normal3f &) const;
+
+    template RGBSpectrum Material::Sample_f<RGBSpectrum>(const Vector3f &, const Normal3f &, Float, const Point2f &,
+                                                         Vector3f *, Float *, bool *) const;
+
+    template SampledSpectrum Material::Sample_f<SampledSpectrum>(const Vector3f &, const Normal3f &, Float,
+                                                                 const Point2f &, Vector3f *, Float *, bool *) const;
+}
@@ -5,4 +5,28 @@
 #include "medium.h"
 namespace sr{
 
-}
\ No newline at end of file
+    PhaseFunction::~PhaseFunction() {}
+
+    Medium::~Medium() {}
+
+    Float HenyeyGreenstein::p(const Vector3f &wo, const Vector3f &wi) const {
+        return PhaseHG(Dot(wo, wi), g);
+    }
+
+    Float HenyeyGreenstein::Sample_p(const Vector3f &wo, Vector3f *wi, const Point2f &u) const {
+        //invert the cdf of cosTheta measured against -wo, the unscattered direction
+        Float cosTheta;
+        if (std::abs(g) < 1e-3f) {
+            cosTheta = 1 - 2 * u[0];
+        } else {
+            Float sqrTerm = (1 - g * g) / (1 - g + 2 * g * u[0]);
+            cosTheta = (1 + g * g - sqrTerm * sqrTerm) / (2 * g);
+        }
+        Float sinTheta = SafeSqrt(1 - cosTheta * cosTheta);
+        Float phi = 2 * Pi * u[1];
+        Vector3f v1, v2;
+        CoordinateSystem(wo, &v1, &v2);
+        *wi = SphericalDirection(sinTheta, cosTheta, phi, v1, v2, -wo);
+        return PhaseHG(-cosTheta, g);
+    }
+}
@@ -0,0 +1,64 @@
+//
+// Created by 18310 on 2021/5/2.
+//
+
+#include "memory.h"
+#include <cstdlib>
+
+namespace sr {
+
+    void *AllocAligned(std::size_t size) {
+#if defined(_WIN32)
+        return _aligned_malloc(size, SIMPLERENDERER_L1_CACHE_LINE_SIZE);
+#else
+        void *ptr;
+        if (posix_memalign(&ptr, SIMPLERENDERER_L1_CACHE_LINE_SIZE, size) != 0) ptr = nullptr;
+        return ptr;
+#endif
+    }
+
+    void FreeAligned(void *ptr) {
+        if (!ptr) return;
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    MemoryArena::~MemoryArena() {
+        FreeAligned(currentBlock);
+        for (auto &block : usedBlocks) FreeAligned(block.second);
+        for (auto &block : availableBlocks) FreeAligned(block.second);
+    }
+
+    void MemoryArena::NextBlock(std::size_t nBytes) {
+        if (currentBlock) {
+            usedBlocks.push_back(std::make_pair(currentAllocSize, currentBlock));
+            currentBlock = nullptr;
+            currentAllocSize = 0;
+        }
+        //recycle the first free block that is large enough
+        for (auto iter = availableBlocks.begin(); iter != availableBlocks.end(); ++iter) {
+            if (iter->first >= nBytes) {
+                currentAllocSize = iter->first;
+                currentBlock = iter->second;
+                availableBlocks.erase(iter);
+                break;
+            }
+        }
+        if (!currentBlock) {
+            currentAllocSize = std::max(nBytes, blockSize);
+            currentBlock = AllocAligned<uint8_t>(currentAllocSize);
+            if (!currentBlock) throw std::bad_alloc();
+        }
+        currentBlockPos = 0;
+    }
+
+    std::size_t MemoryArena::TotalAllocated() const {
+        std::size_t total = currentAllocSize;
+        for (const auto &block : usedBlocks) total += block.first;
+        for (const auto &block : availableBlocks) total += block.first;
+        return total;
+    }
+}
@@ -0,0 +1,140 @@
+//
+// Created by 18310 on 2021/4/12.
+//
+
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sr {
+
+    thread_local int ThreadIndex = 0;
+
+    static int threadCount = 0;
+
+    //set while the thread runs a ParallelFor body, nested loops run serially
+    static thread_local bool inParallelFor = false;
+
+    void SetThreadCount(int nThreads) {
+        threadCount = std::max(nThreads, 0);
+    }
+
+    int NumSystemCores() {
+        if (threadCount > 0) return threadCount;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    //one loop handed to the pool
+    struct ParallelForLoop {
+        const std::function<void(int64_t)> &func;
+        const int64_t count, nChunks;
+        const int chunkSize;
+        //threads taking part, the caller included
+        const int nThreads;
+        std::atomic<int64_t> nextChunk{0};
+        //pool threads that have not finished their share yet, guarded by the pool mutex
+        int active;
+
+        ParallelForLoop(const std::function<void(int64_t)> &func, int64_t count, int chunkSize, int nThreads)
+                : func(func), count(count), nChunks((count + chunkSize - 1) / chunkSize), chunkSize(chunkSize),
+                  nThreads(nThreads), active(nThreads - 1) {}
+
+        //every thread grabs the next chunk until the loop is exhausted
+        void Run() {
+            inParallelFor = true;
+            int64_t chunk;
+            while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < nChunks) {
+                int64_t start = chunk * chunkSize;
+                int64_t end = std::min(start + chunkSize, count);
+                for (int64_t i = start; i < end; ++i) func(i);
+            }
+            inParallelFor = false;
+        }
+    };
+
+    //Threads are started on first use and kept until exit, so a loop costs a wake-up instead of a
+    //thread creation. Pool thread i runs with ThreadIndex i + 1 and takes part in loops of more than
+    //i + 1 threads; the pool only grows when SetThreadCount raises the count.
+    class ThreadPool {
+    public:
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                shutdown = true;
+            }
+            workCondition.notify_all();
+            for (std::thread &t : threads) t.join();
+        }
+
+        void Run(ParallelForLoop &loop) {
+            //loops from different outside threads take turns
+            std::lock_guard<std::mutex> runLock(runMutex);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (int(threads.size()) < loop.nThreads - 1) {
+                    int index = int(threads.size()) + 1;
+                    threads.emplace_back([this, index]() { Worker(index); });
+                }
+                current = &loop;
+                ++generation;
+            }
+            workCondition.notify_all();
+            ThreadIndex = 0;
+            loop.Run();
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCondition.wait(lock, [&]() { return loop.active == 0; });
+            current = nullptr;
+        }
+
+    private:
+        void Worker(int index) {
+            ThreadIndex = index;
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                workCondition.wait(lock, [&]() { return shutdown || generation != seen; });
+                if (shutdown) return;
+                seen = generation;
+                ParallelForLoop *loop = current;
+                if (!loop || index >= loop->nThreads) continue;
+                lock.unlock();
+                loop->Run();
+                lock.lock();
+                if (--loop->active == 0) doneCondition.notify_one();
+            }
+        }
+
+        std::mutex runMutex, mutex;
+        std::condition_variable workCondition, doneCondition;
+        std::vector<std::thread> threads;
+        ParallelForLoop *current = nullptr;
+        uint64_t generation = 0;
+        bool shutdown = false;
+    };
+
+    void ParallelFor(const std::function<void(int64_t)> &func, int64_t count, int chunkSize) {
+        if (count <= 0) return;
+        chunkSize = std::max(chunkSize, 1);
+        int64_t nChunks = (count + chunkSize - 1) / chunkSize;
+        int nThreads = (int) std::min<int64_t>(NumSystemCores(), nChunks);
+        if (inParallelFor || nThreads == 1) {
+            for (int64_t i = 0; i < count; ++i) func(i);
+            return;
+        }
+
+        static ThreadPool pool;
+        ParallelForLoop loop(func, count, chunkSize, nThreads);
+        pool.Run(loop);
+    }
+
+    void ParallelFor2D(const std::function<void(Point2i)> &func, const Point2i &count) {
+        if (count.x <= 0 || count.y <= 0) return;
+        ParallelFor([&](int64_t i) {
+            func(Point2i(int(i % count.x), int(i / count.x)));
+        }, int64_t(count.x) * count.y);
+    }
+
+}
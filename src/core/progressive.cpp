@@ -0,0 +1,142 @@
+//
+// Created by 18310 on 2021/4/24.
+//
+
+#include "progressive.h"
+#include "parallel.h"
+
+namespace sr {
+
+    ProgressiveRenderer::ProgressiveRenderer(Film *film, PixelSampleFunc func, const ProgressiveOptions &options)
+            : film(film), func(std::move(func)), options(options), stopRequested(false) {
+        //tiles are handed out in tileOrder, ParallelFor gives them away in sequence
+        Bounds2i sampleBounds = film->GetSampleBounds();
+        Vector2i extent = sampleBounds.Diagonal();
+        int tileSize = std::max(1, options.tileSize);
+        Bounds2i tileGrid(Point2i(0, 0), Point2i((extent.x + tileSize - 1) / tileSize,
+                                                 (extent.y + tileSize - 1) / tileSize));
+        for (Point2i t : Bounds2iCurve(tileGrid, options.tileOrder)) {
+            Point2i p0(sampleBounds.pMin.x + t.x * tileSize, sampleBounds.pMin.y + t.y * tileSize);
+            Point2i p1(std::min(p0.x + tileSize, sampleBounds.pMax.x), std::min(p0.y + tileSize, sampleBounds.pMax.y));
+            activeTiles.emplace_back(p0, p1);
+        }
+        if (options.errorThreshold > 0) film->EnablePixelStatistics();
+    }
+
+    double ProgressiveRenderer::Elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    bool ProgressiveRenderer::OutOfTime() const {
+        return stopRequested.load(std::memory_order_relaxed) ||
+               (options.timeBudget > 0 && Elapsed() >= options.timeBudget);
+    }
+
+    int ProgressiveRenderer::Render() {
+        startTime = std::chrono::steady_clock::now();
+        //sized here, the thread count may have changed since construction
+        arenas = AlignedArray<MemoryArena>(MaxThreadIndex());
+        int samplesPerPass = std::max(1, options.samplesPerPass);
+        int pass = 0;
+        double secondsPerSample = 0;
+
+        while (!OutOfTime()) {
+            int64_t nSamples = samplesPerPass;
+            if (options.maxSamplesPerPixel > 0) {
+                nSamples = std::min(nSamples, options.maxSamplesPerPixel - samplesTaken);
+                if (nSamples <= 0) break;
+            }
+            //shrink the last pass so it can still complete and publish a snapshot inside the budget
+            if (options.timeBudget > 0 && secondsPerSample > 0) {
+                double remaining = options.timeBudget - Elapsed();
+                nSamples = std::max<int64_t>(1, std::min<int64_t>(nSamples, int64_t(remaining / secondsPerSample)));
+            }
+
+            double passStart = Elapsed();
+            std::atomic<bool> interrupted(false);
+            int64_t firstSample = samplesTaken;
+            ParallelFor([&](int64_t t) {
+                if (OutOfTime()) {
+                    interrupted = true;
+                    return;
+                }
+                const Bounds2i &tileBounds = activeTiles[t];
+                std::unique_ptr<FilmTile> tile = film->GetFilmTile(tileBounds);
+                MemoryArena &arena = arenas[ThreadIndex];
+                for (int y = tileBounds.pMin.y; y < tileBounds.pMax.y; ++y) {
+                    //finished rows are still merged, the film stays a valid weighted average
+                    if (OutOfTime()) {
+                        interrupted = true;
+                        break;
+                    }
+                    for (int x = tileBounds.pMin.x; x < tileBounds.pMax.x; ++x) {
+                        for (int64_t s = firstSample; s < firstSample + nSamples; ++s) {
+                            func(Point2i(x, y), s, tile.get(), arena);
+                            arena.Reset();
+                        }
+                    }
+                }
+                film->MergeFilmTile(std::move(tile));
+            }, activeTiles.size());
+
+            if (interrupted) break;
+            samplesTaken += nSamples;
+            secondsPerSample = (Elapsed() - passStart) / nSamples;
+
+            std::vector<Float> rgb(3 * std::max(0, film->croppedPixelBounds.SurfaceArea()));
+            film->GetRGB(rgb.data());
+            {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+                snapshot = rgb;
+                snapshotPass = pass;
+            }
+            //called on the local copy without the lock, so the callback may call GetSnapshot
+            if (options.onPass) options.onPass(rgb, pass);
+            ++pass;
+
+            if (options.errorThreshold > 0 && samplesTaken >= options.minAdaptiveSamples) {
+                UpdateActiveTiles();
+                if (activeTiles.empty()) break;
+            }
+        }
+        return pass;
+    }
+
+    void ProgressiveRenderer::UpdateActiveTiles() {
+        std::vector<Float> errors(activeTiles.size());
+        ParallelFor([&](int64_t t) { errors[t] = film->Error(activeTiles[t]); }, activeTiles.size());
+        std::vector<Bounds2i> remaining;
+        for (std::size_t t = 0; t < activeTiles.size(); ++t) {
+            if (errors[t] >= options.errorThreshold) remaining.push_back(activeTiles[t]);
+        }
+
+        //few noisy tiles would leave threads idle, split them in quadrants so freed threads can help
+        const int minTileSide = 4;
+        while (!remaining.empty() && remaining.size() < std::size_t(NumSystemCores())) {
+            std::vector<Bounds2i> split;
+            for (const Bounds2i &b : remaining) {
+                Vector2i d = b.Diagonal();
+                if (d.x < 2 * minTileSide || d.y < 2 * minTileSide) {
+                    split.push_back(b);
+                    continue;
+                }
+                Point2i mid(b.pMin.x + d.x / 2, b.pMin.y + d.y / 2);
+                split.emplace_back(b.pMin, mid);
+                split.emplace_back(Point2i(mid.x, b.pMin.y), Point2i(b.pMax.x, mid.y));
+                split.emplace_back(Point2i(b.pMin.x, mid.y), Point2i(mid.x, b.pMax.y));
+                split.emplace_back(mid, b.pMax);
+            }
+            if (split.size() == remaining.size()) break;
+            remaining.swap(split);
+        }
+        activeTiles.swap(remaining);
+    }
+
+    bool ProgressiveRenderer::GetSnapshot(std::vector<Float> *rgb, int *pass) const {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        if (snapshotPass < 0) return false;
+        *rgb = snapshot;
+        if (pass) *pass = snapshotPass;
+        return true;
+    }
+}
@@ -0,0 +1,265 @@
+//
+// Created by 18310 on 2021/5/11.
+//
+
+#include "renderserver.h"
+#include "box.h"
+#include "parallel.h"
+#include "perspective.h"
+#include "socket.h"
+#include "stats.h"
+#include "sobol.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace sr {
+
+    template<typename T>
+    static void Put(std::vector<uint8_t> *buf, const T &v) {
+        std::size_t offset = buf->size();
+        buf->resize(offset + sizeof(T));
+        std::memcpy(buf->data() + offset, &v, sizeof(T));
+    }
+
+    template<typename T>
+    static bool Get(const std::vector<uint8_t> &buf, std::size_t *offset, T *v) {
+        if (*offset + sizeof(T) > buf.size()) return false;
+        std::memcpy(v, buf.data() + *offset, sizeof(T));
+        *offset += sizeof(T);
+        return true;
+    }
+
+    void EncodeRenderJob(const RenderJob &job, std::vector<uint8_t> *buf) {
+        float camera[10] = {job.eye.x, job.eye.y, job.eye.z, job.target.x, job.target.y, job.target.z,
+                            job.up.x, job.up.y, job.up.z, job.fov};
+        int32_t pixels[6] = {job.resolution.x, job.resolution.y, job.crop.pMin.x, job.crop.pMin.y,
+                             job.crop.pMax.x, job.crop.pMax.y};
+        Put(buf, camera);
+        Put(buf, pixels);
+        Put(buf, job.samplesPerPixel);
+        Put(buf, int32_t(job.tileSize));
+        Put(buf, job.seed);
+        Put(buf, uint32_t(job.spectrum));
+    }
+
+    bool DecodeRenderJob(const std::vector<uint8_t> &buf, RenderJob *job) {
+        float camera[10];
+        int32_t pixels[6], tileSize;
+        uint32_t spectrum;
+        std::size_t offset = 0;
+        if (!Get(buf, &offset, &camera) || !Get(buf, &offset, &pixels) || !Get(buf, &offset, &job->samplesPerPixel) ||
+            !Get(buf, &offset, &tileSize) || !Get(buf, &offset, &job->seed) || !Get(buf, &offset, &spectrum) ||
+            offset != buf.size() || spectrum > uint32_t(SpectrumRepresentation::Sampled))
+            return false;
+        job->eye = Point3f(camera[0], camera[1], camera[2]);
+        job->target = Point3f(camera[3], camera[4], camera[5]);
+        job->up = Vector3f(camera[6], camera[7], camera[8]);
+        job->fov = camera[9];
+        job->resolution = Point2i(pixels[0], pixels[1]);
+        job->crop.pMin = Point2i(pixels[2], pixels[3]);
+        job->crop.pMax = Point2i(pixels[4], pixels[5]);
+        job->tileSize = tileSize;
+        job->spectrum = SpectrumRepresentation(spectrum);
+        return true;
+    }
+
+    std::string ValidateRenderJob(const RenderJob &job) {
+        const int maxResolution = 1 << 15;
+        if (job.resolution.x <= 0 || job.resolution.y <= 0 || job.resolution.x > maxResolution ||
+            job.resolution.y > maxResolution)
+            return "invalid resolution";
+        if (job.samplesPerPixel <= 0) return "invalid sample count";
+        if (job.tileSize <= 0) return "invalid tile size";
+        bool cropped = job.crop.pMin.x != 0 || job.crop.pMin.y != 0 || job.crop.pMax.x != 0 || job.crop.pMax.y != 0;
+        if (cropped && (job.crop.pMin.x >= job.crop.pMax.x || job.crop.pMin.y >= job.crop.pMax.y))
+            return "empty or inverted crop window";
+        if (cropped && (job.crop.pMin.x < 0 || job.crop.pMin.y < 0 || job.crop.pMax.x > job.resolution.x ||
+                        job.crop.pMax.y > job.resolution.y))
+            return "crop outside the image";
+        if (!(job.fov > 0 && job.fov < 180)) return "invalid field of view";
+        return "";
+    }
+
+    std::unique_ptr<Film> CreateJobFilm(const RenderJob &job, const std::string &filename) {
+        Bounds2i crop = job.crop;
+        if (crop.SurfaceArea() <= 0) crop = Bounds2i(Point2i(0, 0), job.resolution);
+        //half a pixel inside, so the film's ceil lands on the crop's pixels whatever the rounding
+        Point2f res(Float(job.resolution.x), Float(job.resolution.y));
+        Bounds2f window(Point2f((crop.pMin.x - 0.5f) / res.x, (crop.pMin.y - 0.5f) / res.y),
+                        Point2f((crop.pMax.x - 0.5f) / res.x, (crop.pMax.y - 0.5f) / res.y));
+        return std::unique_ptr<Film>(new Film(job.resolution, window,
+                                              std::unique_ptr<Filter>(new BoxFilter(Vector2f(0.5f, 0.5f))),
+                                              filename));
+    }
+
+    std::vector<Bounds2i> JobTiles(const RenderJob &job, const Film &film) {
+        Bounds2i sampleBounds = film.GetSampleBounds();
+        Vector2i extent = sampleBounds.Diagonal();
+        //a tile larger than the image is the whole image, and p0 + tileSize cannot overflow
+        int tileSize = std::min({job.tileSize, MaxJobTileSize, std::max(std::max(extent.x, extent.y), 1)});
+        Bounds2i tileGrid(Point2i(0, 0), Point2i((extent.x + tileSize - 1) / tileSize,
+                                                 (extent.y + tileSize - 1) / tileSize));
+        std::vector<Bounds2i> tiles;
+        for (Point2i t : Bounds2iCurve(tileGrid, CurveOrder::Spiral)) {
+            Point2i p0(sampleBounds.pMin.x + t.x * tileSize, sampleBounds.pMin.y + t.y * tileSize);
+            Point2i p1(std::min(p0.x + tileSize, sampleBounds.pMax.x), std::min(p0.y + tileSize, sampleBounds.pMax.y));
+            tiles.emplace_back(p0, p1);
+        }
+        return tiles;
+    }
+
+    JobContext::JobContext(const Scene &scene, const RenderJob &job, const GuidedPathOptions &options)
+            : job(job), film(CreateJobFilm(job, "")) {
+        camera = std::make_shared<PerspectiveCamera>(Inverse(LookAt(job.eye, job.target, job.up)),
+                                                     DefaultScreenWindow(job.resolution), 0, 1, 0, 1, job.fov,
+                                                     film.get());
+        GuidedPathOptions opts = options;
+        opts.spectrum = job.spectrum;
+        integrator.reset(new GuidedPathIntegrator(
+                camera, std::unique_ptr<Sampler>(new SobolSampler(job.samplesPerPixel, job.seed)), opts));
+        integrator->Preprocess(scene);
+        func = integrator->SampleFunc(scene);
+        tiles = JobTiles(job, *film);
+    }
+
+    std::unique_ptr<FilmTile> JobContext::RenderTile(int t, MemoryArena &arena) const {
+        std::unique_ptr<FilmTile> tile = film->GetFilmTile(tiles[t]);
+        for (Point2i p : tiles[t]) {
+            for (int64_t s = 0; s < job.samplesPerPixel; ++s) {
+                func(p, s, tile.get(), arena);
+                arena.Reset();
+            }
+        }
+        return tile;
+    }
+
+    RenderServer::RenderServer(std::shared_ptr<const Scene> scene, const GuidedPathOptions &options)
+            : scene(std::move(scene)), options(options), listenFd(-1), stopRequested(false) {
+        this->options.guiding = false;
+    }
+
+    //how often a server waiting on an idle client checks for Stop()
+    static constexpr int ServerPollMs = 100;
+    //a client that stalls in the middle of a message or stops reading tiles is dropped after this long
+    static constexpr int ServerReceiveTimeoutMs = 10000, ServerSendTimeoutMs = 10000;
+
+    bool RenderServer::Serve(const std::string &path) {
+        int fd = ListenUnix(path);
+        if (fd < 0) return false;
+        listenFd = fd;
+        bool shutdown = false;
+        while (!shutdown && !stopRequested) {
+            int client = AcceptConnection(fd);
+            if (client < 0) break;
+            SetReceiveTimeout(client, ServerReceiveTimeoutMs);
+            SetSendTimeout(client, ServerSendTimeoutMs);
+            uint32_t type;
+            std::vector<uint8_t> payload;
+            while (true) {
+                //an idle client must not keep Stop() from taking effect
+                while (!stopRequested && WaitReadable({client}, ServerPollMs) < 0) {}
+                if (stopRequested || !ReceiveMessage(client, &type, &payload, MaxRenderJobPayload)) break;
+                if (type == uint32_t(RenderMessage::Shutdown)) {
+                    shutdown = true;
+                    continue;
+                }
+                RenderJob job;
+                std::string error = type != uint32_t(RenderMessage::Job) ? "unknown message" :
+                                    !DecodeRenderJob(payload, &job) ? "malformed job" : ValidateRenderJob(job);
+                if (!error.empty()) {
+                    if (!SendMessage(client, uint32_t(RenderMessage::Error), error.data(), error.size())) break;
+                    continue;
+                }
+                if (!Render(client, job)) break;
+            }
+            CloseSocket(client);
+        }
+        listenFd = -1;
+        CloseSocket(fd);
+        std::remove(path.c_str());
+        return true;
+    }
+
+    void RenderServer::Stop() {
+        stopRequested = true;
+        ShutdownSocket(listenFd);
+    }
+
+    bool RenderServer::Render(int fd, const RenderJob &job) {
+        auto start = std::chrono::steady_clock::now();
+        JobContext context(*scene, job, options);
+        const std::vector<Bounds2i> &tiles = context.Tiles();
+
+        AlignedArray<MemoryArena> arenas(MaxThreadIndex());
+        std::mutex sendMutex;
+        std::atomic<bool> clientGone(false);
+        std::atomic<int64_t> payloadBytes(0);
+        ParallelFor([&](int64_t t) {
+            if (clientGone) return;
+            std::unique_ptr<FilmTile> tile = context.RenderTile(int(t), arenas[ThreadIndex]);
+            std::vector<uint8_t> payload;
+            tile->Encode(&payload);
+            payloadBytes += int64_t(payload.size());
+            std::lock_guard<std::mutex> lock(sendMutex);
+            if (!SendMessage(fd, uint32_t(RenderMessage::Tile), payload)) clientGone = true;
+        }, tiles.size());
+        if (clientGone) return false;
+
+        RenderJobStats stats;
+        stats.tiles = int64_t(tiles.size());
+        stats.payloadBytes = payloadBytes;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++jobsServed;
+        bool sent = SendMessage(fd, uint32_t(RenderMessage::JobDone), &stats, sizeof(stats));
+        //counters and validation failures of this job only
+        PrintStats(std::cerr);
+        ClearStats();
+        return sent;
+    }
+
+    bool RequestRender(const std::string &path, const RenderJob &job, Film *film, RenderJobStats *stats,
+                       const std::function<void(const Bounds2i &tile)> &onTile) {
+        int fd = ConnectUnix(path);
+        if (fd < 0) return false;
+        std::vector<uint8_t> payload;
+        EncodeRenderJob(job, &payload);
+        bool ok = SendMessage(fd, uint32_t(RenderMessage::Job), payload);
+        uint32_t type;
+        while (ok) {
+            if (!ReceiveMessage(fd, &type, &payload)) {
+                std::cerr << "RequestRender: connection to \"" << path << "\" lost\n";
+                ok = false;
+            } else if (type == uint32_t(RenderMessage::Tile)) {
+                std::unique_ptr<FilmTile> tile = film->DecodeFilmTile(payload.data(), payload.size());
+                if (!tile) {
+                    std::cerr << "RequestRender: tile does not fit the film\n";
+                    ok = false;
+                    continue;
+                }
+                film->MergeFilmTile(*tile);
+                if (onTile) onTile(tile->GetPixelBounds());
+            } else if (type == uint32_t(RenderMessage::JobDone) && payload.size() == sizeof(RenderJobStats)) {
+                if (stats) std::memcpy(stats, payload.data(), sizeof(RenderJobStats));
+                break;
+            } else if (type == uint32_t(RenderMessage::Error)) {
+                std::cerr << "RequestRender: server refused the job: "
+                          << std::string(payload.begin(), payload.end()) << "\n";
+                ok = false;
+            } else {
+                std::cerr << "RequestRender: unexpected message " << type << "\n";
+                ok = false;
+            }
+        }
+        CloseSocket(fd);
+        return ok;
+    }
+
+    bool RequestShutdown(const std::string &path) {
+        int fd = ConnectUnix(path);
+        if (fd < 0) return false;
+        bool ok = SendMessage(fd, uint32_t(RenderMessage::Shutdown), nullptr, 0);
+        CloseSocket(fd);
+        return ok;
+    }
+}
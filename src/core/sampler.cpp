@@ -0,0 +1,19 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#include "sampler.h"
+
+namespace sr {
+
+    Sampler::~Sampler() {}
+
+    CameraSample Sampler::GetCameraSample(const Point2i &pRaster) {
+        CameraSample cs;
+        Point2f pPixel = GetPixel2D();
+        cs.pFilm = Point2f(pRaster.x + pPixel.x, pRaster.y + pPixel.y);
+        cs.time = Get1D();
+        cs.pLens = Get2D();
+        return cs;
+    }
+}
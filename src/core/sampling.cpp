@@ -0,0 +1,140 @@
+//
+// Created by 18310 on 2021/4/28.
+//
+
+#include "sampling.h"
+
+namespace sr {
+
+    Point2f ConcentricSampleDisk(const Point2f &u) {
+        Float ox = 2 * u.x - 1, oy = 2 * u.y - 1;
+        if (ox == 0 && oy == 0) return Point2f(0, 0);
+        Float r, theta;
+        if (std::abs(ox) > std::abs(oy)) {
+            r = ox;
+            theta = (Pi / 4) * (oy / ox);
+        } else {
+            r = oy;
+            theta = Pi / 2 - (Pi / 4) * (ox / oy);
+        }
+        return Point2f(r * std::cos(theta), r * std::sin(theta));
+    }
+
+    Vector3f UniformSampleSphere(const Point2f &u) {
+        Float z = 1 - 2 * u.x;
+        Float r = SafeSqrt(1 - z * z);
+        Float phi = 2 * Pi * u.y;
+        return Vector3f(r * std::cos(phi), r * std::sin(phi), z);
+    }
+
+    Vector3f UniformSampleCone(const Point2f &u, Float cosThetaMax) {
+        Float cosTheta = (1 - u.x) + u.x * cosThetaMax;
+        Float sinTheta = SafeSqrt(1 - cosTheta * cosTheta);
+        Float phi = u.y * 2 * Pi;
+        return Vector3f(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+    }
+
+    Distribution1D::Distribution1D(const Float *f, int n) : func(f, f + n), cdf(n + 1) {
+        cdf[0] = 0;
+        for (int i = 1; i < n + 1; ++i) cdf[i] = cdf[i - 1] + std::abs(func[i - 1]) / n;
+        funcInt = cdf[n];
+        //a zero function is sampled uniformly
+        if (funcInt == 0) {
+            for (int i = 1; i < n + 1; ++i) cdf[i] = Float(i) / Float(n);
+        } else {
+            for (int i = 1; i < n + 1; ++i) cdf[i] /= funcInt;
+        }
+    }
+
+    Float Distribution1D::SampleContinuous(Float u, Float *pdf, int *off) const {
+        int offset = FindInterval(int(cdf.size()), [&](int index) { return cdf[index] <= u; });
+        if (off) *off = offset;
+        Float du = u - cdf[offset];
+        if (cdf[offset + 1] - cdf[offset] > 0) du /= cdf[offset + 1] - cdf[offset];
+        if (pdf) *pdf = funcInt > 0 ? func[offset] / funcInt : 0;
+        return (offset + du) / Count();
+    }
+
+    int Distribution1D::SampleDiscrete(Float u, Float *pdf, Float *uRemapped) const {
+        int offset = FindInterval(int(cdf.size()), [&](int index) { return cdf[index] <= u; });
+        if (pdf) *pdf = funcInt > 0 ? func[offset] / (funcInt * Count()) : 0;
+        if (uRemapped) *uRemapped = (u - cdf[offset]) / (cdf[offset + 1] - cdf[offset]);
+        return offset;
+    }
+
+    Distribution2D::Distribution2D(const Float *func, int nu, int nv) {
+        for (int v = 0; v < nv; ++v) pConditionalV.emplace_back(new Distribution1D(&func[v * nu], nu));
+        std::vector<Float> marginalFunc;
+        for (int v = 0; v < nv; ++v) marginalFunc.push_back(pConditionalV[v]->funcInt);
+        pMarginal.reset(new Distribution1D(&marginalFunc[0], nv));
+    }
+
+    Point2f Distribution2D::SampleContinuous(const Point2f &u, Float *pdf) const {
+        Float pdfs[2];
+        int v;
+        Float d1 = pMarginal->SampleContinuous(u.y, &pdfs[1], &v);
+        Float d0 = pConditionalV[v]->SampleContinuous(u.x, &pdfs[0]);
+        *pdf = pdfs[0] * pdfs[1];
+        return Point2f(d0, d1);
+    }
+
+    Float Distribution2D::Pdf(const Point2f &p) const {
+        int iu = Clamp(int(p.x * pConditionalV[0]->Count()), 0, pConditionalV[0]->Count() - 1);
+        int iv = Clamp(int(p.y * pMarginal->Count()), 0, pMarginal->Count() - 1);
+        if (pMarginal->funcInt == 0) return 0;
+        return pConditionalV[iv]->func[iu] / pMarginal->funcInt;
+    }
+
+    AliasTable::AliasTable(const std::vector<Float> &weights) : bins(weights.size()) {
+        double sum = 0;
+        for (Float w : weights) {
+            assert(w >= 0);
+            sum += w;
+        }
+        if (sum == 0) {
+            bins.clear();
+            return;
+        }
+        for (std::size_t i = 0; i < weights.size(); ++i) bins[i].p = Float(weights[i] / sum);
+
+        //Vose's construction: pair every underfull bin with an overfull one
+        struct Outcome {
+            double pHat;
+            std::size_t index;
+        };
+        std::vector<Outcome> under, over;
+        for (std::size_t i = 0; i < bins.size(); ++i) {
+            double pHat = double(bins[i].p) * bins.size();
+            if (pHat < 1) under.push_back({pHat, i});
+            else over.push_back({pHat, i});
+        }
+        while (!under.empty() && !over.empty()) {
+            Outcome un = under.back(), ov = over.back();
+            under.pop_back();
+            over.pop_back();
+            bins[un.index].q = Float(un.pHat);
+            bins[un.index].alias = int(ov.index);
+            double excess = un.pHat + ov.pHat - 1;
+            if (excess < 1) under.push_back({excess, ov.index});
+            else over.push_back({excess, ov.index});
+        }
+        //the rest are 1 up to rounding error
+        for (const Outcome &o : over) bins[o.index].q = 1;
+        for (const Outcome &o : under) bins[o.index].q = 1;
+    }
+
+    int AliasTable::Sample(Float u, Float *pmf, Float *uRemapped) const {
+        if (bins.empty()) return -1;
+        int offset = std::min<int>(int(u * bins.size()), int(bins.size()) - 1);
+        Float up = std::min<Float>(u * bins.size() - offset, OneMinusEpsilon);
+        if (up < bins[offset].q) {
+            if (pmf) *pmf = bins[offset].p;
+            if (uRemapped) *uRemapped = std::min<Float>(up / bins[offset].q, OneMinusEpsilon);
+            return offset;
+        }
+        int alias = bins[offset].alias;
+        if (pmf) *pmf = bins[alias].p;
+        if (uRemapped) *uRemapped = std::min<Float>((up - bins[offset].q) / (1 - bins[offset].q), OneMinusEpsilon);
+        return alias;
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#include "scene.h"
+#include "interaction.h"
+
+namespace sr {
+
+    Scene::Scene(std::vector<Primitive> primitives, std::vector<std::shared_ptr<Light>> lights)
+            : primitives(std::move(primitives)), lights(std::move(lights)) {
+        bool first = true;
+        for (const Primitive &prim : this->primitives) {
+            Bounds3f b = prim.shape->WorldBound();
+            worldBound = first ? b : Union(worldBound, b);
+            first = false;
+        }
+        if (first) worldBound = Bounds3f(Point3f(0, 0, 0), Point3f(0, 0, 0));
+        for (const std::shared_ptr<Light> &light : this->lights) {
+            light->Preprocess(worldBound);
+            if (light->flags & (int) LightFlags::Infinite) infiniteLights.push_back(light);
+        }
+    }
+
+    bool Scene::Intersect(const Ray &ray, SurfaceInteraction *isect, const Material **material) const {
+        //only the closest hit gets a full interaction
+        Ray r = ray;
+        HitRecord closest;
+        for (std::size_t i = 0; i < primitives.size(); ++i) {
+            if (primitives[i].shape->IntersectHit(r, &closest)) {
+                closest.primitiveId = int(i);
+                r.tMax = closest.tHit;
+            }
+        }
+        if (closest.primitiveId < 0) return false;
+        const Primitive &prim = primitives[closest.primitiveId];
+        prim.shape->ComputeInteraction(r, closest, isect);
+        *material = prim.material.get();
+        ray.tMax = closest.tHit;
+        return true;
+    }
+
+    bool Scene::IntersectP(const Ray &ray) const {
+        for (const Primitive &prim : primitives) {
+            if (prim.shape->IntersectP(ray)) return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,158 @@
+//
+// Created by 18310 on 2021/5/10.
+//
+
+#include "sdtree.h"
+
+namespace sr {
+
+    void DTree::Record(const Point2f &pCanonical, Float value) {
+        Point2f p = pCanonical;
+        int index = 0;
+        while (true) {
+            Node &node = nodes[index];
+            int q = Node::Quadrant(p);
+            node.sum[q].Add(value);
+            if (node.child[q] == 0) return;
+            index = node.child[q];
+            p = Point2f(p.x * 2 - (q & 1), p.y * 2 - (q >> 1));
+        }
+    }
+
+    Float DTree::Pdf(Point2f p) const {
+        //a tree that has seen nothing samples uniformly
+        if (Total() <= 0) return 1;
+        Float pdf = 1;
+        int index = 0;
+        while (true) {
+            const Node &node = nodes[index];
+            Float total = node.Total();
+            if (total <= 0) return 0;
+            int q = Node::Quadrant(p);
+            pdf *= 4 * Float(node.sum[q]) / total;
+            if (node.child[q] == 0) return pdf;
+            index = node.child[q];
+            p = Point2f(p.x * 2 - (q & 1), p.y * 2 - (q >> 1));
+        }
+    }
+
+    Point2f DTree::Sample(Point2f u) const {
+        if (Total() <= 0) return u;
+        Point2f origin(0, 0);
+        Float size = 1;
+        int index = 0;
+        while (true) {
+            const Node &node = nodes[index];
+            Float s[4] = {node.sum[0], node.sum[1], node.sum[2], node.sum[3]};
+            //pick the row by its sum, then the column inside it, remapping u each time
+            Float pBottom = (s[0] + s[1]) / (s[0] + s[1] + s[2] + s[3]);
+            int q;
+            if (u.y < pBottom) {
+                u.y = u.y / pBottom;
+                q = 0;
+            } else {
+                u.y = (u.y - pBottom) / (1 - pBottom);
+                q = 2;
+            }
+            Float pLeft = s[q] / (s[q] + s[q + 1]);
+            if (u.x < pLeft) {
+                u.x = u.x / pLeft;
+            } else {
+                u.x = (u.x - pLeft) / (1 - pLeft);
+                q += 1;
+            }
+            u = Point2f(std::min(u.x, OneMinusEpsilon), std::min(u.y, OneMinusEpsilon));
+            size *= 0.5f;
+            origin = Point2f(origin.x + (q & 1) * size, origin.y + (q >> 1) * size);
+            if (node.child[q] == 0) return Point2f(origin.x + u.x * size, origin.y + u.y * size);
+            index = node.child[q];
+        }
+    }
+
+    void DTree::Refine(const DTree &previous, Float threshold, int maxDepth) {
+        nodes.assign(1, Node());
+        nSamples.store(0, std::memory_order_relaxed);
+        Float total = previous.Total();
+        if (total <= 0) return;
+
+        //(new node, node of previous or -1 past its leaves, energy fraction of each quadrant, depth)
+        struct Entry {
+            int index, previousIndex;
+            Float fraction[4];
+            int depth;
+        };
+        std::vector<Entry> stack;
+        Entry root{0, 0, {}, 1};
+        for (int q = 0; q < 4; ++q) root.fraction[q] = Float(previous.nodes[0].sum[q]) / total;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            Entry e = stack.back();
+            stack.pop_back();
+            for (int q = 0; q < 4; ++q) {
+                if (e.fraction[q] <= threshold || e.depth >= maxDepth) continue;
+                Entry child{int(nodes.size()), -1, {}, e.depth + 1};
+                int previousChild = e.previousIndex >= 0 ? previous.nodes[e.previousIndex].child[q] : 0;
+                if (previousChild != 0) {
+                    child.previousIndex = previousChild;
+                    for (int c = 0; c < 4; ++c) child.fraction[c] = Float(previous.nodes[previousChild].sum[c]) / total;
+                } else {
+                    for (int c = 0; c < 4; ++c) child.fraction[c] = e.fraction[q] / 4;
+                }
+                nodes.emplace_back();
+                nodes[e.index].child[q] = child.index;
+                stack.push_back(child);
+            }
+        }
+    }
+
+    STree::STree(const Bounds3f &b) : nodes(1) {
+        //cubic, so splits alternate over equal extents
+        Vector3f d = b.Diagonal();
+        Float size = std::max(MaxComponent(d), Float(1e-4));
+        bounds = Bounds3f(b.pMin, b.pMin + Vector3f(size, size, size));
+        nodes[0].dTree.reset(new DTreeWrapper());
+    }
+
+    DTreeWrapper *STree::Lookup(const Point3f &pWorld) const {
+        Vector3f o = bounds.Offset(pWorld);
+        Float p[3] = {Clamp(o.x, 0, OneMinusEpsilon), Clamp(o.y, 0, OneMinusEpsilon), Clamp(o.z, 0, OneMinusEpsilon)};
+        int index = 0;
+        while (!nodes[index].IsLeaf()) {
+            const Node &node = nodes[index];
+            int a = node.axis;
+            int c = p[a] < 0.5f ? 0 : 1;
+            p[a] = p[a] * 2 - c;
+            index = node.child[c];
+        }
+        return nodes[index].dTree.get();
+    }
+
+    void STree::Refine(int64_t splitThreshold, Float directionalThreshold) {
+        //new children are visited by the same loop and split again while they hold enough samples
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (!nodes[i].IsLeaf() || nodes[i].dTree->building.SampleCount() <= splitThreshold) continue;
+            std::unique_ptr<DTreeWrapper> parent = std::move(nodes[i].dTree);
+            parent->building.SetSampleCount(parent->building.SampleCount() / 2);
+            int axis = nodes[i].axis;
+            for (int c = 0; c < 2; ++c) {
+                Node child;
+                child.axis = (axis + 1) % 3;
+                child.dTree.reset(new DTreeWrapper(*parent));
+                nodes[i].child[c] = int(nodes.size());
+                nodes.push_back(std::move(child));
+            }
+        }
+        ParallelFor([&](int64_t i) {
+            Node &node = nodes[i];
+            if (!node.IsLeaf()) return;
+            node.dTree->sampling = node.dTree->building;
+            node.dTree->building.Refine(node.dTree->sampling, directionalThreshold);
+        }, int64_t(nodes.size()), 16);
+    }
+
+    std::size_t STree::LeafCount() const {
+        std::size_t n = 0;
+        for (const Node &node : nodes) n += node.IsLeaf();
+        return n;
+    }
+}
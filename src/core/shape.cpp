@@ -10,9 +10,29 @@ namespace sr{
         return (*ObjectToWorld)(ObjectBound());
     }
 
-    bool Shape::IntersectP(const Ray &ray, bool testAlphaTexture) {
-        Float tMax = ray.tMax;
-        SurfaceInteraction isect;
-        return Intersect(ray, &tMax, &isect, testAlphaTexture);
+    bool Shape::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect, bool testAlphaTexture) const {
+        HitRecord hit;
+        if (!IntersectHit(ray, &hit, testAlphaTexture)) return false;
+        *tHit = hit.tHit;
+        ComputeInteraction(ray, hit, isect);
+        return true;
+    }
+
+    void Shape::ComputeInteraction(const Ray &ray, const HitRecord &hit, SurfaceInteraction *isect) const {
+        SurfaceInteraction objectIsect;
+        ComputeObjectInteraction(ray, hit, &objectIsect);
+        *isect = (*ObjectToWorld)(objectIsect);
+        //a surface that separates no media is crossed without changing the ray's medium
+        isect->mediumInterface = mediumInterface.IsMediumTransition() ? mediumInterface : MediumInterface(ray.medium);
+    }
+
+    void Shape::ComputeShadingFrame(const SurfaceInteraction &objectIsect, Point3f *pWorld, ShadingFrame *frame) const {
+        *pWorld = (*ObjectToWorld)(objectIsect.p);
+        *frame = ShadingFrame((*ObjectToWorld)(objectIsect.shading.dpdu), (*ObjectToWorld)(objectIsect.shading.n));
+    }
+
+    bool Shape::IntersectP(const Ray &ray, bool testAlphaTexture) const {
+        HitRecord hit;
+        return IntersectHit(ray, &hit, testAlphaTexture);
     }
 }
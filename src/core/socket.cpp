@@ -0,0 +1,309 @@
+//
+// Created by 18310 on 2021/5/11.
+//
+
+#include "socket.h"
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLERENDERER_HAVE_SOCKETS
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace sr {
+
+    struct MessageHeader {
+        uint32_t type;
+        uint32_t pad;
+        uint64_t size;
+    };
+
+#ifdef SIMPLERENDERER_HAVE_SOCKETS
+
+    static bool UnixAddress(const std::string &path, sockaddr_un *addr) {
+        std::memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+            std::cerr << "Socket: invalid socket path \"" << path << "\"\n";
+            return false;
+        }
+        std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    int ListenUnix(const std::string &path) {
+        sockaddr_un addr;
+        if (!UnixAddress(path, &addr)) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            std::cerr << "Socket: socket() failed: " << std::strerror(errno) << "\n";
+            return -1;
+        }
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                std::cerr << "Socket: \"" << path << "\" exists and is not a socket\n";
+                close(fd);
+                return -1;
+            }
+            //a socket file nobody answers on is left over from a process that is gone
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool live = probe >= 0 && connect(probe, (const sockaddr *) &addr, sizeof(addr)) == 0;
+            if (probe >= 0) close(probe);
+            if (live) {
+                std::cerr << "Socket: another process is listening on \"" << path << "\"\n";
+                close(fd);
+                return -1;
+            }
+            unlink(path.c_str());
+        }
+        if (bind(fd, (const sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+            std::cerr << "Socket: cannot listen on \"" << path << "\": " << std::strerror(errno) << "\n";
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int ConnectUnix(const std::string &path) {
+        sockaddr_un addr;
+        if (!UnixAddress(path, &addr)) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            std::cerr << "Socket: socket() failed: " << std::strerror(errno) << "\n";
+            return -1;
+        }
+        if (connect(fd, (const sockaddr *) &addr, sizeof(addr)) != 0) {
+            std::cerr << "Socket: cannot connect to \"" << path << "\": " << std::strerror(errno) << "\n";
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    //socket bound or connected to the first address of host:port that works
+    static int OpenTCP(const std::string &host, int port, bool listening) {
+        addrinfo hints, *addrs = nullptr;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = listening ? AI_PASSIVE : 0;
+        std::string service = std::to_string(port);
+        int err = getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &addrs);
+        if (err != 0) {
+            std::cerr << "Socket: cannot resolve \"" << host << "\": " << gai_strerror(err) << "\n";
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo *a = addrs; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            bool ok;
+            if (listening) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                ok = bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, 64) == 0;
+            } else {
+                ok = connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+            }
+            if (!ok) {
+                close(fd);
+                fd = -1;
+                continue;
+            }
+            //tiles and requests are small messages, do not hold them back
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        freeaddrinfo(addrs);
+        if (fd < 0)
+            std::cerr << "Socket: cannot " << (listening ? "listen on " : "connect to ") << host << ":" << port
+                      << ": " << std::strerror(errno) << "\n";
+        return fd;
+    }
+
+    int ListenTCP(const std::string &host, int port) { return OpenTCP(host, port, true); }
+
+    int ConnectTCP(const std::string &host, int port) { return OpenTCP(host, port, false); }
+
+    int AcceptConnection(int listenFd) {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0 || errno != EINTR) return fd;
+        }
+    }
+
+    void CloseSocket(int fd) {
+        if (fd >= 0) close(fd);
+    }
+
+    void ShutdownSocket(int fd) {
+        if (fd >= 0) shutdown(fd, SHUT_RDWR);
+    }
+
+    void SetReceiveTimeout(int fd, int timeoutMs) {
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    void SetSendTimeout(int fd, int timeoutMs) {
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    int WaitReadable(const std::vector<int> &fds, int timeoutMs) {
+        std::vector<pollfd> pfds(fds.size());
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            pfds[i].fd = fds[i];
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        int n;
+        do {
+            n = poll(pfds.data(), nfds_t(pfds.size()), timeoutMs);
+        } while (n < 0 && errno == EINTR);
+        for (std::size_t i = 0; n > 0 && i < pfds.size(); ++i) {
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) return int(i);
+        }
+        return -1;
+    }
+
+    static bool WriteAll(int fd, const void *data, std::size_t size) {
+        const uint8_t *p = (const uint8_t *) data;
+        while (size > 0) {
+#ifdef MSG_NOSIGNAL
+            //a vanished peer is reported as an error instead of SIGPIPE
+            ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+#else
+            ssize_t n = send(fd, p, size, 0);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= std::size_t(n);
+        }
+        return true;
+    }
+
+    static bool ReadAll(int fd, void *data, std::size_t size) {
+        uint8_t *p = (uint8_t *) data;
+        while (size > 0) {
+            ssize_t n = recv(fd, p, size, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= std::size_t(n);
+        }
+        return true;
+    }
+
+#else
+
+    int ListenUnix(const std::string &path) {
+        std::cerr << "Socket: sockets are not supported on this platform\n";
+        return -1;
+    }
+
+    int ConnectUnix(const std::string &path) {
+        std::cerr << "Socket: sockets are not supported on this platform\n";
+        return -1;
+    }
+
+    int ListenTCP(const std::string &host, int port) {
+        std::cerr << "Socket: sockets are not supported on this platform\n";
+        return -1;
+    }
+
+    int ConnectTCP(const std::string &host, int port) {
+        std::cerr << "Socket: sockets are not supported on this platform\n";
+        return -1;
+    }
+
+    int AcceptConnection(int listenFd) { return -1; }
+
+    int WaitReadable(const std::vector<int> &fds, int timeoutMs) { return -1; }
+
+    void CloseSocket(int fd) {}
+
+    void ShutdownSocket(int fd) {}
+
+    void SetReceiveTimeout(int fd, int timeoutMs) {}
+
+    void SetSendTimeout(int fd, int timeoutMs) {}
+
+    static bool WriteAll(int fd, const void *data, std::size_t size) { return false; }
+
+    static bool ReadAll(int fd, void *data, std::size_t size) { return false; }
+
+#endif
+
+    //false for a malformed endpoint
+    static bool ParseEndpoint(const std::string &endpoint, std::string *path, std::string *host, int *port) {
+        if (endpoint.compare(0, 4, "tcp:") == 0) {
+            std::size_t colon = endpoint.rfind(':');
+            if (colon < 4) return false;
+            *host = endpoint.substr(4, colon - 4);
+            *port = std::atoi(endpoint.c_str() + colon + 1);
+            return *port > 0 && *port < 65536;
+        }
+        *path = endpoint.compare(0, 5, "unix:") == 0 ? endpoint.substr(5) : endpoint;
+        return !path->empty();
+    }
+
+    int ListenEndpoint(const std::string &endpoint) {
+        std::string path, host;
+        int port = 0;
+        if (!ParseEndpoint(endpoint, &path, &host, &port)) {
+            std::cerr << "Socket: invalid endpoint \"" << endpoint << "\"\n";
+            return -1;
+        }
+        return port > 0 ? ListenTCP(host, port) : ListenUnix(path);
+    }
+
+    int ConnectEndpoint(const std::string &endpoint) {
+        std::string path, host;
+        int port = 0;
+        if (!ParseEndpoint(endpoint, &path, &host, &port)) {
+            std::cerr << "Socket: invalid endpoint \"" << endpoint << "\"\n";
+            return -1;
+        }
+        return port > 0 ? ConnectTCP(host, port) : ConnectUnix(path);
+    }
+
+    void RemoveEndpoint(const std::string &endpoint) {
+        std::string path, host;
+        int port = 0;
+        if (ParseEndpoint(endpoint, &path, &host, &port) && port == 0) std::remove(path.c_str());
+    }
+
+    bool SendMessage(int fd, uint32_t type, const void *payload, std::size_t size) {
+        MessageHeader header{type, 0, uint64_t(size)};
+        return WriteAll(fd, &header, sizeof(header)) && (size == 0 || WriteAll(fd, payload, size));
+    }
+
+    bool ReceiveMessage(int fd, uint32_t *type, std::vector<uint8_t> *payload, std::size_t maxSize) {
+        MessageHeader header;
+        if (!ReadAll(fd, &header, sizeof(header))) return false;
+        //larger payloads are taken for a corrupt or hostile stream
+        if (header.size > maxSize) {
+            std::cerr << "Socket: message of " << header.size << " bytes rejected\n";
+            return false;
+        }
+        *type = header.type;
+        payload->resize(std::size_t(header.size));
+        return header.size == 0 || ReadAll(fd, payload->data(), payload->size());
+    }
+}
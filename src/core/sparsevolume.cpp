@@ -0,0 +1,291 @@
+//
+// Created by 18310 on 2021/5/8.
+//
+
+#include "sparsevolume.h"
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLERENDERER_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sr {
+
+    static constexpr uint32_t SparseVolumeVersion = 1;
+
+    //bricks start on a page boundary so every brick maps to at most two pages
+    static constexpr uint64_t SparseVolumeBrickAlignment = 4096;
+
+    struct SparseVolumeHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t resolution[3];
+        uint32_t pad;
+        uint64_t bricksOffset, nBricks;
+        uint64_t brickMaxOffset;
+        uint64_t topOffset;
+        uint64_t nodeTablesOffset, nNodeTables;
+    };
+
+    //count elements at offset lie inside a file of size bytes and are aligned for their type
+    static bool SectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+        return offset % elementSize == 0 && offset <= size && count <= (size - offset) / elementSize;
+    }
+
+    bool WriteSparseVolume(const std::string &name, const Point3i &resolution,
+                           const std::function<bool(const Point3i &brickOrigin, float *voxels)> &fillBrick) {
+        typedef SparseVolume SV;
+        if (resolution.x <= 0 || resolution.y <= 0 || resolution.z <= 0) {
+            std::cerr << "WriteSparseVolume: invalid resolution for \"" << name << "\"\n";
+            return false;
+        }
+        FILE *fp = std::fopen(name.c_str(), "wb");
+        if (!fp) {
+            std::cerr << "WriteSparseVolume: cannot open \"" << name << "\"\n";
+            return false;
+        }
+        Point3i bricks((resolution.x + SV::BrickRes - 1) >> SV::BrickLog2,
+                       (resolution.y + SV::BrickRes - 1) >> SV::BrickLog2,
+                       (resolution.z + SV::BrickRes - 1) >> SV::BrickLog2);
+        Point3i nodes((bricks.x + SV::NodeRes - 1) >> SV::NodeLog2, (bricks.y + SV::NodeRes - 1) >> SV::NodeLog2,
+                      (bricks.z + SV::NodeRes - 1) >> SV::NodeLog2);
+
+        SparseVolumeHeader header = {};
+        std::memcpy(header.magic, "SRVL", 4);
+        header.version = SparseVolumeVersion;
+        header.resolution[0] = uint32_t(resolution.x);
+        header.resolution[1] = uint32_t(resolution.y);
+        header.resolution[2] = uint32_t(resolution.z);
+        header.bricksOffset = SparseVolumeBrickAlignment;
+        bool ok = std::fseek(fp, long(header.bricksOffset), SEEK_SET) == 0;
+
+        //bricks of a node are written together so neighbouring lookups stay on nearby pages
+        std::vector<uint32_t> top(std::size_t(nodes.x) * nodes.y * nodes.z, 0), nodeTables;
+        std::vector<float> brickMax, voxels(SV::BrickVoxels);
+        std::vector<uint32_t> table(SV::NodeBricks);
+        for (Point3i n : Bounds3i(Point3i(0, 0, 0), nodes)) {
+            if (!ok) break;
+            bool any = false;
+            for (Point3i l : Bounds3i(Point3i(0, 0, 0), Point3i(SV::NodeRes, SV::NodeRes, SV::NodeRes))) {
+                Point3i b((n.x << SV::NodeLog2) + l.x, (n.y << SV::NodeLog2) + l.y, (n.z << SV::NodeLog2) + l.z);
+                uint32_t &entry = table[((l.z << SV::NodeLog2 | l.y) << SV::NodeLog2) | l.x];
+                entry = 0;
+                if (b.x >= bricks.x || b.y >= bricks.y || b.z >= bricks.z) continue;
+                std::fill(voxels.begin(), voxels.end(), 0.f);
+                Point3i origin(b.x << SV::BrickLog2, b.y << SV::BrickLog2, b.z << SV::BrickLog2);
+                if (!fillBrick(origin, voxels.data())) continue;
+                //zero the voxels past the resolution so lookups and maxima ignore them
+                float maxValue = 0;
+                bool nonZero = false;
+                for (Point3i v : Bounds3i(Point3i(0, 0, 0), Point3i(SV::BrickRes, SV::BrickRes, SV::BrickRes))) {
+                    float &value = voxels[((v.z << SV::BrickLog2 | v.y) << SV::BrickLog2) | v.x];
+                    if (origin.x + v.x >= resolution.x || origin.y + v.y >= resolution.y ||
+                        origin.z + v.z >= resolution.z)
+                        value = 0;
+                    nonZero |= value != 0;
+                    maxValue = std::max(maxValue, value);
+                }
+                if (!nonZero) continue;
+                ok = std::fwrite(voxels.data(), sizeof(float), voxels.size(), fp) == voxels.size();
+                if (!ok) break;
+                brickMax.push_back(maxValue);
+                entry = uint32_t(brickMax.size());
+                any = true;
+            }
+            if (any) {
+                nodeTables.insert(nodeTables.end(), table.begin(), table.end());
+                top[(n.z * nodes.y + n.y) * nodes.x + n.x] = uint32_t(nodeTables.size() / SV::NodeBricks);
+            }
+        }
+
+        header.nBricks = brickMax.size();
+        header.brickMaxOffset = header.bricksOffset + header.nBricks * SV::BrickVoxels * sizeof(float);
+        header.topOffset = header.brickMaxOffset + brickMax.size() * sizeof(float);
+        header.nodeTablesOffset = header.topOffset + top.size() * sizeof(uint32_t);
+        header.nNodeTables = nodeTables.size() / SV::NodeBricks;
+        ok = ok && std::fwrite(brickMax.data(), sizeof(float), brickMax.size(), fp) == brickMax.size();
+        ok = ok && std::fwrite(top.data(), sizeof(uint32_t), top.size(), fp) == top.size();
+        ok = ok && std::fwrite(nodeTables.data(), sizeof(uint32_t), nodeTables.size(), fp) == nodeTables.size();
+        ok = ok && std::fseek(fp, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, fp) == 1;
+        ok = std::fclose(fp) == 0 && ok;
+        if (!ok) std::cerr << "WriteSparseVolume: failed to write \"" << name << "\"\n";
+        return ok;
+    }
+
+    std::unique_ptr<SparseVolume> SparseVolume::Open(const std::string &name) {
+        std::unique_ptr<SparseVolume> volume(new SparseVolume());
+#ifdef SIMPLERENDERER_HAVE_MMAP
+        int fd = open(name.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            std::cerr << "SparseVolume: cannot open \"" << name << "\"\n";
+            return nullptr;
+        }
+        volume->size = std::size_t(st.st_size);
+        if (volume->size >= sizeof(SparseVolumeHeader)) {
+            void *p = mmap(nullptr, volume->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                volume->data = p;
+                volume->mapped = true;
+                //lookups jump between bricks, read ahead would page in bricks that are never touched
+                madvise(p, volume->size, MADV_RANDOM);
+            }
+        }
+        close(fd);
+#else
+        FILE *fp = std::fopen(name.c_str(), "rb");
+        if (!fp) {
+            std::cerr << "SparseVolume: cannot open \"" << name << "\"\n";
+            return nullptr;
+        }
+        std::fseek(fp, 0, SEEK_END);
+        volume->size = std::size_t(std::ftell(fp));
+        std::fseek(fp, 0, SEEK_SET);
+        volume->data = std::malloc(volume->size);
+        if (volume->data && std::fread(volume->data, 1, volume->size, fp) != volume->size) {
+            std::free(volume->data);
+            volume->data = nullptr;
+        }
+        std::fclose(fp);
+#endif
+        const SparseVolumeHeader *header = (const SparseVolumeHeader *) volume->data;
+        //resolutions stay far enough below INT_MAX that brick and node counts never overflow
+        const uint32_t maxResolution = uint32_t(1) << 30;
+        if (!header || std::memcmp(header->magic, "SRVL", 4) != 0 || header->version != SparseVolumeVersion ||
+            header->resolution[0] == 0 || header->resolution[1] == 0 || header->resolution[2] == 0 ||
+            header->resolution[0] > maxResolution || header->resolution[1] > maxResolution ||
+            header->resolution[2] > maxResolution) {
+            std::cerr << "SparseVolume: \"" << name << "\" is not a sparse volume\n";
+            return nullptr;
+        }
+        volume->resolution = Point3i(int(header->resolution[0]), int(header->resolution[1]),
+                                     int(header->resolution[2]));
+        Point3i bricks((volume->resolution.x + BrickRes - 1) >> BrickLog2,
+                       (volume->resolution.y + BrickRes - 1) >> BrickLog2,
+                       (volume->resolution.z + BrickRes - 1) >> BrickLog2);
+        volume->nodes = Point3i((bricks.x + NodeRes - 1) >> NodeLog2, (bricks.y + NodeRes - 1) >> NodeLog2,
+                                (bricks.z + NodeRes - 1) >> NodeLog2);
+        uint64_t nTop = uint64_t(volume->nodes.x) * volume->nodes.y * volume->nodes.z;
+        //indices are stored + 1 in uint32 and used as int
+        if (nTop > uint64_t(std::numeric_limits<int>::max()) ||
+            header->nBricks > uint64_t(std::numeric_limits<int>::max()) ||
+            header->nNodeTables > uint64_t(std::numeric_limits<int>::max()) / NodeBricks) {
+            std::cerr << "SparseVolume: \"" << name << "\" is too large\n";
+            return nullptr;
+        }
+        if (!SectionFits(header->bricksOffset, header->nBricks * BrickVoxels, sizeof(float), volume->size) ||
+            !SectionFits(header->brickMaxOffset, header->nBricks, sizeof(float), volume->size) ||
+            !SectionFits(header->topOffset, nTop, sizeof(uint32_t), volume->size) ||
+            !SectionFits(header->nodeTablesOffset, header->nNodeTables * NodeBricks, sizeof(uint32_t), volume->size)) {
+            std::cerr << "SparseVolume: \"" << name << "\" is truncated\n";
+            return nullptr;
+        }
+        const char *base = (const char *) volume->data;
+        volume->nBricks = int64_t(header->nBricks);
+        volume->bricks = (const float *) (base + header->bricksOffset);
+        volume->brickMax = (const float *) (base + header->brickMaxOffset);
+        volume->top = (const uint32_t *) (base + header->topOffset);
+        volume->nodeTables = (const uint32_t *) (base + header->nodeTablesOffset);
+        //lookups index without checks, so every stored index is checked once here; this pages in the tables
+        //but not the bricks
+        for (uint64_t i = 0; i < nTop; ++i) {
+            if (volume->top[i] > header->nNodeTables) {
+                std::cerr << "SparseVolume: \"" << name << "\" has a node index out of range\n";
+                return nullptr;
+            }
+        }
+        for (uint64_t i = 0; i < header->nNodeTables * NodeBricks; ++i) {
+            if (volume->nodeTables[i] > header->nBricks) {
+                std::cerr << "SparseVolume: \"" << name << "\" has a brick index out of range\n";
+                return nullptr;
+            }
+        }
+        return volume;
+    }
+
+    SparseVolume::~SparseVolume() {
+        if (!data) return;
+#ifdef SIMPLERENDERER_HAVE_MMAP
+        if (mapped) {
+            munmap(data, size);
+            return;
+        }
+#endif
+        std::free(data);
+    }
+
+    Float SparseVolume::Lookup(const Point3f &p) const {
+        Float x = p.x * resolution.x - 0.5f, y = p.y * resolution.y - 0.5f, z = p.z * resolution.z - 0.5f;
+        Point3i pi((int) std::floor(x), (int) std::floor(y), (int) std::floor(z));
+        Float dx = x - pi.x, dy = y - pi.y, dz = z - pi.z;
+        Float v[8];
+        const int last = BrickRes - 1;
+        const float *brick;
+        if ((pi.x & last) != last && (pi.y & last) != last && (pi.z & last) != last && (brick = Brick(pi))) {
+            //all eight voxels in one brick, addressed by fixed strides
+            const float *v0 = brick + BrickOffset(pi);
+            v[0] = v0[0];
+            v[1] = v0[1];
+            v[2] = v0[BrickRes];
+            v[3] = v0[BrickRes + 1];
+            v[4] = v0[BrickRes * BrickRes];
+            v[5] = v0[BrickRes * BrickRes + 1];
+            v[6] = v0[BrickRes * BrickRes + BrickRes];
+            v[7] = v0[BrickRes * BrickRes + BrickRes + 1];
+        } else {
+            for (int i = 0; i < 8; ++i) v[i] = Lookup(Point3i(pi.x + (i & 1), pi.y + ((i >> 1) & 1), pi.z + (i >> 2)));
+        }
+        auto lerp = [](Float t, Float a, Float b) { return (1 - t) * a + t * b; };
+        return lerp(dz, lerp(dy, lerp(dx, v[0], v[1]), lerp(dx, v[2], v[3])),
+                    lerp(dy, lerp(dx, v[4], v[5]), lerp(dx, v[6], v[7])));
+    }
+
+    Float SparseVolume::MaxValue(const Bounds3i &b) const {
+        Point3i lo(std::max(b.pMin.x, 0) >> BrickLog2, std::max(b.pMin.y, 0) >> BrickLog2,
+                   std::max(b.pMin.z, 0) >> BrickLog2);
+        Point3i hi((std::min(b.pMax.x, resolution.x) + BrickRes - 1) >> BrickLog2,
+                   (std::min(b.pMax.y, resolution.y) + BrickRes - 1) >> BrickLog2,
+                   (std::min(b.pMax.z, resolution.z) + BrickRes - 1) >> BrickLog2);
+        if (hi.x <= lo.x || hi.y <= lo.y || hi.z <= lo.z) return 0;
+        Float maxValue = 0;
+        for (Point3i brick : Bounds3i(lo, hi)) {
+            int index = BrickIndex(brick.x, brick.y, brick.z);
+            if (index >= 0) maxValue = std::max(maxValue, Float(brickMax[index]));
+        }
+        return maxValue;
+    }
+
+    std::size_t SparseVolume::ResidentBytes() const {
+#ifdef SIMPLERENDERER_HAVE_MMAP
+        if (mapped) {
+            std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+            std::vector<unsigned char> resident((size + page - 1) / page);
+            if (mincore(data, size, resident.data()) != 0) return 0;
+            std::size_t n = 0;
+            for (unsigned char r : resident) n += r & 1;
+            return n * page;
+        }
+#endif
+        return size;
+    }
+
+    void SparseVolume::PageFaults(int64_t *minor, int64_t *major) {
+#ifdef SIMPLERENDERER_HAVE_MMAP
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            *minor = int64_t(usage.ru_minflt);
+            *major = int64_t(usage.ru_majflt);
+            return;
+        }
+#endif
+        *minor = *major = 0;
+    }
+}
@@ -3,7 +3,13 @@
 //
 
 #include "spectrum.h"
+#include "parallel.h"
 #include <algorithm>
+#include <mutex>
+
+#if defined(__SSE__) && !defined(SIMPLERENDERER_FLOAT_AS_DOUBLE)
+#include <xmmintrin.h>
+#endif
 
 namespace sr {
 
@@ -11,6 +17,9 @@ namespace sr {
     SampledSpectrum SampledSpectrum::X;
     SampledSpectrum SampledSpectrum::Y;
     SampledSpectrum SampledSpectrum::Z;
+    SampledSpectrum SampledSpectrum::rgbR;
+    SampledSpectrum SampledSpectrum::rgbG;
+    SampledSpectrum SampledSpectrum::rgbB;
     SampledSpectrum SampledSpectrum::rgbRefl2SpectWhite;
     SampledSpectrum SampledSpectrum::rgbRefl2SpectCyan;
     SampledSpectrum SampledSpectrum::rgbRefl2SpectMagenta;
@@ -589,8 +598,8 @@ namespace sr {
     //sum and divide
     Float AverageSpectrumSamples(const Float *lambda, const Float *v, int n, Float lambdaStart, Float lambdaEnd) {
         //Deal with out-of-bounds range:
-        if (lambdaEnd <= lambda[0]) return lambda[0];
-        if (lambdaStart >= lambda[n - 1]) return lambda[n - 1];
+        if (lambdaEnd <= lambda[0]) return v[0];
+        if (lambdaStart >= lambda[n - 1]) return v[n - 1];
         if (n == 1) return v[0];
 
         Float sum = 0.0;
@@ -598,8 +607,9 @@ namespace sr {
         if (lambdaStart < lambda[0]) sum += v[0] * (lambda[0] - lambdaStart);
         if (lambdaEnd > lambda[n - 1]) sum += v[n - 1] * (lambdaEnd - lambda[n - 1]);
 
+        //first segment reaching past lambdaStart
         int i = 0;
-        while (lambdaStart > lambda[i]) i++;
+        while (i + 1 < n && lambdaStart >= lambda[i + 1]) i++;
 
         //interpolate to get the proper val for a w between l[i] and l[i+1]
         auto interp = [lambda, v](Float w, int i){
@@ -615,7 +625,12 @@ namespace sr {
     }
 
     void SampledSpectrum::Init() {
+        //spectra in use read the tables, so they are only ever written once
+        static std::once_flag initialized;
+        std::call_once(initialized, InitTables);
+    }
 
+    void SampledSpectrum::InitTables() {
         for (std::size_t i = 0; i < nSpectralSamples; ++i) {
             //compute XYZ matching functions for SampledSpectrum
             Float lambda0 = Lerp(Float(i) / Float(nSpectralSamples), sampledLambdaStart, sampledLambdaEnd);
@@ -655,6 +670,17 @@ namespace sr {
             rgbIllum2SpectBlue.c[i] = AverageSpectrumSamples(RGB2SpectLambda, RGBIllum2SpectBlue, nRGB2SpectSamples,
                                                              lambda0, lambda1);
         }
+
+        //XYZToRGB is linear, so it can be folded into the matching functions once
+        Float scale = Float(sampledLambdaEnd - sampledLambdaStart) / Float(nSpectralSamples) / CIE_Y_integral;
+        for (std::size_t i = 0; i < nSpectralSamples; ++i) {
+            Float xyz[3] = {X.c[i] * scale, Y.c[i] * scale, Z.c[i] * scale};
+            Float rgb[3];
+            XYZToRGB(xyz, rgb);
+            rgbR.c[i] = rgb[0];
+            rgbG.c[i] = rgb[1];
+            rgbB.c[i] = rgb[2];
+        }
     }
 
 
@@ -777,6 +803,84 @@ namespace sr {
         XYZToRGB(xyz, rgb);
     }
 
+    //dot products of one spectrum with three weight spectra, summed in 4 lanes reduced as (0 + 1) + (2 + 3).
+    //SSE is spelled out because at -O3 gcc vectorizes the plain loop across pixels instead, with strided
+    //loads that made the bulk conversion slower than the per pixel one (SimpleRenderer --bench resolve)
+    static inline void SpectrumDot3(const Float *c, const Float *w0, const Float *w1, const Float *w2, Float res[3]) {
+        static_assert(nSpectralSamples % 4 == 0, "SpectrumDot3 needs a multiple of 4 samples");
+        Float s0[4], s1[4], s2[4];
+#if defined(__SSE__) && !defined(SIMPLERENDERER_FLOAT_AS_DOUBLE)
+        __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps();
+        for (int i = 0; i < nSpectralSamples; i += 4) {
+            __m128 v = _mm_loadu_ps(c + i);
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(w0 + i), v));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(w1 + i), v));
+            a2 = _mm_add_ps(a2, _mm_mul_ps(_mm_loadu_ps(w2 + i), v));
+        }
+        _mm_storeu_ps(s0, a0);
+        _mm_storeu_ps(s1, a1);
+        _mm_storeu_ps(s2, a2);
+#else
+        for (int l = 0; l < 4; ++l) s0[l] = s1[l] = s2[l] = 0;
+        for (int i = 0; i < nSpectralSamples; i += 4) {
+            for (int l = 0; l < 4; ++l) {
+                s0[l] += w0[i + l] * c[i + l];
+                s1[l] += w1[i + l] * c[i + l];
+                s2[l] += w2[i + l] * c[i + l];
+            }
+        }
+#endif
+        res[0] = (s0[0] + s0[1]) + (s0[2] + s0[3]);
+        res[1] = (s1[0] + s1[1]) + (s1[2] + s1[3]);
+        res[2] = (s2[0] + s2[1]) + (s2[2] + s2[3]);
+    }
+
+    void SampledSpectrum::ToXYZ(const SampledSpectrum *s, int64_t n, Float *xyz) {
+        Init();
+        Float scale = Float(sampledLambdaEnd - sampledLambdaStart) / Float(nSpectralSamples) / CIE_Y_integral;
+        for (int64_t i = 0; i < n; ++i) {
+            Float *out = xyz + 3 * i;
+            SpectrumDot3(s[i].c, X.c, Y.c, Z.c, out);
+            out[0] *= scale;
+            out[1] *= scale;
+            out[2] *= scale;
+        }
+    }
+
+    void SampledSpectrum::ToRGB(const SampledSpectrum *s, int64_t n, Float *rgb) {
+        Init();
+        for (int64_t i = 0; i < n; ++i) {
+            SpectrumDot3(s[i].c, rgbR.c, rgbG.c, rgbB.c, rgb + 3 * i);
+        }
+    }
+
+    void SpectralImageToXYZ(const SampledSpectrum *pixels, int xRes, int yRes, Float *xyz) {
+        ParallelFor([&](int64_t y) {
+            SampledSpectrum::ToXYZ(pixels + y * xRes, xRes, xyz + 3 * y * xRes);
+        }, yRes);
+    }
+
+    void SpectralImageToRGB(const SampledSpectrum *pixels, int xRes, int yRes, Float *rgb) {
+        ParallelFor([&](int64_t y) {
+            SampledSpectrum::ToRGB(pixels + y * xRes, xRes, rgb + 3 * y * xRes);
+        }, yRes);
+    }
+
+    bool ParseSpectrumRepresentation(const std::string &name, SpectrumRepresentation *rep) {
+        if (name == "rgb") {
+            *rep = SpectrumRepresentation::RGB;
+        } else if (name == "sampled") {
+            *rep = SpectrumRepresentation::Sampled;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char *SpectrumRepresentationName(SpectrumRepresentation rep) {
+        return rep == SpectrumRepresentation::Sampled ? "sampled" : "rgb";
+    }
+
     SampledSpectrum::SampledSpectrum(const RGBSpectrum &r, SpectrumType type) {
         Float rgb[3];
         r.ToRGB(rgb);
@@ -849,8 +953,35 @@ namespace sr {
         if (l >= lambda[n - 1]) return v[n - 1];
 
         int offset = FindInterval(n, [&](int index){ return lambda[index] <= l; });
-        Float t = (lambda[offset] - l) / (lambda[offset + 1] - lambda[offset]);
+        Float t = (l - lambda[offset]) / (lambda[offset + 1] - lambda[offset]);
         return Lerp(t, v[offset], v[offset + 1]);
     }
 
+    void Blackbody(const Float *lambda, int n, Float T, Float *Le) {
+        if (T <= 0) {
+            for (int i = 0; i < n; ++i) Le[i] = 0.f;
+            return;
+        }
+        const Float c = 299792458;
+        const Float h = 6.62606957e-34;
+        const Float kb = 1.3806488e-23;
+        for (int i = 0; i < n; ++i) {
+            //compute in double, lambda^5 underflows in float
+            double l = lambda[i] * 1e-9;
+            double lambda5 = (l * l) * (l * l) * l;
+            Le[i] = (2 * h * c * c) / (lambda5 * (std::exp((h * c) / (l * kb * T)) - 1));
+        }
+    }
+
+    void BlackbodyNormalized(const Float *lambda, int n, Float T, Float *Le) {
+        Blackbody(lambda, n, T, Le);
+        //no emission to normalize, Blackbody left zeros
+        if (T <= 0) return;
+        //Wien's displacement law gives the peak wavelength
+        Float lambdaMax = 2.8977721e-3 / T * 1e9;
+        Float maxL;
+        Blackbody(&lambdaMax, 1, T, &maxL);
+        for (int i = 0; i < n; ++i) Le[i] /= maxL;
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+//
+// Created by 18310 on 2021/4/14.
+//
+
+#include "spectrumlibrary.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sr {
+
+    //entries are held by pointer so references stay valid when the maps rehash,
+    //colliding hashes share a key and are told apart by their samples
+    static std::mutex libraryMutex;
+    static std::unordered_multimap<uint64_t, std::unique_ptr<SpectrumLibrary::Entry>> entries;
+    static std::unordered_map<std::string, const SpectrumLibrary::Entry *> names;
+
+    uint64_t SpectrumLibrary::HashSamples(const Float *lambda, const Float *v, int n) {
+        //FNV-1a over the raw bytes
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void *data, std::size_t size) {
+            auto bytes = static_cast<const unsigned char *>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        mix(&n, sizeof(n));
+        mix(lambda, n * sizeof(Float));
+        mix(v, n * sizeof(Float));
+        return hash;
+    }
+
+    //caller holds libraryMutex
+    static const SpectrumLibrary::Entry &AddLocked(uint64_t hash, const Float *lambda, const Float *v, int n) {
+        auto range = entries.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            const SpectrumLibrary::Entry &e = *it->second;
+            if (int(e.lambda.size()) == n && std::equal(lambda, lambda + n, e.lambda.begin()) &&
+                std::equal(v, v + n, e.v.begin()))
+                return e;
+        }
+
+        std::unique_ptr<SpectrumLibrary::Entry> entry(new SpectrumLibrary::Entry);
+        entry->hash = hash;
+        entry->lambda.assign(lambda, lambda + n);
+        entry->v.assign(v, v + n);
+        entry->sampled = SampledSpectrum::FromSampled(lambda, v, n);
+        entry->rgb = RGBSpectrum::FromSampled(lambda, v, n);
+        const SpectrumLibrary::Entry &res = *entry;
+        entries.emplace(hash, std::move(entry));
+        return res;
+    }
+
+    const SpectrumLibrary::Entry &SpectrumLibrary::Add(const Float *lambda, const Float *v, int n) {
+        uint64_t hash = HashSamples(lambda, v, n);
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        return AddLocked(hash, lambda, v, n);
+    }
+
+    const SpectrumLibrary::Entry &
+    SpectrumLibrary::Add(const std::string &name, const Float *lambda, const Float *v, int n) {
+        uint64_t hash = HashSamples(lambda, v, n);
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        const Entry &entry = AddLocked(hash, lambda, v, n);
+        names[name] = &entry;
+        return entry;
+    }
+
+    const SpectrumLibrary::Entry *SpectrumLibrary::AddBlackbody(Float T) {
+        if (!(T > 0) || std::isinf(T)) {
+            std::cerr << "SpectrumLibrary: blackbody temperature " << T << " is not a positive temperature\n";
+            return nullptr;
+        }
+        //hexadecimal float keeps every bit of T, so distinct temperatures never share a name
+        char text[64];
+        std::snprintf(text, sizeof(text), "blackbody:%a", double(T));
+        std::string name = text;
+        if (const Entry *entry = Find(name)) return entry;
+
+        Float Le[nCIESamples];
+        BlackbodyNormalized(CIE_lambda, nCIESamples, T, Le);
+        return &Add(name, CIE_lambda, Le, nCIESamples);
+    }
+
+    const SpectrumLibrary::Entry *SpectrumLibrary::Find(const std::string &name) {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        auto it = names.find(name);
+        return it == names.end() ? nullptr : it->second;
+    }
+
+    const SpectrumLibrary::Entry *SpectrumLibrary::Find(uint64_t hash) {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        auto it = entries.find(hash);
+        return it == entries.end() ? nullptr : it->second.get();
+    }
+
+    std::size_t SpectrumLibrary::Size() {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        return entries.size();
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Created by 18310 on 2021/4/18.
+//
+
+#include "stats.h"
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace sr {
+
+    //function statics, counters may be constructed during static initialization of other files
+    static std::mutex &RegistryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<StatCounter *> &Counters() {
+        static std::vector<StatCounter *> counters;
+        return counters;
+    }
+
+    static std::vector<ValidationSite *> &Sites() {
+        static std::vector<ValidationSite *> sites;
+        return sites;
+    }
+
+    StatCounter::StatCounter(const char *title) : title(title), value(0) {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        Counters().push_back(this);
+    }
+
+    ValidationSite::ValidationSite(const char *expr, const char *file, int line) : expr(expr), file(file),
+                                                                                   line(line), failures(0) {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        Sites().push_back(this);
+    }
+
+    void PrintStats(std::ostream &out) {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        //templates instantiate one site per type, merge them by location
+        std::map<std::string, int64_t> counters, failures;
+        for (const StatCounter *c : Counters()) counters[c->Title()] += c->Value();
+        for (const ValidationSite *s : Sites()) {
+            int64_t n = s->failures.load(std::memory_order_relaxed);
+            if (n > 0) {
+                failures[std::string(s->file) + ":" + std::to_string(s->line) + ": " + s->expr] += n;
+            }
+        }
+
+        //counters that never fired are left out, nothing is printed when none did
+        bool any = false;
+        for (const auto &c : counters) {
+            if (c.second == 0) continue;
+            if (!any) out << "Statistics:\n";
+            any = true;
+            out << "    " << c.first << ": " << c.second << "\n";
+        }
+        if (!failures.empty()) {
+            int64_t total = 0;
+            for (const auto &f : failures) total += f.second;
+            out << "Validation failures: " << total << "\n";
+            for (const auto &f : failures) out << "    " << f.first << ": " << f.second << "\n";
+        }
+    }
+
+    void ClearStats() {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        for (StatCounter *c : Counters()) c->Reset();
+        for (ValidationSite *s : Sites()) s->failures.store(0, std::memory_order_relaxed);
+    }
+
+    int64_t StatCounterValue(const std::string &title) {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        int64_t sum = 0;
+        for (const StatCounter *c : Counters())
+            if (title == c->Title()) sum += c->Value();
+        return sum;
+    }
+
+    int64_t ValidationFailureCount() {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        int64_t sum = 0;
+        for (const ValidationSite *s : Sites()) sum += s->failures.load(std::memory_order_relaxed);
+        return sum;
+    }
+}
@@ -0,0 +1,380 @@
+//
+// Created by 18310 on 2021/4/29.
+//
+
+#include "texturecache.h"
+#include "interaction.h"
+#include "stats.h"
+#include "lowdiscrepancy.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef SIMPLERENDERER_HAVE_PREAD
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sr {
+
+    SR_STAT_COUNTER("Texture cache/Lookups", nTileLookups);
+    SR_STAT_COUNTER("Texture cache/Thread cache hits", nThreadCacheHits);
+    SR_STAT_COUNTER("Texture cache/Shared cache hits", nSharedCacheHits);
+    SR_STAT_COUNTER("Texture cache/Misses", nTileMisses);
+    SR_STAT_COUNTER("Texture cache/Evicted tiles", nTilesEvicted);
+    SR_STAT_COUNTER("Texture cache/Bytes read", nTileBytesRead);
+
+    static const uint32_t TiledImageVersion = 1;
+
+    /**************************************************tiled file*********************************************************/
+
+    static std::vector<float> DownsampleLevel(const std::vector<float> &src, const Point2i &res, Point2i *newRes) {
+        *newRes = Point2i(std::max(1, (res.x + 1) / 2), std::max(1, (res.y + 1) / 2));
+        std::vector<float> dst(3 * newRes->x * newRes->y);
+        for (int y = 0; y < newRes->y; ++y) {
+            for (int x = 0; x < newRes->x; ++x) {
+                //box filter over the 2x2 parents that exist
+                float sum[3] = {0, 0, 0};
+                int n = 0;
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        int sx = 2 * x + dx, sy = 2 * y + dy;
+                        if (sx >= res.x || sy >= res.y) continue;
+                        for (int c = 0; c < 3; ++c) sum[c] += src[3 * (sy * res.x + sx) + c];
+                        ++n;
+                    }
+                }
+                for (int c = 0; c < 3; ++c) dst[3 * (y * newRes->x + x) + c] = sum[c] / n;
+            }
+        }
+        return dst;
+    }
+
+    bool WriteTiledImage(const std::string &name, const Float *rgb, const Point2i &resolution, int tileSize) {
+        if (resolution.x <= 0 || resolution.y <= 0 || tileSize <= 0) {
+            std::cerr << "WriteTiledImage: invalid resolution or tile size for \"" << name << "\"\n";
+            return false;
+        }
+        FILE *fp = std::fopen(name.c_str(), "wb");
+        if (!fp) {
+            std::cerr << "WriteTiledImage: cannot open \"" << name << "\"\n";
+            return false;
+        }
+        int nLevels = 1 + Log2Int(uint64_t(std::max(resolution.x, resolution.y)));
+        uint32_t header[6] = {0, TiledImageVersion, uint32_t(resolution.x), uint32_t(resolution.y),
+                              uint32_t(tileSize), uint32_t(nLevels)};
+        std::memcpy(header, "SRTX", 4);
+        bool ok = std::fwrite(header, sizeof(uint32_t), 6, fp) == 6;
+
+        std::vector<float> level(rgb, rgb + 3 * resolution.x * resolution.y);
+        Point2i res = resolution;
+        std::vector<float> tile(3 * tileSize * tileSize);
+        for (int l = 0; l < nLevels && ok; ++l) {
+            int tilesX = (res.x + tileSize - 1) / tileSize, tilesY = (res.y + tileSize - 1) / tileSize;
+            for (int ty = 0; ty < tilesY && ok; ++ty) {
+                for (int tx = 0; tx < tilesX && ok; ++tx) {
+                    //padding repeats the edge texels so bilinear lookups near the border stay smooth
+                    for (int y = 0; y < tileSize; ++y) {
+                        int sy = std::min(ty * tileSize + y, res.y - 1);
+                        for (int x = 0; x < tileSize; ++x) {
+                            int sx = std::min(tx * tileSize + x, res.x - 1);
+                            for (int c = 0; c < 3; ++c) tile[3 * (y * tileSize + x) + c] = level[3 * (sy * res.x + sx) + c];
+                        }
+                    }
+                    ok = std::fwrite(tile.data(), sizeof(float), tile.size(), fp) == tile.size();
+                }
+            }
+            if (l + 1 < nLevels) {
+                Point2i newRes;
+                level = DownsampleLevel(level, res, &newRes);
+                res = newRes;
+            }
+        }
+        ok = std::fclose(fp) == 0 && ok;
+        if (!ok) std::cerr << "WriteTiledImage: failed to write \"" << name << "\"\n";
+        return ok;
+    }
+
+    std::unique_ptr<TiledImage> TiledImage::Open(const std::string &name) {
+        std::unique_ptr<TiledImage> image(new TiledImage());
+        image->name = name;
+#ifdef SIMPLERENDERER_HAVE_PREAD
+        image->fd = open(name.c_str(), O_RDONLY);
+        bool opened = image->fd >= 0;
+#else
+        image->fp = std::fopen(name.c_str(), "rb");
+        bool opened = image->fp != nullptr;
+#endif
+        if (!opened) {
+            std::cerr << "TiledImage: cannot open \"" << name << "\"\n";
+            return nullptr;
+        }
+        uint32_t header[6];
+        if (!image->ReadAt(0, header, sizeof(header)) || std::memcmp(header, "SRTX", 4) != 0 ||
+            header[1] != TiledImageVersion || header[2] == 0 || header[3] == 0 || header[4] == 0 || header[5] == 0) {
+            std::cerr << "TiledImage: \"" << name << "\" is not a tiled image\n";
+            return nullptr;
+        }
+        image->tileSize = int(header[4]);
+        Point2i res((int) header[2], (int) header[3]);
+        int64_t offset = 6 * sizeof(uint32_t);
+        for (uint32_t l = 0; l < header[5]; ++l) {
+            Level level;
+            level.resolution = res;
+            level.tiles = Point2i((res.x + image->tileSize - 1) / image->tileSize,
+                                  (res.y + image->tileSize - 1) / image->tileSize);
+            level.offset = offset;
+            offset += int64_t(level.tiles.x) * level.tiles.y * int64_t(image->TileBytes());
+            image->levels.push_back(level);
+            res = Point2i(std::max(1, (res.x + 1) / 2), std::max(1, (res.y + 1) / 2));
+        }
+        return image;
+    }
+
+    TiledImage::~TiledImage() {
+#ifdef SIMPLERENDERER_HAVE_PREAD
+        if (fd >= 0) close(fd);
+#else
+        if (fp) std::fclose(fp);
+#endif
+    }
+
+    bool TiledImage::ReadAt(int64_t offset, void *data, std::size_t bytes) const {
+#ifdef SIMPLERENDERER_HAVE_PREAD
+        //pread leaves the file position alone, so any number of threads read at once
+        char *dst = (char *) data;
+        while (bytes > 0) {
+            ssize_t n = pread(fd, dst, bytes, off_t(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            dst += n;
+            offset += n;
+            bytes -= std::size_t(n);
+        }
+        return true;
+#else
+        std::lock_guard<std::mutex> lock(ioMutex);
+#if defined(_WIN32)
+        if (_fseeki64(fp, offset, SEEK_SET) != 0) return false;
+#else
+        if (fseeko(fp, off_t(offset), SEEK_SET) != 0) return false;
+#endif
+        return std::fread(data, 1, bytes, fp) == bytes;
+#endif
+    }
+
+    bool TiledImage::ReadTile(int level, const Point2i &tile, TextureTile *out) const {
+        const Level &l = levels[level];
+        assert(tile.x >= 0 && tile.x < l.tiles.x && tile.y >= 0 && tile.y < l.tiles.y);
+        int64_t offset = l.offset + (int64_t(tile.y) * l.tiles.x + tile.x) * int64_t(TileBytes());
+        std::vector<float> rgb(3 * tileSize * tileSize);
+        if (!ReadAt(offset, rgb.data(), TileBytes())) {
+            std::cerr << "TiledImage: failed to read a tile of \"" << name << "\"\n";
+            return false;
+        }
+        nTileBytesRead.Add(int64_t(TileBytes()));
+        out->texels.resize(tileSize * tileSize);
+        for (std::size_t i = 0; i < out->texels.size(); ++i) {
+            //hdr texels saturate at the largest half instead of turning into infinity
+            Float texel[3];
+            for (int c = 0; c < 3; ++c) texel[c] = Clamp(rgb[3 * i + c], -65504.f, 65504.f);
+            out->texels[i].Encode(RGBSpectrum::FromRGB(texel));
+        }
+        return true;
+    }
+
+    /**************************************************tile cache*********************************************************/
+
+    //direct mapped, per thread
+    static constexpr int ThreadTileCacheSize = 16;
+
+    struct ThreadTileCacheEntry {
+        uint64_t cacheId = 0, key = 0;
+        std::shared_ptr<const TextureTile> tile;
+    };
+
+    static thread_local ThreadTileCacheEntry threadTileCache[ThreadTileCacheSize];
+
+    static std::atomic<uint64_t> nextCacheId(1);
+
+    TextureCache::TextureCache(std::size_t maxBytes, int nShards) : maxBytes(maxBytes), cacheId(nextCacheId++) {
+        nShards = std::max(nShards, 1);
+        shardBytes = maxBytes / nShards;
+        //about one 32x32 tile per bucket when the shard is full
+        uint64_t nBuckets = std::min(RoundUpPow2(std::max<uint64_t>(64, shardBytes / (3 * 32 * 32 * sizeof(float)))),
+                                     uint64_t(1) << 20);
+        for (int i = 0; i < nShards; ++i) {
+            std::unique_ptr<Shard> shard(new Shard());
+            shard->nBuckets = nBuckets;
+            shard->buckets.reset(new std::atomic<Node *>[nBuckets]);
+            for (uint64_t b = 0; b < nBuckets; ++b) shard->buckets[b].store(nullptr, std::memory_order_relaxed);
+            shards.push_back(std::move(shard));
+        }
+    }
+
+    TextureCache::~TextureCache() {}
+
+    TextureCache::Shard::~Shard() {
+        for (Node *node : clock) delete node;
+        for (Node *node : retired) delete node;
+        for (Node *node : waiting) delete node;
+    }
+
+    void TextureCache::Shard::Reclaim() {
+        if (!waiting.empty() && readers[waitingParity].load() == 0) {
+            for (Node *node : waiting) delete node;
+            waiting.clear();
+        }
+        //readers that entered before the flip hold the old parity, later readers cannot reach retired nodes
+        if (waiting.empty() && !retired.empty()) {
+            waiting.swap(retired);
+            waitingParity = int(epoch.fetch_add(1) & 1);
+        }
+    }
+
+    TextureCache::Shard &TextureCache::ShardOf(uint64_t key) const {
+        return *shards[MixBits(key) % shards.size()];
+    }
+
+    std::atomic<TextureCache::Node *> &TextureCache::BucketOf(const Shard &shard, uint64_t key) const {
+        return shard.buckets[(MixBits(key) / shards.size()) & (shard.nBuckets - 1)];
+    }
+
+    int TextureCache::AddTexture(const std::string &filename) {
+        std::unique_ptr<TiledImage> image = TiledImage::Open(filename);
+        if (!image) return -1;
+        if (images.size() >= (1 << 16) || image->Levels() > 255 || image->LevelTiles(0).x >= (1 << 20) ||
+            image->LevelTiles(0).y >= (1 << 20)) {
+            std::cerr << "TextureCache: too many textures or tiles for \"" << filename << "\"\n";
+            return -1;
+        }
+        images.push_back(std::move(image));
+        return int(images.size()) - 1;
+    }
+
+    std::shared_ptr<const TextureTile> TextureCache::GetTile(int texture, int level, const Point2i &tile) {
+        ++nTileLookups;
+        uint64_t key = TileKey(texture, level, tile);
+        ThreadTileCacheEntry &entry = threadTileCache[MixBits(key ^ cacheId) & (ThreadTileCacheSize - 1)];
+        if (entry.cacheId == cacheId && entry.key == key && entry.tile) {
+            ++nThreadCacheHits;
+            return entry.tile;
+        }
+        std::shared_ptr<const TextureTile> result;
+        Shard &shard = ShardOf(key);
+        int parity = shard.EnterRead();
+        for (Node *node = BucketOf(shard, key).load(std::memory_order_acquire); node;
+             node = node->next.load(std::memory_order_acquire)) {
+            if (node->key == key) {
+                result = node->tile;
+                //only write the flag when it changes so hits do not bounce the cache line between threads
+                if (!node->referenced.load(std::memory_order_relaxed))
+                    node->referenced.store(true, std::memory_order_relaxed);
+                ++nSharedCacheHits;
+                break;
+            }
+        }
+        shard.LeaveRead(parity);
+        if (!result) result = LoadTile(texture, level, tile, key);
+        if (result) {
+            entry.cacheId = cacheId;
+            entry.key = key;
+            entry.tile = result;
+        }
+        return result;
+    }
+
+    std::shared_ptr<const TextureTile> TextureCache::LoadTile(int texture, int level, const Point2i &tile,
+                                                              uint64_t key) {
+        ++nTileMisses;
+        //read without holding the shard lock, a racing thread may load the same tile, the first insert wins
+        std::shared_ptr<TextureTile> loaded = std::make_shared<TextureTile>();
+        if (!images[texture]->ReadTile(level, tile, loaded.get())) return nullptr;
+        std::size_t bytes = loaded->Bytes();
+
+        Shard &shard = ShardOf(key);
+        std::atomic<Node *> &bucket = BucketOf(shard, key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.Reclaim();
+        for (Node *node = bucket.load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed))
+            if (node->key == key) return node->tile;
+        //clock: referenced tiles get a second chance, the first unreferenced one is evicted
+        while (!shard.clock.empty() && shard.bytes + bytes > shardBytes) {
+            Node *victim = shard.clock.front();
+            shard.clock.pop_front();
+            if (victim->referenced.load(std::memory_order_relaxed)) {
+                victim->referenced.store(false, std::memory_order_relaxed);
+                shard.clock.push_back(victim);
+                continue;
+            }
+            //unlink, readers already on the victim still follow its next pointer
+            std::atomic<Node *> *link = &BucketOf(shard, victim->key);
+            while (link->load(std::memory_order_relaxed) != victim) link = &link->load(std::memory_order_relaxed)->next;
+            link->store(victim->next.load(std::memory_order_relaxed), std::memory_order_release);
+            shard.bytes -= victim->tile->Bytes();
+            shard.retired.push_back(victim);
+            ++nTilesEvicted;
+        }
+        //a tile larger than the shard budget is returned without being cached
+        if (shard.bytes + bytes > shardBytes) return loaded;
+        Node *node = new Node();
+        node->key = key;
+        node->tile = loaded;
+        node->referenced.store(false, std::memory_order_relaxed);
+        node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        bucket.store(node, std::memory_order_release);
+        shard.clock.push_back(node);
+        shard.bytes += bytes;
+        return loaded;
+    }
+
+    std::size_t TextureCache::ResidentBytes() const {
+        std::size_t bytes = 0;
+        for (const auto &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            bytes += shard->bytes;
+        }
+        return bytes;
+    }
+
+    /**************************************************filtering*********************************************************/
+
+    RGBSpectrum TextureCache::Texel(int texture, int level, const Point2i &st) {
+        const TiledImage &image = *images[texture];
+        Point2i res = image.LevelResolution(level);
+        int x = st.x % res.x, y = st.y % res.y;
+        if (x < 0) x += res.x;
+        if (y < 0) y += res.y;
+        int tileSize = image.TileSize();
+        std::shared_ptr<const TextureTile> tile = GetTile(texture, level, Point2i(x / tileSize, y / tileSize));
+        if (!tile) return RGBSpectrum(0.f);
+        return tile->texels[(y % tileSize) * tileSize + x % tileSize].Decode();
+    }
+
+    RGBSpectrum TextureCache::Bilerp(int texture, int level, const Point2f &st) {
+        Point2i res = images[texture]->LevelResolution(level);
+        Float x = st.x * res.x - 0.5f, y = st.y * res.y - 0.5f;
+        int x0 = int(std::floor(x)), y0 = int(std::floor(y));
+        Float dx = x - x0, dy = y - y0;
+        return (1 - dx) * (1 - dy) * Texel(texture, level, Point2i(x0, y0)) +
+               dx * (1 - dy) * Texel(texture, level, Point2i(x0 + 1, y0)) +
+               (1 - dx) * dy * Texel(texture, level, Point2i(x0, y0 + 1)) +
+               dx * dy * Texel(texture, level, Point2i(x0 + 1, y0 + 1));
+    }
+
+    RGBSpectrum TextureCache::Lookup(int texture, const Point2f &st, Float width) {
+        return LookupLevel(texture, st, Levels(texture) - 1 + std::log2(std::max(width, Float(1e-8))));
+    }
+
+    RGBSpectrum TextureCache::Lookup(int texture, const SurfaceInteraction &si) {
+        return LookupLevel(texture, si.uv, si.MIPLevel(Levels(texture)));
+    }
+
+    RGBSpectrum TextureCache::LookupLevel(int texture, const Point2f &st, Float level) {
+        int nLevels = Levels(texture);
+        if (level <= 0) return Bilerp(texture, 0, st);
+        if (level >= nLevels - 1) return Texel(texture, nLevels - 1, Point2i(0, 0));
+        int iLevel = int(std::floor(level));
+        Float delta = level - iLevel;
+        return (1 - delta) * Bilerp(texture, iLevel, st) + delta * Bilerp(texture, iLevel + 1, st);
+    }
+}
@@ -37,6 +37,7 @@ namespace sr{
         Matrix4x4 res;
         for (std::size_t i = 0; i < 4; ++i) {
             for (std::size_t j = 0; j < 4; ++j) {
+                res.m[i][j] = 0;
                 for (std::size_t k = 0; k < 4; ++k) {
                     res.m[i][j] += m1.m[i][k] * m2.m[k][j];
                 }
@@ -91,8 +92,8 @@ namespace sr{
                 if(ipiv[j] != 1){
                     for(int k = 0; k < 4; ++k){
                         if (ipiv[k] == 0){
-                            if(minv[j][k] >= biggest){
-                                biggest = minv[j][k];
+                            if(std::abs(minv[j][k]) >= biggest){
+                                biggest = std::abs(minv[j][k]);
                                 row = j;
                                 col = k;
                             }
@@ -217,14 +218,14 @@ namespace sr{
         Matrix4x4 m;
         m.m[0][0] = a.x * a.x + (1 - a.x * a.x) * cosTheta;
         m.m[0][1] = a.x * a.y * (1 - cosTheta) - a.z * sinTheta;
-        m.m[0][2] = a.x * a.z * (1 - cosTheta) + a.z * sinTheta;
+        m.m[0][2] = a.x * a.z * (1 - cosTheta) + a.y * sinTheta;
         m.m[0][3] = 0;
 
         m.m[1][0] = a.x * a.y * (1 - cosTheta) + a.z * sinTheta;
         m.m[1][1] = a.y * a.y + (1 - a.y * a.y) * cosTheta;
         m.m[1][2] = a.y * a.z * (1 - cosTheta) - a.x * sinTheta;
 
-        m.m[2][0] = a.x * a.z * (1 - cosTheta) + a.z * sinTheta;
+        m.m[2][0] = a.x * a.z * (1 - cosTheta) - a.y * sinTheta;
         m.m[2][1] = a.y * a.z * (1 - cosTheta) + a.x * sinTheta;
         m.m[2][2] = a.z * a.z + (1 - a.z * a.z) * cosTheta;
 
@@ -264,6 +265,21 @@ namespace sr{
 
     }
 
+    Transform Orthographic(Float zNear, Float zFar) {
+        return Scale(1, 1, 1 / (zFar - zNear)) * Translate(Vector3f(0, 0, -zNear));
+    }
+
+    Transform Perspective(Float fov, Float zNear, Float zFar) {
+        //project to z = 1 plane and remap z
+        Matrix4x4 persp(1, 0, 0, 0,
+                        0, 1, 0, 0,
+                        0, 0, zFar / (zFar - zNear), -zFar * zNear / (zFar - zNear),
+                        0, 0, 1, 0);
+        //scale the field of view to [-1, 1]
+        Float invTanAng = 1 / std::tan(Radians(fov) / 2);
+        return Scale(invTanAng, invTanAng, 1) * Transform(persp);
+    }
+
 
 
 
@@ -281,12 +297,33 @@ namespace sr{
         res.wo = Normalize(M(si.wo));
         res.time = si.time;
         res.mediumInterface = si.mediumInterface;
+        res.shape = si.shape;
+
+        //without shading geometry the shading frame is a copy of the geometric one, reuse the results
+        if (si.shading.n == si.n && si.shading.dpdu == si.dpdu && si.shading.dpdv == si.dpdv &&
+            si.shading.dndu == si.dndu && si.shading.dndv == si.dndv) {
+            res.shading.n = res.n;
+            res.shading.dpdu = res.dpdu;
+            res.shading.dpdv = res.dpdv;
+            res.shading.dndu = res.dndu;
+            res.shading.dndv = res.dndv;
+        } else {
+            res.shading.n = Normalize(M(si.shading.n));
+            res.shading.dpdu = M(si.shading.dpdu);
+            res.shading.dpdv = M(si.shading.dpdv);
+            res.shading.dndu = M(si.shading.dndu);
+            res.shading.dndv = M(si.shading.dndv);
+        }
 
-        res.shading.n = Normalize(M(si.shading.n));
-        res.shading.dpdu = M(si.shading.dpdu);
-        res.shading.dpdv = M(si.shading.dpdv);
-        res.shading.dndu = M(si.shading.dndu);
-        res.shading.dndv = M(si.shading.dndv);
+        //differentials are usually computed after the transform and still zero here
+        if (si.dpdx != Vector3f() || si.dpdy != Vector3f()) {
+            res.dpdx = M(si.dpdx);
+            res.dpdy = M(si.dpdy);
+        }
+        res.dudx = si.dudx;
+        res.dvdx = si.dvdx;
+        res.dudy = si.dudy;
+        res.dvdy = si.dvdy;
 
         return res;
     }
@@ -0,0 +1,11 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#include "box.h"
+
+namespace sr {
+    Float BoxFilter::Evaluate(const Point2f &/*p*/) const {
+        return 1.f;
+    }
+}
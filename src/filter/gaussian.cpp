@@ -0,0 +1,12 @@
+//
+// Created by 18310 on 2021/4/20.
+//
+
+#include "gaussian.h"
+
+namespace sr {
+    //separable, the 2D filter is the product of two 1D gaussians
+    Float GaussianFilter::Evaluate(const Point2f &p) const {
+        return Gaussian(p.x, expX) * Gaussian(p.y, expY);
+    }
+}
@@ -0,0 +1,233 @@
+//
+// Created by 18310 on 2021/5/10.
+//
+
+#include "guidedpath.h"
+#include "film.h"
+#include "interaction.h"
+#include "material.h"
+#include "parallel.h"
+#include "stats.h"
+
+namespace sr {
+
+    SR_STAT_COUNTER("Guiding/Guided directions", nGuidedDirections);
+    SR_STAT_COUNTER("Guiding/Material directions", nMaterialDirections);
+    SR_STAT_COUNTER("Guiding/Radiance records", nRadianceRecords);
+
+    //a diffuse vertex of the current path, radiance collects everything found after it
+    template<typename SpectrumT>
+    struct GuideVertex {
+        DTreeWrapper *dTree;
+        Point2f direction;
+        //path throughput after the vertex's own scattering
+        SpectrumT beta;
+        SpectrumT radiance;
+        Float woPdf;
+    };
+
+    static inline Float PowerHeuristic(Float fPdf, Float gPdf) {
+        Float f = fPdf * fPdf, g = gPdf * gPdf;
+        return f + g > 0 ? f / (f + g) : 0;
+    }
+
+    GuidedPathIntegrator::GuidedPathIntegrator(std::shared_ptr<const Camera> camera, std::unique_ptr<Sampler> sampler,
+                                               const GuidedPathOptions &options)
+            : camera(std::move(camera)), samplerPrototype(std::move(sampler)), options(options) {}
+
+    //light and infinite light values are rgb, SpectrumT's constructor turns them into illuminant spectra
+    template<typename SpectrumT>
+    SpectrumT GuidedPathIntegrator::Li(RayDifferentials ray, RayCone cone, const Scene &scene, Sampler &sampler,
+                                       MemoryArena &arena) const {
+        SpectrumT L(0.f), beta(1.f);
+        GuideVertex<SpectrumT> *vertices = arena.Alloc<GuideVertex<SpectrumT>>(options.maxDepth);
+        int nVertices = 0;
+        auto addRadiance = [&](const SpectrumT &c) {
+            L += c;
+            for (int i = 0; i < nVertices; ++i) vertices[i].radiance += c;
+        };
+
+        //density the last non specular bounce chose ray.d with, for MIS against lights hit by it
+        Float prevPdf = 0;
+        bool specularBounce = false;
+        Interaction prev;
+        for (int depth = 0; depth < options.maxDepth; ++depth) {
+            SurfaceInteraction isect;
+            const Material *material = nullptr;
+            if (!scene.Intersect(ray, &isect, &material)) {
+                for (const auto &light : scene.infiniteLights) {
+                    SpectrumT Le(light->Le(ray));
+                    if (Le.IsBlack()) continue;
+                    if (depth == 0 || specularBounce) {
+                        addRadiance(beta * Le);
+                    } else {
+                        Float lightPdf = lightSampler->PMF(prev, light.get()) * light->Pdf_Li(prev, ray.d);
+                        addRadiance(beta * Le * PowerHeuristic(prevPdf, lightPdf));
+                    }
+                }
+                break;
+            }
+            Float tHit = Distance(ray.o, isect.p);
+            if (ray.hasDifferentials) isect.ComputeDifferentials(ray);
+            else isect.ComputeDifferentials(cone, Normalize(ray.d), tHit);
+            cone = cone.Propagate(tHit);
+            if (!material) {
+                ray = RayDifferentials(isect.SpawnRay(ray.d));
+                --depth;
+                continue;
+            }
+
+            const Normal3f &n = isect.shading.n;
+            if (material->HasSpecular()) {
+                //guiding stays off at delta lobes, the path follows the material
+                Vector3f wi;
+                Float pdf;
+                Float uc = sampler.Get1D();
+                Point2f u = sampler.Get2D();
+                SpectrumT f = material->Sample_f<SpectrumT>(isect.wo, n, uc, u, &wi, &pdf, &specularBounce);
+                if (pdf == 0 || f.IsBlack()) break;
+                //no light sampling here, a light hit next counts in full
+                specularBounce = true;
+                beta *= f * (AbsDot(wi, n) / pdf);
+                ray = RayDifferentials(isect.SpawnRay(wi));
+                continue;
+            }
+
+            DTreeWrapper *dTree = options.guiding ? sdTree->Lookup(isect.p) : nullptr;
+            bool guided = dTree && dTree->sampling.Total() > 0;
+            Float alpha = guided ? options.bsdfSamplingFraction : 1;
+            auto scatteringPdf = [&](const Vector3f &wi) {
+                Float pdf = alpha * material->Pdf(isect.wo, wi, n);
+                if (guided) pdf += (1 - alpha) * dTree->sampling.Pdf(DirectionToCanonical(wi)) * Inv4Pi;
+                return pdf;
+            };
+
+            //light sampling
+            Float lightPmf;
+            Float ul = sampler.Get1D();
+            Point2f uLight = sampler.Get2D();
+            const Light *light = lightSampler->Sample(isect, ul, &lightPmf);
+            if (light) {
+                Vector3f wi;
+                Float lightPdf;
+                VisibilityTester vis;
+                SpectrumT Li(light->Sample_Li(isect, uLight, &wi, &lightPdf, &vis));
+                if (lightPdf > 0 && !Li.IsBlack()) {
+                    SpectrumT f = material->f<SpectrumT>(isect.wo, wi, n) * AbsDot(wi, n);
+                    if (!f.IsBlack() && vis.Unoccluded(scene)) {
+                        lightPdf *= lightPmf;
+                        Float weight = IsDeltaLight(light->flags) ? 1 : PowerHeuristic(lightPdf, scatteringPdf(wi));
+                        addRadiance(beta * f * Li * (weight / lightPdf));
+                    }
+                }
+            }
+
+            //one sample MIS between the material and the guide
+            Float uc = sampler.Get1D();
+            Point2f u = sampler.Get2D();
+            Vector3f wi;
+            if (uc < alpha) {
+                Float pdf;
+                bool specular;
+                material->Sample_f<SpectrumT>(isect.wo, n, uc / alpha, u, &wi, &pdf, &specular);
+                nMaterialDirections.Add(1);
+            } else {
+                wi = CanonicalToDirection(dTree->sampling.Sample(u));
+                nGuidedDirections.Add(1);
+            }
+            Float woPdf = scatteringPdf(wi);
+            SpectrumT f = material->f<SpectrumT>(isect.wo, wi, n) * AbsDot(wi, n);
+            if (woPdf == 0 || f.IsBlack()) break;
+            beta *= f / woPdf;
+            if (dTree)
+                vertices[nVertices++] = GuideVertex<SpectrumT>{dTree, DirectionToCanonical(wi), beta, SpectrumT(0.f),
+                                                               woPdf};
+            prevPdf = woPdf;
+            specularBounce = false;
+            prev = isect;
+
+            if (depth > 3) {
+                Float q = std::max(Float(0.05), 1 - beta.MaxComponentValue());
+                if (sampler.Get1D() < q) break;
+                beta /= 1 - q;
+            }
+            ray = RayDifferentials(isect.SpawnRay(wi));
+        }
+
+        //incident radiance along every sampled direction, over the density that chose it
+        for (int i = 0; i < nVertices; ++i) {
+            const GuideVertex<SpectrumT> &v = vertices[i];
+            Float incident[SpectrumT::nSamples];
+            for (int c = 0; c < SpectrumT::nSamples; ++c)
+                incident[c] = v.beta[c] > 0 ? v.radiance[c] / v.beta[c] : 0;
+            Float value = SpectrumT(SpectrumT::FromCoefficients(incident)).y() / v.woPdf;
+            if (value > 0 && std::isfinite(value)) {
+                v.dTree->building.Record(v.direction, value);
+                nRadianceRecords.Add(1);
+            }
+            v.dTree->building.AddSample();
+        }
+        return L;
+    }
+
+    void GuidedPathIntegrator::Preprocess(const Scene &scene) {
+        lightSampler = CreateLightSampler(options.lightSampling, scene.lights);
+        sdTree.reset(new STree(scene.WorldBound()));
+        iteration = 0;
+    }
+
+    //per sample work with paths traced in SpectrumT, picked at runtime by DispatchSpectrum
+    template<typename SpectrumT>
+    struct GuidedPathKernel {
+        static PixelSampleFunc Run(const GuidedPathIntegrator *integrator, const Scene &scene,
+                                   std::shared_ptr<std::vector<std::unique_ptr<Sampler>>> samplers) {
+            return [integrator, &scene, samplers](const Point2i &pPixel, int64_t sampleIndex, FilmTile *tile,
+                                                  MemoryArena &arena) {
+                Sampler &sampler = *(*samplers)[ThreadIndex];
+                sampler.StartPixelSample(pPixel, sampleIndex);
+                CameraSample cs = sampler.GetCameraSample(pPixel);
+                RayDifferentials ray;
+                Float rayWeight = integrator->camera->GenerateRayDifferential(cs, &ray);
+                //footprints of one sample out of samplesPerPixel
+                Float scale = 1 / std::sqrt(Float(std::max<int64_t>(sampler.samplesPerPixel, 1)));
+                ray.ScaleDifferentials(scale);
+                RayCone cone = integrator->camera->GeneratePixelCone();
+                cone = RayCone(cone.width * scale, cone.spreadAngle * scale);
+                SpectrumT L(0.f);
+                if (rayWeight > 0) L = integrator->Li<SpectrumT>(ray, cone, scene, sampler, arena) * rayWeight;
+                tile->AddSample(cs.pFilm, L);
+            };
+        }
+    };
+
+    PixelSampleFunc GuidedPathIntegrator::SampleFunc(const Scene &scene) const {
+        const int nThreads = MaxThreadIndex();
+        std::shared_ptr<std::vector<std::unique_ptr<Sampler>>> samplers(
+                new std::vector<std::unique_ptr<Sampler>>(nThreads));
+        for (int i = 0; i < nThreads; ++i) (*samplers)[i] = samplerPrototype->Clone();
+        return DispatchSpectrum<GuidedPathKernel>(options.spectrum, this, scene, samplers);
+    }
+
+    int GuidedPathIntegrator::Render(const Scene &scene, const ProgressiveOptions &progressive) {
+        Preprocess(scene);
+        PixelSampleFunc func = SampleFunc(scene);
+
+        //iteration k trains on 2^k samples per pixel, the trees are rebuilt once they are taken
+        ProgressiveOptions opts = progressive;
+        const ProgressiveRenderer *renderer = nullptr;
+        int64_t nextRefine = 1;
+        opts.onPass = [&](const std::vector<Float> &rgb, int pass) {
+            int64_t samplesTaken = renderer->SamplesPerPixel();
+            if (options.guiding && samplesTaken >= nextRefine) {
+                int64_t threshold = int64_t(options.spatialThreshold * std::sqrt(std::pow(2.0, iteration)));
+                sdTree->Refine(threshold, options.directionalThreshold);
+                ++iteration;
+                nextRefine = samplesTaken + (int64_t(1) << iteration);
+            }
+            if (progressive.onPass) progressive.onPass(rgb, pass);
+        };
+        ProgressiveRenderer progressiveRenderer(camera->film, func, opts);
+        renderer = &progressiveRenderer;
+        return progressiveRenderer.Render();
+    }
+}
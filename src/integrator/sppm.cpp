@@ -0,0 +1,311 @@
+//
+// Created by 18310 on 2021/5/9.
+//
+
+#include "sppm.h"
+#include "film.h"
+#include "interaction.h"
+#include "lightsampler.h"
+#include "memory.h"
+#include "parallel.h"
+#include "stats.h"
+#include <chrono>
+
+namespace sr {
+
+    SR_STAT_COUNTER("SPPM/Photon paths", nPhotonPaths);
+    SR_STAT_COUNTER("SPPM/Photon deposits", nPhotonDeposits);
+    SR_STAT_COUNTER("SPPM/Visible point grid entries", nGridEntries);
+
+    struct SPPMPixel {
+        Float radius = 0;
+        //direct lighting and emission summed over iterations
+        Spectrum Ld;
+
+        //valid when material is set
+        struct VisiblePoint {
+            Point3f p;
+            Vector3f wo;
+            Normal3f n;
+            const Material *material = nullptr;
+            Spectrum beta;
+        } vp;
+
+        //photon flux of the current iteration
+        AtomicFloat Phi[Spectrum::nSamples];
+        std::atomic<int> M{0};
+        Float N = 0;
+        Spectrum tau;
+    };
+
+    struct SPPMPixelListNode {
+        SPPMPixel *pixel;
+        SPPMPixelListNode *next;
+    };
+
+    static bool ToGrid(const Point3f &p, const Bounds3f &bounds, const int gridRes[3], Point3i *pi) {
+        bool inBounds = true;
+        Vector3f pg = bounds.Offset(p);
+        for (int i = 0; i < 3; ++i) {
+            int v = int(gridRes[i] * pg[i]);
+            inBounds &= v >= 0 && v < gridRes[i];
+            (*pi)[i] = Clamp(v, 0, gridRes[i] - 1);
+        }
+        return inBounds;
+    }
+
+    static inline uint32_t HashGridCell(const Point3i &p, uint32_t hashSize) {
+        return ((uint32_t(p.x) * 73856093u) ^ (uint32_t(p.y) * 19349663u) ^ (uint32_t(p.z) * 83492791u)) % hashSize;
+    }
+
+    //one light sample for a diffuse visible point
+    static Spectrum EstimateDirect(const Scene &scene, const LightSampler &lightSampler, const SurfaceInteraction &it,
+                                   const Material &material, Sampler &sampler) {
+        Float lightPmf;
+        Float ul = sampler.Get1D();
+        Point2f u = sampler.Get2D();
+        const Light *light = lightSampler.Sample(it, ul, &lightPmf);
+        if (!light) return Spectrum(0.f);
+        Vector3f wi;
+        Float pdf;
+        VisibilityTester vis;
+        Spectrum Li = light->Sample_Li(it, u, &wi, &pdf, &vis);
+        if (pdf == 0 || Li.IsBlack()) return Spectrum(0.f);
+        Spectrum f = material.f(it.wo, wi, it.shading.n) * AbsDot(wi, it.shading.n);
+        if (f.IsBlack() || !vis.Unoccluded(scene)) return Spectrum(0.f);
+        return f * Li / (pdf * lightPmf);
+    }
+
+    SPPMIntegrator::SPPMIntegrator(std::shared_ptr<const Camera> camera, std::unique_ptr<Sampler> sampler,
+                                   int nIterations, int photonsPerIteration, int maxDepth, Float initialSearchRadius)
+            : camera(std::move(camera)), samplerPrototype(std::move(sampler)), nIterations(nIterations),
+              photonsPerIteration(photonsPerIteration), maxDepth(maxDepth),
+              initialSearchRadius(initialSearchRadius) {}
+
+    void SPPMIntegrator::Render(const Scene &scene) {
+        Film *film = camera->film;
+        const Bounds2i pixelBounds = film->croppedPixelBounds;
+        const int width = pixelBounds.pMax.x - pixelBounds.pMin.x;
+        const int nPixels = std::max(0, pixelBounds.SurfaceArea());
+        if (nPixels == 0 || scene.lights.empty()) return;
+        std::unique_ptr<SPPMPixel[]> pixels(new SPPMPixel[nPixels]);
+        for (int i = 0; i < nPixels; ++i) pixels[i].radius = initialSearchRadius;
+
+        PowerLightSampler lightSampler(scene.lights);
+        const int nThreads = MaxThreadIndex();
+        std::vector<std::unique_ptr<Sampler>> samplers(nThreads);
+        for (int i = 0; i < nThreads; ++i) samplers[i] = samplerPrototype->Clone();
+        AlignedArray<MemoryArena> arenas(nThreads);
+
+        //photon paths share one sampler stream, kept apart from the pixels by a pixel outside the image
+        const Point2i photonPixel(-1, -1);
+        const uint32_t hashSize = uint32_t(nPixels);
+        std::unique_ptr<std::atomic<SPPMPixelListNode *>[]> grid(new std::atomic<SPPMPixelListNode *>[hashSize]);
+        photonPaths = 0;
+        photonSeconds = 0;
+        const Float footprintScale = 1 / std::sqrt(Float(std::max(nIterations, 1)));
+        RayCone pixelCone = camera->GeneratePixelCone();
+        pixelCone = RayCone(pixelCone.width * footprintScale, pixelCone.spreadAngle * footprintScale);
+
+        for (int iter = 0; iter < nIterations; ++iter) {
+            //camera pass
+            ParallelFor([&](int64_t index) {
+                Sampler &sampler = *samplers[ThreadIndex];
+                Point2i pPixel(pixelBounds.pMin.x + int(index % width), pixelBounds.pMin.y + int(index / width));
+                SPPMPixel &pixel = pixels[index];
+                pixel.vp.material = nullptr;
+                sampler.StartPixelSample(pPixel, iter);
+                CameraSample cs = sampler.GetCameraSample(pPixel);
+                RayDifferentials ray;
+                Spectrum beta(camera->GenerateRayDifferential(cs, &ray));
+                if (beta.IsBlack()) return;
+                //each iteration takes one sample per pixel
+                ray.ScaleDifferentials(footprintScale);
+                RayCone cone = pixelCone;
+
+                for (int depth = 0; depth < maxDepth; ++depth) {
+                    SurfaceInteraction isect;
+                    const Material *material = nullptr;
+                    if (!scene.Intersect(ray, &isect, &material)) {
+                        for (const auto &light : scene.infiniteLights) pixel.Ld += beta * light->Le(ray);
+                        break;
+                    }
+                    Float tHit = Distance(ray.o, isect.p);
+                    if (ray.hasDifferentials) isect.ComputeDifferentials(ray);
+                    else isect.ComputeDifferentials(cone, Normalize(ray.d), tHit);
+                    cone = cone.Propagate(tHit);
+                    if (!material) {
+                        ray = RayDifferentials(isect.SpawnRay(ray.d));
+                        --depth;
+                        continue;
+                    }
+                    if (material->HasDiffuse()) {
+                        pixel.Ld += beta * EstimateDirect(scene, lightSampler, isect, *material, sampler);
+                        pixel.vp.p = isect.p;
+                        pixel.vp.wo = isect.wo;
+                        pixel.vp.n = isect.shading.n;
+                        pixel.vp.material = material;
+                        pixel.vp.beta = beta;
+                        break;
+                    }
+                    //specular only, follow the bounce
+                    Vector3f wi;
+                    Float pdf;
+                    bool specular;
+                    Float uc = sampler.Get1D();
+                    Spectrum f = material->Sample_f(isect.wo, isect.shading.n, uc, sampler.Get2D(), &wi, &pdf,
+                                                    &specular);
+                    if (pdf == 0 || f.IsBlack()) break;
+                    beta *= f * (AbsDot(wi, isect.shading.n) / pdf);
+                    if (beta.y() < 0.25f) {
+                        Float continueProb = std::min(Float(1), beta.y());
+                        if (sampler.Get1D() > continueProb) break;
+                        beta /= continueProb;
+                    }
+                    ray = RayDifferentials(isect.SpawnRay(wi));
+                }
+            }, nPixels, 64);
+
+            //visible point grid
+            Bounds3f gridBounds;
+            bool empty = true;
+            Float maxRadius = 0;
+            for (int i = 0; i < nPixels; ++i) {
+                const SPPMPixel &pixel = pixels[i];
+                if (!pixel.vp.material) continue;
+                Vector3f r(pixel.radius, pixel.radius, pixel.radius);
+                Bounds3f b(pixel.vp.p + -r, pixel.vp.p + r);
+                gridBounds = empty ? b : Union(gridBounds, b);
+                empty = false;
+                maxRadius = std::max(maxRadius, pixel.radius);
+            }
+            for (uint32_t i = 0; i < hashSize; ++i) grid[i].store(nullptr, std::memory_order_relaxed);
+            for (int i = 0; i < nThreads; ++i) arenas[i].Reset();
+            int gridRes[3] = {1, 1, 1};
+            if (!empty) {
+                Vector3f diag = gridBounds.Diagonal();
+                Float maxDiag = MaxComponent(diag);
+                int baseGridRes = std::max(1, int(maxDiag / maxRadius));
+                for (int i = 0; i < 3; ++i) gridRes[i] = std::max(int(baseGridRes * diag[i] / maxDiag), 1);
+
+                ParallelFor([&](int64_t index) {
+                    SPPMPixel &pixel = pixels[index];
+                    if (!pixel.vp.material) return;
+                    MemoryArena &arena = arenas[ThreadIndex];
+                    Vector3f r(pixel.radius, pixel.radius, pixel.radius);
+                    Point3i pMin, pMax;
+                    ToGrid(pixel.vp.p + -r, gridBounds, gridRes, &pMin);
+                    ToGrid(pixel.vp.p + r, gridBounds, gridRes, &pMax);
+                    int64_t entries = 0;
+                    for (int z = pMin.z; z <= pMax.z; ++z)
+                        for (int y = pMin.y; y <= pMax.y; ++y)
+                            for (int x = pMin.x; x <= pMax.x; ++x) {
+                                std::atomic<SPPMPixelListNode *> &cell = grid[HashGridCell(Point3i(x, y, z), hashSize)];
+                                SPPMPixelListNode *node = ARENA_ALLOC(arena, SPPMPixelListNode);
+                                node->pixel = &pixel;
+                                node->next = cell.load(std::memory_order_relaxed);
+                                while (!cell.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                                                   std::memory_order_relaxed));
+                                ++entries;
+                            }
+                    nGridEntries.Add(entries);
+                }, nPixels, 256);
+            }
+
+            //photon pass
+            auto photonStart = std::chrono::steady_clock::now();
+            if (!empty) {
+                ParallelFor([&](int64_t photonIndex) {
+                    Sampler &sampler = *samplers[ThreadIndex];
+                    sampler.StartPixelSample(photonPixel, int64_t(iter) * photonsPerIteration + photonIndex);
+                    Float lightPmf;
+                    const Light *light = lightSampler.Sample(Interaction(), sampler.Get1D(), &lightPmf);
+                    if (!light) return;
+                    Point2f u1 = sampler.Get2D(), u2 = sampler.Get2D();
+                    Ray photonRay;
+                    Normal3f nLight;
+                    Float pdfPos, pdfDir;
+                    Spectrum Le = light->Sample_Le(u1, u2, 0, &photonRay, &nLight, &pdfPos, &pdfDir);
+                    if (pdfPos == 0 || pdfDir == 0 || Le.IsBlack()) return;
+                    Spectrum beta = Le * (AbsDot(nLight, photonRay.d) / (lightPmf * pdfPos * pdfDir));
+                    if (beta.IsBlack()) return;
+
+                    int64_t deposits = 0;
+                    for (int depth = 0; depth < maxDepth; ++depth) {
+                        SurfaceInteraction isect;
+                        const Material *material = nullptr;
+                        if (!scene.Intersect(photonRay, &isect, &material)) break;
+                        if (!material) {
+                            photonRay = isect.SpawnRay(photonRay.d);
+                            --depth;
+                            continue;
+                        }
+                        //direct lighting is already in Ld
+                        Point3i pi;
+                        if (depth > 0 && ToGrid(isect.p, gridBounds, gridRes, &pi)) {
+                            const SPPMPixelListNode *node =
+                                    grid[HashGridCell(pi, hashSize)].load(std::memory_order_acquire);
+                            for (; node; node = node->next) {
+                                SPPMPixel &pixel = *node->pixel;
+                                if (DistanceSquared(pixel.vp.p, isect.p) > pixel.radius * pixel.radius) continue;
+                                Spectrum Phi = beta * pixel.vp.material->f(pixel.vp.wo, -photonRay.d, pixel.vp.n);
+                                for (int i = 0; i < Spectrum::nSamples; ++i) pixel.Phi[i].Add(Phi[i]);
+                                pixel.M.fetch_add(1, std::memory_order_relaxed);
+                                ++deposits;
+                            }
+                        }
+
+                        Vector3f wi;
+                        Float pdf;
+                        bool specular;
+                        Float uc = sampler.Get1D();
+                        Spectrum f = material->Sample_f(isect.wo, isect.shading.n, uc, sampler.Get2D(), &wi, &pdf,
+                                                        &specular);
+                        if (pdf == 0 || f.IsBlack()) break;
+                        Spectrum bnew = beta * f * (AbsDot(wi, isect.shading.n) / pdf);
+                        //roulette on the change of throughput keeps photon powers close to each other
+                        Float q = std::max(Float(0), 1 - bnew.y() / beta.y());
+                        if (sampler.Get1D() < q) break;
+                        beta = bnew / (1 - q);
+                        photonRay = isect.SpawnRay(wi);
+                    }
+                    nPhotonDeposits.Add(deposits);
+                }, photonsPerIteration, 1024);
+                photonPaths += photonsPerIteration;
+                nPhotonPaths.Add(photonsPerIteration);
+            }
+            photonSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - photonStart).count();
+
+            //radius and flux update
+            ParallelFor([&](int64_t index) {
+                SPPMPixel &p = pixels[index];
+                int M = p.M.load(std::memory_order_relaxed);
+                if (M > 0) {
+                    const Float gamma = Float(2) / Float(3);
+                    Float Nnew = p.N + gamma * M;
+                    Float Rnew = p.radius * std::sqrt(Nnew / (p.N + M));
+                    Float phi[Spectrum::nSamples];
+                    for (int i = 0; i < Spectrum::nSamples; ++i) {
+                        phi[i] = p.Phi[i];
+                        p.Phi[i] = 0;
+                    }
+                    p.tau = (p.tau + p.vp.beta * Spectrum(Spectrum::FromCoefficients(phi))) * (Rnew * Rnew / (p.radius * p.radius));
+                    p.N = Nnew;
+                    p.radius = Rnew;
+                    p.M.store(0, std::memory_order_relaxed);
+                }
+                p.vp.beta = Spectrum(0.f);
+                p.vp.material = nullptr;
+            }, nPixels, 256);
+        }
+
+        std::vector<Spectrum> image(nPixels);
+        int64_t Np = int64_t(nIterations) * photonsPerIteration;
+        for (int i = 0; i < nPixels; ++i) {
+            const SPPMPixel &p = pixels[i];
+            image[i] = p.Ld / Float(nIterations);
+            if (Np > 0 && p.radius > 0) image[i] += p.tau / (Float(Np) * Pi * p.radius * p.radius);
+        }
+        film->SetImage(image.data());
+    }
+}
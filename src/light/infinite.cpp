@@ -0,0 +1,111 @@
+//
+// Created by 18310 on 2021/5/1.
+//
+
+#include "infinite.h"
+#include "imageio.h"
+
+namespace sr {
+
+    InfiniteAreaLight::InfiniteAreaLight(const Transform &LightToWorld, const Spectrum &L, int nSamples,
+                                         const std::string &texmap, bool importanceSample)
+            : Light((int) LightFlags::Infinite, LightToWorld, MediumInterface(), nSamples) {
+        std::unique_ptr<Float[]> rgb;
+        if (!texmap.empty()) rgb = ReadImage(texmap, &resolution);
+        if (rgb) {
+            Lmap.resize(resolution.x * resolution.y);
+            for (int i = 0; i < resolution.x * resolution.y; ++i) {
+                Lmap[i] = Spectrum::FromRGB(&rgb[3 * i], SpectrumType::Illuminant) * L;
+            }
+        } else {
+            resolution = Point2i(1, 1);
+            Lmap.assign(1, L);
+        }
+
+        //sin(theta) undoes the stretching of the rows near the poles
+        std::vector<Float> img(resolution.x * resolution.y);
+        for (int v = 0; v < resolution.y; ++v) {
+            Float sinTheta = std::sin(Pi * (v + .5f) / resolution.y);
+            for (int u = 0; u < resolution.x; ++u) {
+                Float weight = importanceSample ? std::max<Float>(Lmap[v * resolution.x + u].y(), 0) : 1;
+                img[v * resolution.x + u] = weight * sinTheta;
+            }
+        }
+        distribution.reset(new Distribution2D(img.data(), resolution.x, resolution.y));
+    }
+
+    Spectrum InfiniteAreaLight::Lookup(const Point2f &st) const {
+        int x = Clamp(int(st.x * resolution.x), 0, resolution.x - 1);
+        int y = Clamp(int(st.y * resolution.y), 0, resolution.y - 1);
+        return Lmap[y * resolution.x + x];
+    }
+
+    void InfiniteAreaLight::Preprocess(const Bounds3f &sceneBounds) {
+        sceneBounds.BoundingSphere(&worldCenter, &worldRadius);
+    }
+
+    Spectrum InfiniteAreaLight::Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                          VisibilityTester *vis) const {
+        Float mapPdf;
+        Point2f uv = distribution->SampleContinuous(u, &mapPdf);
+        if (mapPdf == 0) {
+            *pdf = 0;
+            return Spectrum(0.f);
+        }
+        Float theta = uv.y * Pi, phi = uv.x * 2 * Pi;
+        Float cosTheta = std::cos(theta), sinTheta = std::sin(theta);
+        *wi = LightToWorld(SphericalDirection(sinTheta, cosTheta, phi));
+        //the map pdf is over [0, 1]², dudv = dphi dtheta / 2pi², dw = sin(theta) dtheta dphi
+        *pdf = sinTheta == 0 ? 0 : mapPdf / (2 * Pi * Pi * sinTheta);
+        *vis = VisibilityTester(ref, Interaction(ref.p + *wi * (2 * worldRadius), ref.time, mediumInterface));
+        return Lookup(uv);
+    }
+
+    Float InfiniteAreaLight::Pdf_Li(const Interaction &/*ref*/, const Vector3f &w) const {
+        Vector3f wi = WorldToLight(w);
+        Float theta = SphericalTheta(wi), phi = SphericalPhi(wi);
+        Float sinTheta = std::sin(theta);
+        if (sinTheta == 0) return 0;
+        return distribution->Pdf(Point2f(phi * Inv2Pi, theta * InvPi)) / (2 * Pi * Pi * sinTheta);
+    }
+
+    Spectrum InfiniteAreaLight::Sample_Le(const Point2f &u1, const Point2f &u2, Float time, Ray *ray,
+                                          Normal3f *nLight, Float *pdfPos, Float *pdfDir) const {
+        //direction from the map, origin on the scene's bounding disk perpendicular to it
+        Float mapPdf;
+        Point2f uv = distribution->SampleContinuous(u1, &mapPdf);
+        if (mapPdf == 0) {
+            *pdfPos = *pdfDir = 0;
+            return Spectrum(0.f);
+        }
+        Float theta = uv.y * Pi, phi = uv.x * 2 * Pi;
+        Float cosTheta = std::cos(theta), sinTheta = std::sin(theta);
+        Vector3f d = -LightToWorld(SphericalDirection(sinTheta, cosTheta, phi));
+        *nLight = Normal3f(d);
+        Vector3f v1, v2;
+        CoordinateSystem(-d, &v1, &v2);
+        Point2f cd = ConcentricSampleDisk(u2);
+        Point3f pDisk = worldCenter + worldRadius * (cd.x * v1 + cd.y * v2);
+        *ray = Ray(pDisk + -d * worldRadius, d, Infinity, time);
+        *pdfDir = sinTheta == 0 ? 0 : mapPdf / (2 * Pi * Pi * sinTheta);
+        *pdfPos = 1 / (Pi * worldRadius * worldRadius);
+        return Lookup(uv);
+    }
+
+    Spectrum InfiniteAreaLight::Power() const {
+        //mean radiance over the sphere, through a disk the size of the scene
+        Spectrum sum(0.f);
+        Float weightSum = 0;
+        for (int v = 0; v < resolution.y; ++v) {
+            Float sinTheta = std::sin(Pi * (v + .5f) / resolution.y);
+            for (int u = 0; u < resolution.x; ++u) sum += Lmap[v * resolution.x + u] * sinTheta;
+            weightSum += sinTheta * resolution.x;
+        }
+        return sum * (Pi * worldRadius * worldRadius / weightSum);
+    }
+
+    Spectrum InfiniteAreaLight::Le(const RayDifferentials &ray) const {
+        Vector3f w = Normalize(WorldToLight(ray.d));
+        return Lookup(Point2f(SphericalPhi(w) * Inv2Pi, SphericalTheta(w) * InvPi));
+    }
+}
@@ -0,0 +1,44 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#include "point.h"
+#include "sampling.h"
+
+namespace sr {
+
+    PointLight::PointLight(const Transform &LightToWorld, const MediumInterface &mediumInterface, const Spectrum &I)
+            : Light((int) LightFlags::DeltaPosition, LightToWorld, mediumInterface),
+              pLight(LightToWorld(Point3f(0, 0, 0))), I(I) {}
+
+    Spectrum PointLight::Sample_Li(const Interaction &ref, const Point2f &/*u*/, Vector3f *wi, Float *pdf,
+                                   VisibilityTester *vis) const {
+        *wi = Normalize(pLight - ref.p);
+        *pdf = 1;
+        *vis = VisibilityTester(ref, Interaction(pLight, ref.time, mediumInterface));
+        return I * (1 / DistanceSquared(pLight, ref.p));
+    }
+
+    Float PointLight::Pdf_Li(const Interaction &/*ref*/, const Vector3f &/*wi*/) const {
+        return 0;
+    }
+
+    Spectrum PointLight::Sample_Le(const Point2f &u1, const Point2f &/*u2*/, Float time, Ray *ray, Normal3f *nLight,
+                                   Float *pdfPos, Float *pdfDir) const {
+        *ray = Ray(pLight, UniformSampleSphere(u1), Infinity, time, mediumInterface.inside);
+        *nLight = Normal3f(ray->d);
+        *pdfPos = 1;
+        *pdfDir = UniformSpherePdf();
+        return I;
+    }
+
+    Spectrum PointLight::Power() const {
+        return I * (4 * Pi);
+    }
+
+    bool PointLight::Bounds(LightBounds *bounds) const {
+        *bounds = LightBounds(Bounds3f(pLight, pLight), Vector3f(0, 0, 1), 4 * Pi * I.MaxComponentValue(),
+                              -1, std::cos(Pi / 2), false);
+        return true;
+    }
+}
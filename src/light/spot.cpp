@@ -0,0 +1,59 @@
+//
+// Created by 18310 on 2021/4/30.
+//
+
+#include "spot.h"
+#include "sampling.h"
+
+namespace sr {
+
+    SpotLight::SpotLight(const Transform &LightToWorld, const MediumInterface &mediumInterface, const Spectrum &I,
+                         Float totalWidth, Float falloffStart)
+            : Light((int) LightFlags::DeltaPosition, LightToWorld, mediumInterface),
+              pLight(LightToWorld(Point3f(0, 0, 0))), I(I), cosTotalWidth(std::cos(Radians(totalWidth))),
+              cosFalloffStart(std::cos(Radians(falloffStart))) {}
+
+    Spectrum SpotLight::Sample_Li(const Interaction &ref, const Point2f &/*u*/, Vector3f *wi, Float *pdf,
+                                  VisibilityTester *vis) const {
+        *wi = Normalize(pLight - ref.p);
+        *pdf = 1;
+        *vis = VisibilityTester(ref, Interaction(pLight, ref.time, mediumInterface));
+        return I * (Falloff(-*wi) / DistanceSquared(pLight, ref.p));
+    }
+
+    Float SpotLight::Falloff(const Vector3f &w) const {
+        Vector3f wl = Normalize(WorldToLight(w));
+        Float cosTheta = wl.z;
+        if (cosTheta < cosTotalWidth) return 0;
+        if (cosTheta >= cosFalloffStart) return 1;
+        Float delta = (cosTheta - cosTotalWidth) / (cosFalloffStart - cosTotalWidth);
+        return (delta * delta) * (delta * delta);
+    }
+
+    Float SpotLight::Pdf_Li(const Interaction &/*ref*/, const Vector3f &/*wi*/) const {
+        return 0;
+    }
+
+    Spectrum SpotLight::Sample_Le(const Point2f &u1, const Point2f &/*u2*/, Float time, Ray *ray, Normal3f *nLight,
+                                  Float *pdfPos, Float *pdfDir) const {
+        Vector3f w = UniformSampleCone(u1, cosTotalWidth);
+        *ray = Ray(pLight, LightToWorld(w), Infinity, time, mediumInterface.inside);
+        *nLight = Normal3f(ray->d);
+        *pdfPos = 1;
+        *pdfDir = UniformConePdf(cosTotalWidth);
+        return I * Falloff(ray->d);
+    }
+
+    Spectrum SpotLight::Power() const {
+        return I * (2 * Pi * (1 - .5f * (cosFalloffStart + cosTotalWidth)));
+    }
+
+    bool SpotLight::Bounds(LightBounds *bounds) const {
+        //emission is full inside the falloff cone and reaches zero at the total width
+        Vector3f w = Normalize(LightToWorld(Vector3f(0, 0, 1)));
+        Float cosTheta_e = std::cos(SafeACos(cosTotalWidth) - SafeACos(cosFalloffStart));
+        *bounds = LightBounds(Bounds3f(pLight, pLight), w, 4 * Pi * I.MaxComponentValue(), cosFalloffStart,
+                              cosTheta_e, false);
+        return true;
+    }
+}
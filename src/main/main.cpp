@@ -1,14 +1,905 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include "distributed.h"
+#include "gaussian.h"
+#include "grid.h"
+#include "imageio.h"
+#include "infinite.h"
+#include "halton.h"
 #include "geometry.h"
+#include "lowdiscrepancy.h"
 #include "transform.h"
+#include "material.h"
+#include "parallel.h"
+#include "perspective.h"
+#include "progressive.h"
+#include "pmj02.h"
+#include "point.h"
+#include "renderserver.h"
+#include "sobol.h"
+#include "sphere.h"
+#include "sppm.h"
+#include "stats.h"
 
 
 using namespace sr;
 
 
-int main() {
+//built in scene until scenes are read from files: a ground sphere, two spheres and lights,
+//a single point light by default
+static std::shared_ptr<const Scene> DemoScene(std::vector<std::shared_ptr<Light>> lights = {}) {
+    static const Transform groundToWorld = Translate(Vector3f(0, -1000, 0)), worldToGround = Inverse(groundToWorld);
+    static const Transform bigToWorld = Translate(Vector3f(0, 1, 0)), worldToBig = Inverse(bigToWorld);
+    static const Transform smallToWorld = Translate(Vector3f(-2.2f, 0.8f, 1)), worldToSmall = Inverse(smallToWorld);
+    std::vector<Primitive> primitives;
+    primitives.push_back({std::make_shared<Sphere>(&groundToWorld, &worldToGround, false, 1000, -1000, 1000, 360),
+                          std::make_shared<Material>(Spectrum(0.6f))});
+    primitives.push_back({std::make_shared<Sphere>(&bigToWorld, &worldToBig, false, 1, -1, 1, 360),
+                          std::make_shared<Material>(Spectrum(0.8f))});
+    primitives.push_back({std::make_shared<Sphere>(&smallToWorld, &worldToSmall, false, 0.8f, -0.8f, 0.8f, 360),
+                          std::make_shared<Material>(Spectrum(0.7f))});
+    if (lights.empty())
+        lights.push_back(std::make_shared<PointLight>(Translate(Vector3f(0.5f, 5, 0.3f)), MediumInterface(),
+                                                      Spectrum(30.f)));
+    return std::make_shared<Scene>(std::move(primitives), std::move(lights));
+}
+
+//perspective camera of job rendering into film
+static std::shared_ptr<const Camera> JobCamera(const RenderJob &job, Film *film) {
+    return std::make_shared<PerspectiveCamera>(Inverse(LookAt(job.eye, job.target, job.up)),
+                                               DefaultScreenWindow(job.resolution), 0, 1, 0, 1, job.fov, film);
+}
+
+//path traces job over scene under progressive with Sobol samples, returns the rgb of the finished film
+static std::vector<Float> PathTrace(const Scene &scene, const RenderJob &job, const GuidedPathOptions &options,
+                                    const ProgressiveOptions &progressive) {
+    std::unique_ptr<Film> film = CreateJobFilm(job, "");
+    GuidedPathIntegrator integrator(JobCamera(job, film.get()),
+                                    std::unique_ptr<Sampler>(new SobolSampler(job.samplesPerPixel, job.seed)),
+                                    options);
+    integrator.Render(scene, progressive);
+    std::vector<Float> rgb(3 * job.resolution.x * job.resolution.y);
+    film->GetRGB(rgb.data());
+    return rgb;
+}
+
+//root mean square difference to reference over the mean of reference
+static double RelativeRMSE(const std::vector<Float> &rgb, const std::vector<Float> &reference) {
+    double sum = 0, mean = 0;
+    for (std::size_t i = 0; i < rgb.size(); ++i) {
+        sum += (rgb[i] - reference[i]) * (rgb[i] - reference[i]);
+        mean += reference[i];
+    }
+    return mean > 0 ? std::sqrt(sum / rgb.size()) / (mean / rgb.size()) : 0;
+}
+
+//1, 2, 4, ... up to maxThreads, which is always included
+static std::vector<int> ThreadCounts(int maxThreads) {
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+static int HardwareThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//photon pass throughput of SPPM on the demo scene at 1, 2, 4, ... threads up to every hardware thread
+static int BenchSPPM() {
+    std::shared_ptr<const Scene> scene = DemoScene();
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(160, 120);
+    const int nIterations = 4, photonsPerIteration = 100000;
+    std::cout << "SPPM photon passes, " << nIterations << " x " << photonsPerIteration << " photons, "
+              << job.resolution.x << "x" << job.resolution.y << " visible points\n";
+    double base = 0;
+    for (int nThreads : ThreadCounts(HardwareThreads())) {
+        SetThreadCount(nThreads);
+        std::unique_ptr<Film> film = CreateJobFilm(job, "");
+        auto camera = std::make_shared<PerspectiveCamera>(Inverse(LookAt(job.eye, job.target, job.up)),
+                                                          DefaultScreenWindow(job.resolution), 0, 1, 0, 1, job.fov,
+                                                          film.get());
+        SPPMIntegrator integrator(camera, std::unique_ptr<Sampler>(new SobolSampler(nIterations)), nIterations,
+                                  photonsPerIteration, 5, 0.1f);
+        integrator.Render(*scene);
+        double rate = integrator.PhotonPaths() / integrator.PhotonSeconds();
+        if (nThreads == 1) base = rate;
+        std::cout << "    " << nThreads << " threads: " << rate / 1e6 << " M photons/s, speedup " << rate / base
+                  << "\n";
+    }
+    SetThreadCount(0);
+    return 0;
+}
+
+//the same path traced image of the demo scene with every spectral representation, one pass per tile
+static int BenchSpectrum() {
+    std::shared_ptr<const Scene> scene = DemoScene();
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(160, 120);
+    job.samplesPerPixel = 8;
+    GuidedPathOptions options;
+    options.guiding = false;
+    std::cout << "path tracing " << job.resolution.x << "x" << job.resolution.y << " at " << job.samplesPerPixel
+              << " spp on " << NumSystemCores() << " threads\n";
+    double base = 0;
+    for (SpectrumRepresentation rep : {SpectrumRepresentation::RGB, SpectrumRepresentation::Sampled}) {
+        job.spectrum = rep;
+        auto start = std::chrono::steady_clock::now();
+        JobContext context(*scene, job, options);
+        std::unique_ptr<Film> film = CreateJobFilm(job, "");
+        AlignedArray<MemoryArena> arenas(MaxThreadIndex());
+        ParallelFor([&](int64_t t) { film->MergeFilmTile(context.RenderTile(int(t), arenas[ThreadIndex])); },
+                    context.Tiles().size());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::vector<Float> rgb(3 * job.resolution.x * job.resolution.y);
+        film->GetRGB(rgb.data());
+        double mean[3] = {0, 0, 0};
+        for (std::size_t i = 0; i < rgb.size(); ++i) mean[i % 3] += rgb[i] / (rgb.size() / 3);
+        double rate = double(job.resolution.x) * job.resolution.y * job.samplesPerPixel / seconds;
+        if (rep == SpectrumRepresentation::RGB) base = rate;
+        std::cout << "    " << SpectrumRepresentationName(rep) << ": " << rate / 1e6 << " M samples/s, "
+                  << rate / base << " of rgb, mean rgb " << mean[0] << " " << mean[1] << " " << mean[2] << "\n";
+    }
+    return 0;
+}
+
+//closest hit traversal over a field of spheres: a full interaction for every candidate hit (Shape::Intersect)
+//against lean hit records with one interaction for the closest hit (as in Scene::Intersect)
+static int BenchIntersect() {
+    uint64_t seed = 0;
+    auto uniform = [&seed]() { return UInt32ToFloat(uint32_t(MixBits(++seed))); };
+    std::vector<std::unique_ptr<Transform>> transforms;
+    std::vector<std::unique_ptr<Sphere>> spheres;
+    for (int i = 0; i < 200; ++i) {
+        Vector3f center(40 * uniform() - 20, 40 * uniform() - 20, 20 + 20 * uniform());
+        transforms.emplace_back(new Transform(Translate(center)));
+        transforms.emplace_back(new Transform(Inverse(*transforms.back())));
+        Float radius = 0.5f + uniform();
+        spheres.emplace_back(new Sphere(transforms[2 * i].get(), transforms[2 * i + 1].get(), false, radius,
+                                        -radius, radius, 360));
+    }
+    std::vector<Ray> rays;
+    for (int i = 0; i < 20000; ++i)
+        rays.emplace_back(Point3f(0, 0, 0),
+                          Normalize(Vector3f(1.2f * uniform() - 0.6f, 1.2f * uniform() - 0.6f, 1)));
+    std::cout << rays.size() << " rays against " << spheres.size() << " spheres\n";
+
+    auto start = std::chrono::steady_clock::now();
+    int fullHits = 0;
+    for (Ray ray : rays) {
+        SurfaceInteraction closest;
+        bool found = false;
+        for (const auto &sphere : spheres) {
+            Float tHit;
+            SurfaceInteraction isect;
+            if (sphere->Intersect(ray, &tHit, &isect)) {
+                ray.tMax = tHit;
+                closest = isect;
+                found = true;
+            }
+        }
+        fullHits += found;
+    }
+    auto middle = std::chrono::steady_clock::now();
+    int leanHits = 0;
+    for (Ray ray : rays) {
+        HitRecord closest;
+        for (std::size_t i = 0; i < spheres.size(); ++i) {
+            if (spheres[i]->IntersectHit(ray, &closest)) {
+                closest.primitiveId = int(i);
+                ray.tMax = closest.tHit;
+            }
+        }
+        if (closest.primitiveId < 0) continue;
+        SurfaceInteraction isect;
+        spheres[closest.primitiveId]->ComputeInteraction(ray, closest, &isect);
+        ++leanHits;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double tests = double(rays.size()) * spheres.size();
+    double full = tests / std::chrono::duration<double>(middle - start).count();
+    double lean = tests / std::chrono::duration<double>(end - middle).count();
+    std::cout << "    full interactions: " << full / 1e6 << " M ray-shape tests/s, " << fullHits << " hits\n"
+              << "    hit records: " << lean / 1e6 << " M ray-shape tests/s, " << leanHits << " hits, speedup "
+              << lean / full << "\n";
+    return fullHits == leanHits ? 0 : 1;
+}
+
+//Merge cost of a 1920x1080 film at 1 to 128 threads. Every 16x16 tile gets 2 samples a pixel through a
+//Gaussian filter and is merged with atomic adds, only the filter borders are shared between tiles.
+//Beyond the hardware threads the pool is oversubscribed: the share of tile time spent merging still shows
+//contention on the borders, but wall clock times per pixel then include time the thread was preempted.
+static int BenchFilm() {
+    const Point2i resolution(1920, 1080);
+    const int tileSize = 16, samplesPerPixel = 2;
+    std::cout << "film merge, " << resolution.x << "x" << resolution.y << ", " << tileSize << "x" << tileSize
+              << " tiles, " << samplesPerPixel << " samples a pixel, gaussian radius 1.5\n";
+    for (int nThreads : ThreadCounts(128)) {
+        SetThreadCount(nThreads);
+        Film film(resolution, Bounds2f(Point2f(0, 0), Point2f(1, 1)),
+                  std::unique_ptr<Filter>(new GaussianFilter(Vector2f(1.5f, 1.5f), 2)), "");
+        Bounds2i sampleBounds = film.GetSampleBounds();
+        Vector2i extent = sampleBounds.Diagonal();
+        Point2i nTiles((extent.x + tileSize - 1) / tileSize, (extent.y + tileSize - 1) / tileSize);
+        //(tile, merge) seconds per thread
+        std::vector<std::pair<double, double>> threadSeconds(MaxThreadIndex());
+        std::atomic<int64_t> mergedPixels(0);
+        auto start = std::chrono::steady_clock::now();
+        ParallelFor2D([&](Point2i t) {
+            auto tileStart = std::chrono::steady_clock::now();
+            Point2i p0 = sampleBounds.pMin + Vector2i(t.x * tileSize, t.y * tileSize);
+            Bounds2i bounds(p0, Point2i(std::min(p0.x + tileSize, sampleBounds.pMax.x),
+                                        std::min(p0.y + tileSize, sampleBounds.pMax.y)));
+            std::unique_ptr<FilmTile> tile = film.GetFilmTile(bounds);
+            const Float xyz[3] = {0.4f, 0.5f, 0.6f};
+            for (Point2i p : bounds) {
+                for (int s = 0; s < samplesPerPixel; ++s) {
+                    uint64_t h = MixBits(uint64_t(p.y) << 40 ^ uint64_t(p.x) << 8 ^ uint64_t(s));
+                    Point2f pFilm(p.x + UInt32ToFloat(uint32_t(h)), p.y + UInt32ToFloat(uint32_t(h >> 32)));
+                    tile->AddSampleXYZ(pFilm, xyz);
+                }
+            }
+            auto mergeStart = std::chrono::steady_clock::now();
+            film.MergeFilmTile(*tile);
+            threadSeconds[ThreadIndex].first += SecondsSince(tileStart);
+            threadSeconds[ThreadIndex].second += SecondsSince(mergeStart);
+            mergedPixels += tile->GetPixelBounds().SurfaceArea();
+        }, nTiles);
+        double seconds = SecondsSince(start), tiles = 0, merge = 0;
+        for (const auto &ts : threadSeconds) {
+            tiles += ts.first;
+            merge += ts.second;
+        }
+        std::cout << "    " << nThreads << " threads" << (nThreads > HardwareThreads() ? " (oversubscribed)" : "")
+                  << ": " << seconds * 1e3 << " ms, merging " << 100 * merge / tiles << "% of tile time, "
+                  << merge / mergedPixels * 1e9 << " ns a tile pixel\n";
+    }
+    SetThreadCount(0);
+    return 0;
+}
+
+//framebuffer resolve of a spectral image: ToRGB pixel by pixel against the bulk SampledSpectrum::ToRGB and
+//the row parallel SpectralImageToRGB/ToXYZ, each timed over the same pixels
+static int BenchResolve() {
+    const int xRes = 640, yRes = 360, nRepeats = 8;
+    const int64_t nPixels = int64_t(xRes) * yRes;
+    SampledSpectrum::Init();
+    std::vector<SampledSpectrum> pixels(nPixels);
+    for (int64_t i = 0; i < nPixels; ++i) {
+        uint64_t h = MixBits(uint64_t(i));
+        const Float rgb[3] = {UInt32ToFloat(uint32_t(h)), UInt32ToFloat(uint32_t(h >> 21)),
+                              UInt32ToFloat(uint32_t(h >> 42))};
+        pixels[i] = SampledSpectrum::FromRGB(rgb);
+    }
+    std::vector<Float> reference(3 * nPixels), rgb(3 * nPixels);
+    std::cout << "resolve " << xRes << "x" << yRes << " spectral pixels of " << nSpectralSamples << " samples, "
+              << nRepeats << " passes, " << NumSystemCores() << " threads\n";
+    auto report = [&](const char *name, double seconds, double base, const std::vector<Float> &out) {
+        Float maxError = 0;
+        for (int64_t i = 0; i < 3 * nPixels; ++i) maxError = std::max(maxError, std::abs(out[i] - reference[i]));
+        std::cout << "    " << name << ": " << nPixels * nRepeats / seconds / 1e6 << " M pixels/s, speedup "
+                  << base / seconds;
+        if (&out != &reference) std::cout << ", max difference " << maxError;
+        std::cout << "\n";
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < nRepeats; ++r)
+        for (int64_t i = 0; i < nPixels; ++i) pixels[i].ToRGB(&reference[3 * i]);
+    double perPixel = SecondsSince(start);
+    report("per pixel ToRGB", perPixel, perPixel, reference);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < nRepeats; ++r) SampledSpectrum::ToRGB(pixels.data(), nPixels, rgb.data());
+    report("bulk ToRGB", SecondsSince(start), perPixel, rgb);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < nRepeats; ++r) SpectralImageToRGB(pixels.data(), xRes, yRes, rgb.data());
+    report("SpectralImageToRGB", SecondsSince(start), perPixel, rgb);
+
+    //xyz goes through the matrix once more so that it compares against the same reference
+    std::vector<Float> xyz(3 * nPixels);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < nRepeats; ++r) SpectralImageToXYZ(pixels.data(), xRes, yRes, xyz.data());
+    double xyzSeconds = SecondsSince(start);
+    for (int64_t i = 0; i < nPixels; ++i) XYZToRGB(&xyz[3 * i], &rgb[3 * i]);
+    report("SpectralImageToXYZ", xyzSeconds, perPixel, rgb);
+    return 0;
+}
+
+//Short lived per path allocations at 1, 2, 4, ... threads up to every hardware thread and at least 8.
+//Every path allocates a few BSDF sized objects, touches them and drops them, with new/delete against
+//a per thread MemoryArena
+static int BenchArena() {
+    const int64_t nPaths = 200000;
+    const int allocsPerPath = 8;
+    std::cout << "per path allocations, " << nPaths << " paths x " << allocsPerPath << " objects of 48 to 272 bytes\n";
+    auto objectSize = [](int64_t path, int i) { return std::size_t(48 + 32 * ((path + i) % 8)); };
+    //one counter per cache line so that the checksums do not share lines between threads
+    struct alignas(SIMPLERENDERER_L1_CACHE_LINE_SIZE) Checksum {
+        int64_t sum = 0;
+    };
+    for (int nThreads : ThreadCounts(std::max(HardwareThreads(), 8))) {
+        SetThreadCount(nThreads);
+        AlignedArray<Checksum> sums(MaxThreadIndex());
+        auto start = std::chrono::steady_clock::now();
+        ParallelFor([&](int64_t path) {
+            char *objects[allocsPerPath];
+            for (int i = 0; i < allocsPerPath; ++i) {
+                objects[i] = new char[objectSize(path, i)];
+                objects[i][0] = char(i);
+            }
+            for (int i = 0; i < allocsPerPath; ++i) {
+                sums[ThreadIndex].sum += objects[i][0];
+                delete[] objects[i];
+            }
+        }, nPaths, 256);
+        double heap = SecondsSince(start);
+
+        AlignedArray<MemoryArena> arenas(MaxThreadIndex());
+        start = std::chrono::steady_clock::now();
+        ParallelFor([&](int64_t path) {
+            MemoryArena &arena = arenas[ThreadIndex];
+            char *objects[allocsPerPath];
+            for (int i = 0; i < allocsPerPath; ++i) {
+                objects[i] = (char *) arena.Alloc(objectSize(path, i));
+                objects[i][0] = char(i);
+            }
+            for (int i = 0; i < allocsPerPath; ++i) sums[ThreadIndex].sum += objects[i][0];
+            arena.Reset();
+        }, nPaths, 256);
+        double arena = SecondsSince(start);
+        double allocs = double(nPaths) * allocsPerPath;
+        std::cout << "    " << nThreads << " threads" << (nThreads > HardwareThreads() ? " (oversubscribed)" : "")
+                  << ": new/delete " << allocs / heap / 1e6 << " M allocs/s, arena " << allocs / arena / 1e6
+                  << " M allocs/s, speedup " << heap / arena << "\n";
+    }
+    SetThreadCount(0);
+    return 0;
+}
+
+//Sample generation per thread for every sampler at 1, 2, 4, ... threads up to every hardware thread.
+//A sample vector is a camera sample and 8 1D plus 8 2D dimensions, about what one path bounce takes.
+//Construction is timed on its own: Halton draws its digit permutations from a mt19937 there.
+static int BenchSamplers() {
+    const Point2i resolution(256, 256);
+    const int samplesPerPixel = 16, nDimensions = 8;
+    std::cout << "sample vectors, " << resolution.x << "x" << resolution.y << " pixels at " << samplesPerPixel
+              << " spp, camera sample plus " << nDimensions << " 1D and " << nDimensions << " 2D dimensions\n";
+    std::vector<std::pair<const char *, std::function<Sampler *()>>> samplers{
+            {"sobol", [&]() { return new SobolSampler(samplesPerPixel); }},
+            {"halton", [&]() { return new HaltonSampler(samplesPerPixel); }},
+            {"pmj02", [&]() { return new PMJ02Sampler(samplesPerPixel); }}};
+    for (const auto &entry : samplers) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Sampler> prototype(entry.second());
+        std::cout << "    " << entry.first << ", constructed in " << SecondsSince(start) * 1e6 << " us\n";
+        for (int nThreads : ThreadCounts(HardwareThreads())) {
+            SetThreadCount(nThreads);
+            std::vector<std::unique_ptr<Sampler>> clones(MaxThreadIndex());
+            for (auto &clone : clones) clone = prototype->Clone();
+            std::vector<double> sums(MaxThreadIndex());
+            start = std::chrono::steady_clock::now();
+            ParallelFor([&](int64_t y) {
+                Sampler &sampler = *clones[ThreadIndex];
+                double sum = 0;
+                for (int x = 0; x < resolution.x; ++x) {
+                    Point2i p(x, int(y));
+                    for (int s = 0; s < samplesPerPixel; ++s) {
+                        sampler.StartPixelSample(p, s);
+                        sum += sampler.GetCameraSample(p).pFilm.x;
+                        for (int d = 0; d < nDimensions; ++d) sum += sampler.Get1D() + sampler.Get2D().y;
+                    }
+                }
+                sums[ThreadIndex] += sum;
+            }, resolution.y);
+            double seconds = SecondsSince(start);
+            double vectors = double(resolution.x) * resolution.y * samplesPerPixel;
+            std::cout << "        " << nThreads << " threads: " << vectors / seconds / nThreads / 1e6
+                      << " M sample vectors/s/thread, " << vectors * (3 * nDimensions + 5) / seconds / nThreads / 1e6
+                      << " M dimensions/s/thread\n";
+        }
+    }
+    SetThreadCount(0);
+    return 0;
+}
 
-    Vector3f v(1, 1, 1);
-    std::cout << RotateX(90)(v);
+static const char *CurveOrderName(CurveOrder order) {
+    return order == CurveOrder::Morton ? "morton" : order == CurveOrder::Hilbert ? "hilbert" : "spiral";
+}
+
+//set associative LRU cache of 64 byte lines, counts the misses of a stream of addresses
+class CacheModel {
+public:
+    CacheModel(int nSets, int nWays) : nSets(nSets), nWays(nWays), lines(nSets * nWays, ~uint64_t(0)) {}
+
+    void Access(uint64_t address) {
+        uint64_t line = address / 64;
+        uint64_t *set = &lines[(line % nSets) * nWays];
+        int way = 0;
+        while (way < nWays && set[way] != line) ++way;
+        if (way == nWays) {
+            ++misses;
+            way = nWays - 1;
+        }
+        //set[0] is the most recently used line
+        for (; way > 0; --way) set[way] = set[way - 1];
+        set[0] = line;
+        ++accesses;
+    }
+
+    int64_t accesses = 0, misses = 0;
+
+private:
+    const int nSets, nWays;
+    std::vector<uint64_t> lines;
+};
+
+//Pixel and tile orders. Locality: every pixel of a 1024x1024 rgb float image in row major and curve order
+//reads its 5x5 neighbourhood, as a filter of radius 2 does, through a modelled 32 KB 8 way L1 and for real.
+//Preview: one pass over the demo scene in 16x16 tiles per tile order, timed until every pixel of the
+//central quarter of the frame has its first sample.
+static int BenchCurves() {
+    const int size = 1024, radius = 2;
+    std::vector<Float> image(3 * size * size, 1.f);
+    Bounds2i bounds(Point2i(0, 0), Point2i(size, size));
+    std::cout << "5x5 neighbourhood reads over " << size << "x" << size << " rgb floats, 32 KB 8 way LRU model\n";
+    //the order is enumerated first so that the reads are timed without the curve decoding
+    auto locality = [&](const char *name, const std::function<void(std::vector<Point2i> *)> &enumerate) {
+        std::vector<Point2i> points;
+        points.reserve(std::size_t(size) * size);
+        auto start = std::chrono::steady_clock::now();
+        enumerate(&points);
+        double enumerateSeconds = SecondsSince(start);
+        CacheModel cache(64, 8);
+        for (Point2i p : points)
+            for (int y = std::max(0, p.y - radius); y <= std::min(size - 1, p.y + radius); ++y)
+                for (int x = std::max(0, p.x - radius); x <= std::min(size - 1, p.x + radius); ++x)
+                    cache.Access(uint64_t(y * size + x) * 3 * sizeof(Float));
+        double sum = 0;
+        start = std::chrono::steady_clock::now();
+        for (Point2i p : points)
+            for (int y = std::max(0, p.y - radius); y <= std::min(size - 1, p.y + radius); ++y)
+                for (int x = std::max(0, p.x - radius); x <= std::min(size - 1, p.x + radius); ++x)
+                    sum += image[3 * (y * size + x)];
+        double seconds = SecondsSince(start);
+        double nPixels = double(points.size());
+        std::cout << "    " << name << ": " << 100.0 * cache.misses / cache.accesses << "% modelled misses, reads "
+                  << seconds * 1e9 / nPixels << " ns a pixel, enumerating " << enumerateSeconds * 1e9 / nPixels
+                  << " ns a pixel" << (sum > 0 ? "" : " (nothing read)") << "\n";
+    };
+    locality("row major", [&](std::vector<Point2i> *points) {
+        for (Point2i p : bounds) points->push_back(p);
+    });
+    for (CurveOrder order : {CurveOrder::Morton, CurveOrder::Hilbert, CurveOrder::Spiral})
+        locality(CurveOrderName(order), [&](std::vector<Point2i> *points) {
+            for (Point2i p : Bounds2iCurve(bounds, order)) points->push_back(p);
+        });
+
+    std::shared_ptr<const Scene> scene = DemoScene();
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(320, 240);
+    Bounds2i center(Point2i(job.resolution.x / 4, job.resolution.y / 4),
+                    Point2i(3 * job.resolution.x / 4, 3 * job.resolution.y / 4));
+    std::cout << "first pass over " << job.resolution.x << "x" << job.resolution.y << " in 16x16 tiles on "
+              << NumSystemCores() << " threads, preview is the central " << center.Diagonal().x << "x"
+              << center.Diagonal().y << "\n";
+    for (CurveOrder order : {CurveOrder::Morton, CurveOrder::Hilbert, CurveOrder::Spiral}) {
+        std::unique_ptr<Film> film = CreateJobFilm(job, "");
+        GuidedPathOptions options;
+        options.guiding = false;
+        GuidedPathIntegrator integrator(JobCamera(job, film.get()),
+                                        std::unique_ptr<Sampler>(new SobolSampler(1)), options);
+        integrator.Preprocess(*scene);
+        PixelSampleFunc func = integrator.SampleFunc(*scene);
+        std::atomic<int64_t> centerLeft(center.SurfaceArea());
+        std::atomic<double> previewSeconds(0);
+        auto start = std::chrono::steady_clock::now();
+        ProgressiveOptions progressive;
+        progressive.maxSamplesPerPixel = 1;
+        progressive.tileOrder = order;
+        ProgressiveRenderer renderer(film.get(), [&](const Point2i &p, int64_t index, FilmTile *tile,
+                                                     MemoryArena &arena) {
+            func(p, index, tile, arena);
+            if (InsideExclusive(center, p) && --centerLeft == 0) previewSeconds = SecondsSince(start);
+        }, progressive);
+        renderer.Render();
+        double seconds = SecondsSince(start);
+        std::cout << "    " << CurveOrderName(order) << ": preview after " << previewSeconds * 1e3 << " ms, "
+                  << 100 * previewSeconds / seconds << "% of the " << seconds * 1e3 << " ms pass\n";
+    }
+    return 0;
+}
+
+//Time to a target error with and without adaptive sampling. The demo scene at 128x96 against a 512 spp
+//reference, 4 samples a pass up to 128 spp; adaptive retires tiles below a relative error of 1% after 8 spp.
+//Seconds exclude the error measurement done after every pass.
+static int BenchAdaptive() {
+    std::shared_ptr<const Scene> scene = DemoScene();
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(128, 96);
+    GuidedPathOptions options;
+    options.guiding = false;
+    ProgressiveOptions progressive;
+    progressive.samplesPerPass = 64;
+    progressive.maxSamplesPerPixel = job.samplesPerPixel = 512;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Float> reference = PathTrace(*scene, job, options, progressive);
+    std::cout << "time to error on " << job.resolution.x << "x" << job.resolution.y << ", reference of "
+              << job.samplesPerPixel << " spp took " << SecondsSince(start) << " s\n";
+
+    const std::vector<double> targets{0.2, 0.1, 0.05, 0.03};
+    std::vector<double> uniformSeconds(targets.size(), 0);
+    for (Float threshold : {Float(0), Float(0.01)}) {
+        progressive.samplesPerPass = 4;
+        progressive.maxSamplesPerPixel = job.samplesPerPixel = 128;
+        progressive.errorThreshold = threshold;
+        progressive.minAdaptiveSamples = 8;
+        //(seconds, error) after every pass
+        std::vector<std::pair<double, double>> trace;
+        double measuring = 0;
+        start = std::chrono::steady_clock::now();
+        progressive.onPass = [&](const std::vector<Float> &rgb, int) {
+            auto measureStart = std::chrono::steady_clock::now();
+            trace.emplace_back(SecondsSince(start) - measuring, RelativeRMSE(rgb, reference));
+            measuring += SecondsSince(measureStart);
+        };
+        PathTrace(*scene, job, options, progressive);
+        std::cout << "    " << (threshold > 0 ? "adaptive" : "uniform") << ": final error " << trace.back().second
+                  << " after " << trace.back().first << " s\n";
+        for (std::size_t i = 0; i < targets.size(); ++i) {
+            auto hit = std::find_if(trace.begin(), trace.end(),
+                                    [&](const std::pair<double, double> &t) { return t.second <= targets[i]; });
+            std::cout << "        error " << targets[i] << ": ";
+            if (hit == trace.end()) {
+                std::cout << "not reached\n";
+                continue;
+            }
+            std::cout << hit->first << " s";
+            if (threshold == 0) uniformSeconds[i] = hit->first;
+            else if (uniformSeconds[i] > 0) std::cout << ", speedup " << uniformSeconds[i] / hit->first;
+            std::cout << "\n";
+        }
+    }
+    return 0;
+}
+
+//Noise at equal time per light sampler: the demo spheres lit by a 16x16 grid of point lights of random power
+//just above the ground, 96x72 for one second each against a 256 spp reference with the BVH sampler
+static int BenchLights() {
+    std::vector<std::shared_ptr<Light>> lights;
+    for (int i = 0; i < 256; ++i) {
+        uint64_t h = MixBits(uint64_t(i));
+        Float power = 0.05f + 2 * UInt32ToFloat(uint32_t(h)) * UInt32ToFloat(uint32_t(h >> 32));
+        Vector3f p(-8 + Float(i % 16), 0.3f, -4 + Float(i / 16));
+        lights.push_back(std::make_shared<PointLight>(Translate(p), MediumInterface(), Spectrum(power)));
+    }
+    std::shared_ptr<const Scene> scene = DemoScene(lights);
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(96, 72);
+    GuidedPathOptions options;
+    options.guiding = false;
+    options.lightSampling = LightSampling::BVH;
+    ProgressiveOptions progressive;
+    progressive.samplesPerPass = 64;
+    progressive.maxSamplesPerPixel = job.samplesPerPixel = 256;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Float> reference = PathTrace(*scene, job, options, progressive);
+    std::cout << lights.size() << " point lights, " << job.resolution.x << "x" << job.resolution.y
+              << ", reference of " << job.samplesPerPixel << " spp took " << SecondsSince(start) << " s\n";
+
+    const double budget = 1;
+    const std::pair<const char *, LightSampling> samplers[] = {{"uniform", LightSampling::Uniform},
+                                                               {"power", LightSampling::Power},
+                                                               {"bvh", LightSampling::BVH}};
+    for (const auto &sampler : samplers) {
+        options.lightSampling = sampler.second;
+        progressive.samplesPerPass = 1;
+        progressive.maxSamplesPerPixel = 0;
+        progressive.timeBudget = budget;
+        int64_t passes = 0;
+        progressive.onPass = [&](const std::vector<Float> &, int pass) { passes = pass + 1; };
+        std::vector<Float> rgb = PathTrace(*scene, job, options, progressive);
+        std::cout << "    " << sampler.first << ": " << passes << " spp in " << budget << " s, error "
+                  << RelativeRMSE(rgb, reference) << "\n";
+    }
     return 0;
 }
+
+//Environment map convergence: the demo spheres under a sky with a small bright sun, error against a 256 spp
+//reference at 1, 2, 4, ... 64 spp with the map importance sampled and with directions uniform over the sphere
+static int BenchEnvmap() {
+    const Point2i mapResolution(256, 128);
+    const std::string mapFile = "SimpleRendererBenchSky.pfm";
+    std::vector<Float> sky(3 * mapResolution.x * mapResolution.y);
+    for (int y = 0; y < mapResolution.y; ++y)
+        for (int x = 0; x < mapResolution.x; ++x) {
+            Float *rgb = &sky[3 * (y * mapResolution.x + x)];
+            bool sun = std::abs(x - 40) <= 1 && std::abs(y - 30) <= 1;
+            rgb[0] = sun ? 4000 : 0.2f;
+            rgb[1] = sun ? 3600 : 0.3f;
+            rgb[2] = sun ? 3000 : 0.5f;
+        }
+    if (!WriteImage(mapFile, sky.data(), mapResolution)) return 1;
+    //the map's +z is the pole, turned to the world's +y
+    Transform lightToWorld = RotateX(-90);
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(96, 72);
+    GuidedPathOptions options;
+    options.guiding = false;
+    std::vector<Float> reference;
+    for (bool importance : {true, false}) {
+        std::shared_ptr<const Scene> scene = DemoScene(
+                {std::make_shared<InfiniteAreaLight>(lightToWorld, Spectrum(1.f), 1, mapFile, importance)});
+        ProgressiveOptions progressive;
+        if (reference.empty()) {
+            progressive.samplesPerPass = 64;
+            progressive.maxSamplesPerPixel = job.samplesPerPixel = 256;
+            auto start = std::chrono::steady_clock::now();
+            reference = PathTrace(*scene, job, options, progressive);
+            std::cout << "environment map " << mapResolution.x << "x" << mapResolution.y << " with a 3x3 texel sun, "
+                      << job.resolution.x << "x" << job.resolution.y << ", reference of " << job.samplesPerPixel
+                      << " spp took " << SecondsSince(start) << " s\n";
+        }
+        progressive.samplesPerPass = 1;
+        progressive.maxSamplesPerPixel = job.samplesPerPixel = 64;
+        std::cout << "    " << (importance ? "importance sampled" : "uniform sphere") << ", error at";
+        auto start = std::chrono::steady_clock::now();
+        progressive.onPass = [&](const std::vector<Float> &rgb, int pass) {
+            if (IsPowerOf2(uint64_t(pass + 1)))
+                std::cout << (pass ? ", " : " ") << pass + 1 << " spp " << RelativeRMSE(rgb, reference);
+        };
+        PathTrace(*scene, job, options, progressive);
+        std::cout << "; " << SecondsSince(start) << " s\n";
+    }
+    std::remove(mapFile.c_str());
+    return 0;
+}
+
+//Null collisions of delta and ratio tracking through a 64^3 cloud that fills a third of its box, with one global
+//majorant and with majorant grids of increasing resolution. Rays run from a sphere around the box to points
+//inside it, one Sample and one Tr call each.
+static int BenchMajorant() {
+    const int res = 64;
+    std::vector<Float> density(res * res * res);
+    for (int z = 0; z < res; ++z)
+        for (int y = 0; y < res; ++y)
+            for (int x = 0; x < res; ++x) {
+                Vector3f d((x + 0.5f) / res - 0.5f, (y + 0.5f) / res - 0.5f, (z + 0.5f) / res - 0.5f);
+                Float falloff = std::max(Float(0), 1 - d.Length() / 0.43f);
+                Float noise = UInt32ToFloat(uint32_t(MixBits(uint64_t((z * res + y) * res + x))));
+                density[(z * res + y) * res + x] = falloff * (0.5f + noise);
+            }
+    const int nRays = 100000;
+    uint64_t seed = 0;
+    auto uniform = [&seed]() { return UInt32ToFloat(uint32_t(MixBits(++seed))); };
+    std::vector<Ray> rays;
+    for (int i = 0; i < nRays; ++i) {
+        Vector3f o = UniformSampleSphere(Point2f(uniform(), uniform())) * 2 + Vector3f(0.5f, 0.5f, 0.5f);
+        Point3f target(uniform(), uniform(), uniform());
+        rays.emplace_back(Point3f(o.x, o.y, o.z), target - Point3f(o.x, o.y, o.z), 1);
+    }
+    std::cout << rays.size() << " rays into a " << res << "^3 density grid, sigma_t 20, majorant grid resolutions\n";
+    for (int majorantRes : {1, 4, 16, 32}) {
+        GridDensityMedium medium(Spectrum(2.f), Spectrum(18.f), 0, res, res, res, Translate(Vector3f(0, 0, 0)),
+                                 density.data(), majorantRes);
+        SobolSampler sampler(1);
+        ClearStats();
+        double transmittance = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < nRays; ++i) {
+            sampler.StartPixelSample(Point2i(i, 0), 0);
+            MediumInteraction mi;
+            medium.Sample(rays[i], sampler, &mi);
+            transmittance += medium.Tr(rays[i], sampler)[0];
+        }
+        double seconds = SecondsSince(start);
+        int64_t nulls = StatCounterValue("Media/Grid null collisions");
+        int64_t real = StatCounterValue("Media/Grid real collisions");
+        int64_t cells = StatCounterValue("Media/Grid majorant cells visited");
+        std::cout << "    " << majorantRes << "^3: " << double(nulls) / nRays << " null and " << double(real) / nRays
+                  << " real collisions a ray, " << double(cells) / nRays << " cells a ray, " << seconds * 1e9 / nRays
+                  << " ns a ray, mean transmittance " << transmittance / nRays << "\n";
+    }
+    ClearStats();
+    return 0;
+}
+
+//demo scene lit only indirectly: the point light sits in a shade open at the top and reaches the spheres
+//and the ground by way of a ceiling, the kind of light transport guiding is meant for
+static std::shared_ptr<const Scene> ShadedLampScene() {
+    static const Transform groundToWorld = Translate(Vector3f(0, -1000, 0)), worldToGround = Inverse(groundToWorld);
+    static const Transform ceilingToWorld = Translate(Vector3f(0, 1004.5f, 0));
+    static const Transform worldToCeiling = Inverse(ceilingToWorld);
+    static const Transform bigToWorld = Translate(Vector3f(0, 1, 0)), worldToBig = Inverse(bigToWorld);
+    static const Transform smallToWorld = Translate(Vector3f(-2.2f, 0.8f, 1)), worldToSmall = Inverse(smallToWorld);
+    //object space +z, where the shade is open, turned up
+    static const Transform shadeToWorld = Translate(Vector3f(1.5f, 2.5f, 1)) * RotateX(-90),
+            worldToShade = Inverse(shadeToWorld);
+    std::vector<Primitive> primitives;
+    primitives.push_back({std::make_shared<Sphere>(&groundToWorld, &worldToGround, false, 1000, -1000, 1000, 360),
+                          std::make_shared<Material>(Spectrum(0.6f))});
+    primitives.push_back({std::make_shared<Sphere>(&ceilingToWorld, &worldToCeiling, false, 1000, -1000, 1000, 360),
+                          std::make_shared<Material>(Spectrum(0.8f))});
+    primitives.push_back({std::make_shared<Sphere>(&bigToWorld, &worldToBig, false, 1, -1, 1, 360),
+                          std::make_shared<Material>(Spectrum(0.8f))});
+    primitives.push_back({std::make_shared<Sphere>(&smallToWorld, &worldToSmall, false, 0.8f, -0.8f, 0.8f, 360),
+                          std::make_shared<Material>(Spectrum(0.7f))});
+    primitives.push_back({std::make_shared<Sphere>(&shadeToWorld, &worldToShade, false, 0.5f, -0.5f, 0.25f, 360),
+                          std::make_shared<Material>(Spectrum(0.5f))});
+    std::vector<std::shared_ptr<Light>> lights{
+            std::make_shared<PointLight>(Translate(Vector3f(1.5f, 2.5f, 1)), MediumInterface(), Spectrum(30.f))};
+    return std::make_shared<Scene>(std::move(primitives), std::move(lights));
+}
+
+//Equal time error with and without path guiding on ShadedLampScene, 64x48 for four seconds each against a
+//guided reference of 512 spp. The spatial threshold is lowered with the pixel count, the default is meant for
+//images of a megapixel and would leave the tree at a few leaves here.
+static int BenchGuiding() {
+    std::shared_ptr<const Scene> scene = ShadedLampScene();
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    job.resolution = Point2i(64, 48);
+    GuidedPathOptions options;
+    options.spatialThreshold = 1000;
+    ProgressiveOptions progressive;
+    progressive.maxSamplesPerPixel = job.samplesPerPixel = 512;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Float> reference = PathTrace(*scene, job, options, progressive);
+    std::cout << "indirectly lit scene, " << job.resolution.x << "x" << job.resolution.y << ", reference of "
+              << job.samplesPerPixel << " spp took " << SecondsSince(start) << " s\n";
+
+    const double budget = 4;
+    for (bool guiding : {false, true}) {
+        options.guiding = guiding;
+        progressive.maxSamplesPerPixel = 0;
+        progressive.timeBudget = budget;
+        int passes = 0;
+        progressive.onPass = [&](const std::vector<Float> &, int pass) { passes = pass + 1; };
+        std::vector<Float> rgb = PathTrace(*scene, job, options, progressive);
+        std::cout << "    " << (guiding ? "guided" : "unguided") << ": " << passes << " passes in " << budget
+                  << " s, error " << RelativeRMSE(rgb, reference) << "\n";
+    }
+    return 0;
+}
+
+static int Bench(const std::string &name) {
+    if (name == "adaptive") return BenchAdaptive();
+    if (name == "arena") return BenchArena();
+    if (name == "curves") return BenchCurves();
+    if (name == "envmap") return BenchEnvmap();
+    if (name == "film") return BenchFilm();
+    if (name == "guiding") return BenchGuiding();
+    if (name == "intersect") return BenchIntersect();
+    if (name == "lights") return BenchLights();
+    if (name == "majorant") return BenchMajorant();
+    if (name == "resolve") return BenchResolve();
+    if (name == "samplers") return BenchSamplers();
+    if (name == "sppm") return BenchSPPM();
+    if (name == "spectrum") return BenchSpectrum();
+    std::cerr << "unknown benchmark " << name << "\n";
+    return 1;
+}
+
+static int Usage() {
+    std::cerr << "usage: SimpleRenderer --serve <socket>\n"
+                 "       SimpleRenderer --render <socket> [job options]\n"
+                 "       SimpleRenderer --shutdown <socket>\n"
+                 "       SimpleRenderer --coordinate <endpoint> [--workers n] [--float|--half] [job options]\n"
+                 "       SimpleRenderer --work <endpoint> [--threads n]\n"
+                 "       SimpleRenderer --bench <name>\n"
+                 "job options: [--spp n] [--res w h] [--crop x0 y0 x1 y1] [--tile n] [--spectrum rgb|sampled]\n"
+                 "             [--out file]\n"
+                 "endpoints are tcp:<host>:<port>, unix:<path> or a socket path\n"
+                 "benchmarks: adaptive arena curves envmap film guiding intersect lights majorant resolve samplers\n"
+                 "            sppm spectrum\n";
+    return 1;
+}
+
+static int Run(int argc, char *argv[]) {
+    if (argc < 3) return Usage();
+    std::string mode = argv[1], socketPath = argv[2];
+
+    if (mode == "--serve") {
+        RenderServer server(DemoScene());
+        std::cout << "serving on " << socketPath << std::endl;
+        if (!server.Serve(socketPath)) return 1;
+        std::cout << server.JobsServed() << " jobs served" << std::endl;
+        return 0;
+    }
+    if (mode == "--shutdown") return RequestShutdown(socketPath) ? 0 : 1;
+    if (mode == "--bench") return argc == 3 ? Bench(argv[2]) : Usage();
+    if (mode == "--work") {
+        if (argc == 5 && !std::strcmp(argv[3], "--threads")) SetThreadCount(std::atoi(argv[4]));
+        else if (argc != 3) return Usage();
+        return RunRenderWorker(socketPath, DemoScene()) ? 0 : 1;
+    }
+    if (mode != "--render" && mode != "--coordinate") return Usage();
+
+    RenderJob job;
+    job.eye = Point3f(0, 3, -6);
+    job.target = Point3f(0, 0.5f, 0);
+    std::string out = "render.pfm";
+    int nWorkers = 1;
+    DistributedOptions distributed;
+    for (int i = 3; i < argc; ++i) {
+        auto has = [&](int n) { return i + n < argc; };
+        if (!std::strcmp(argv[i], "--spp") && has(1)) {
+            job.samplesPerPixel = std::atoll(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--res") && has(2)) {
+            job.resolution.x = std::atoi(argv[++i]);
+            job.resolution.y = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--crop") && has(4)) {
+            job.crop.pMin.x = std::atoi(argv[++i]);
+            job.crop.pMin.y = std::atoi(argv[++i]);
+            job.crop.pMax.x = std::atoi(argv[++i]);
+            job.crop.pMax.y = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--tile") && has(1)) {
+            job.tileSize = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--spectrum") && has(1)) {
+            if (!ParseSpectrumRepresentation(argv[++i], &job.spectrum)) return Usage();
+        } else if (!std::strcmp(argv[i], "--out") && has(1)) {
+            out = argv[++i];
+        } else if (!std::strcmp(argv[i], "--workers") && has(1) && mode == "--coordinate") {
+            nWorkers = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--half") && mode == "--coordinate") {
+            distributed.encoding = TileEncoding::Half;
+        } else if (!std::strcmp(argv[i], "--float") && mode == "--coordinate") {
+            distributed.encoding = TileEncoding::Float;
+        } else {
+            return Usage();
+        }
+    }
+
+    std::unique_ptr<Film> film = CreateJobFilm(job, out);
+    if (mode == "--render") {
+        RenderJobStats stats;
+        if (!RequestRender(socketPath, job, film.get(), &stats)) return 1;
+        std::cout << stats.tiles << " tiles, " << stats.payloadBytes << " bytes, " << stats.seconds
+                  << "s on the server" << std::endl;
+        return film->WriteImage() ? 0 : 1;
+    }
+
+    RenderCoordinator coordinator(socketPath, distributed);
+    if (!coordinator.Listen()) return 1;
+    std::cout << "waiting for " << nWorkers << " workers on " << socketPath << std::endl;
+    if (coordinator.WaitForWorkers(nWorkers, distributed.workerTimeout) == 0) {
+        std::cerr << "no workers connected" << std::endl;
+        return 1;
+    }
+    DistributedReport report;
+    bool ok = coordinator.Render(job, film.get(), &report);
+    report.Print(std::cout);
+    return ok && film->WriteImage() ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    int status = Run(argc, argv);
+    //whatever the counters and validation checks saw, also after a failure
+    PrintStats(std::cerr);
+    return status;
+}
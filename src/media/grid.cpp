@@ -0,0 +1,169 @@
+//
+// Created by 18310 on 2021/5/7.
+//
+
+#include "grid.h"
+#include "interaction.h"
+#include "sampler.h"
+#include "stats.h"
+
+namespace sr {
+
+    SR_STAT_COUNTER("Media/Grid null collisions", nullCollisions);
+    SR_STAT_COUNTER("Media/Grid real collisions", realCollisions);
+    SR_STAT_COUNTER("Media/Grid majorant cells visited", majorantCellsVisited);
+
+    GridDensityMedium::GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g,
+                                         const Transform &mediumToWorld) : sigma_a(sigma_a), sigma_s(sigma_s),
+                                                                           sigma_t((sigma_a + sigma_s)[0]),
+                                                                           phase(g),
+                                                                           WorldToMedium(Inverse(mediumToWorld)) {}
+
+    GridDensityMedium::GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g, int nx, int ny,
+                                         int nz, const Transform &mediumToWorld, const Float *d, int majorantRes)
+            : GridDensityMedium(sigma_a, sigma_s, g, mediumToWorld) {
+        this->nx = nx;
+        this->ny = ny;
+        this->nz = nz;
+        density.reset(new Float[nx * ny * nz]);
+        std::memcpy(density.get(), d, sizeof(Float) * nx * ny * nz);
+        BuildMajorantGrid(majorantRes);
+    }
+
+    Float GridDensityMedium::Density(const Point3f &p) const {
+        //voxel centers sit at (i + 0.5) / n
+        Float x = p.x * nx - 0.5f, y = p.y * ny - 0.5f, z = p.z * nz - 0.5f;
+        Point3i pi((int) std::floor(x), (int) std::floor(y), (int) std::floor(z));
+        Float dx = x - pi.x, dy = y - pi.y, dz = z - pi.z;
+        auto lerp = [](Float t, Float a, Float b) { return (1 - t) * a + t * b; };
+        Float d00 = lerp(dx, D(pi), D(Point3i(pi.x + 1, pi.y, pi.z)));
+        Float d10 = lerp(dx, D(Point3i(pi.x, pi.y + 1, pi.z)), D(Point3i(pi.x + 1, pi.y + 1, pi.z)));
+        Float d01 = lerp(dx, D(Point3i(pi.x, pi.y, pi.z + 1)), D(Point3i(pi.x + 1, pi.y, pi.z + 1)));
+        Float d11 = lerp(dx, D(Point3i(pi.x, pi.y + 1, pi.z + 1)), D(Point3i(pi.x + 1, pi.y + 1, pi.z + 1)));
+        return lerp(dz, lerp(dy, d00, d10), lerp(dy, d01, d11));
+    }
+
+    Float GridDensityMedium::MaxDensity(const Bounds3f &b) const {
+        //every voxel whose trilinear support overlaps b
+        Point3i p0((int) std::floor(b.pMin.x * nx - 0.5f), (int) std::floor(b.pMin.y * ny - 0.5f),
+                   (int) std::floor(b.pMin.z * nz - 0.5f));
+        Point3i p1((int) std::floor(b.pMax.x * nx - 0.5f) + 2, (int) std::floor(b.pMax.y * ny - 0.5f) + 2,
+                   (int) std::floor(b.pMax.z * nz - 0.5f) + 2);
+        Bounds3i voxels(Point3i(std::max(p0.x, 0), std::max(p0.y, 0), std::max(p0.z, 0)),
+                        Point3i(std::min(p1.x, nx), std::min(p1.y, ny), std::min(p1.z, nz)));
+        Float maxD = 0;
+        for (Point3i p : voxels) maxD = std::max(maxD, D(p));
+        return maxD;
+    }
+
+    void GridDensityMedium::BuildMajorantGrid(int res) {
+        majorantRes = std::max(res, 1);
+        majorants.resize(majorantRes * majorantRes * majorantRes);
+        Float inv = 1 / (Float) majorantRes;
+        for (Point3i c : Bounds3i(Point3i(0, 0, 0), Point3i(majorantRes, majorantRes, majorantRes))) {
+            Bounds3f cell(Point3f(c.x * inv, c.y * inv, c.z * inv),
+                          Point3f((c.x + 1) * inv, (c.y + 1) * inv, (c.z + 1) * inv));
+            majorants[(c.z * majorantRes + c.y) * majorantRes + c.x] = sigma_t * MaxDensity(cell);
+        }
+    }
+
+    template<typename F>
+    void GridDensityMedium::TraverseMajorants(const Ray &ray, Float tMin, Float tMax, F f) const {
+        //entry point in grid coordinates
+        Float pGrid[3], nextCrossingT[3], deltaT[3];
+        int voxel[3], step[3], voxelLimit[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            pGrid[axis] = (ray.o[axis] + ray.d[axis] * tMin) * majorantRes;
+            voxel[axis] = Clamp((int) pGrid[axis], 0, majorantRes - 1);
+            if (ray.d[axis] == 0) {
+                nextCrossingT[axis] = Infinity;
+                deltaT[axis] = Infinity;
+                step[axis] = 0;
+                voxelLimit[axis] = -1;
+                continue;
+            }
+            deltaT[axis] = 1 / (std::abs(ray.d[axis]) * majorantRes);
+            if (ray.d[axis] > 0) {
+                nextCrossingT[axis] = tMin + ((voxel[axis] + 1) - pGrid[axis]) / (ray.d[axis] * majorantRes);
+                step[axis] = 1;
+                voxelLimit[axis] = majorantRes;
+            } else {
+                nextCrossingT[axis] = tMin + (voxel[axis] - pGrid[axis]) / (ray.d[axis] * majorantRes);
+                step[axis] = -1;
+                voxelLimit[axis] = -1;
+            }
+        }
+
+        Float t0 = tMin;
+        int64_t visited = 0;
+        while (t0 < tMax) {
+            int axis = nextCrossingT[0] < nextCrossingT[1] ? (nextCrossingT[0] < nextCrossingT[2] ? 0 : 2)
+                                                           : (nextCrossingT[1] < nextCrossingT[2] ? 1 : 2);
+            Float t1 = std::min(tMax, nextCrossingT[axis]);
+            ++visited;
+            if (!f(t0, t1, majorants[(voxel[2] * majorantRes + voxel[1]) * majorantRes + voxel[0]])) break;
+            t0 = t1;
+            voxel[axis] += step[axis];
+            if (voxel[axis] == voxelLimit[axis]) break;
+            nextCrossingT[axis] += deltaT[axis];
+        }
+        majorantCellsVisited.Add(visited);
+    }
+
+    Spectrum GridDensityMedium::Sample(const Ray &rWorld, Sampler &sampler, MediumInteraction *mi) const {
+        //medium space ray whose parameter is world distance
+        Ray ray = WorldToMedium(Ray(rWorld.o, Normalize(rWorld.d), rWorld.tMax * rWorld.d.Length()));
+        Float tMin, tMax;
+        if (!Bounds3f(Point3f(0, 0, 0), Point3f(1, 1, 1)).IntersectP(ray, &tMin, &tMax)) return Spectrum(1.f);
+
+        //delta tracking, restarted at every cell boundary since free flights are memoryless
+        bool scattered = false;
+        Float tScatter = 0;
+        int64_t nulls = 0;
+        TraverseMajorants(ray, tMin, tMax, [&](Float t0, Float t1, Float sigma_maj) {
+            if (sigma_maj == 0) return true;
+            Float t = t0;
+            while (true) {
+                t -= std::log(1 - sampler.Get1D()) / sigma_maj;
+                if (t >= t1) return true;
+                Point3f p = ray.o + ray.d * t;
+                if (Density(p) * sigma_t > sampler.Get1D() * sigma_maj) {
+                    scattered = true;
+                    tScatter = t;
+                    return false;
+                }
+                ++nulls;
+            }
+        });
+        nullCollisions.Add(nulls);
+        if (!scattered) return Spectrum(1.f);
+
+        ++realCollisions;
+        Vector3f d = Normalize(rWorld.d);
+        *mi = MediumInteraction(rWorld.o + d * tScatter, -rWorld.d, rWorld.time, this, &phase);
+        return sigma_s / sigma_t;
+    }
+
+    Spectrum GridDensityMedium::Tr(const Ray &rWorld, Sampler &sampler) const {
+        Ray ray = WorldToMedium(Ray(rWorld.o, Normalize(rWorld.d), rWorld.tMax * rWorld.d.Length()));
+        Float tMin, tMax;
+        if (!Bounds3f(Point3f(0, 0, 0), Point3f(1, 1, 1)).IntersectP(ray, &tMin, &tMax)) return Spectrum(1.f);
+
+        //ratio tracking, every tentative collision scales the estimate by its null fraction
+        Float Tr = 1;
+        int64_t nulls = 0;
+        TraverseMajorants(ray, tMin, tMax, [&](Float t0, Float t1, Float sigma_maj) {
+            if (sigma_maj == 0) return true;
+            Float t = t0;
+            while (true) {
+                t -= std::log(1 - sampler.Get1D()) / sigma_maj;
+                if (t >= t1) return true;
+                Tr *= 1 - Density(ray.o + ray.d * t) * sigma_t / sigma_maj;
+                ++nulls;
+                if (Tr <= 0) return false;
+            }
+        });
+        nullCollisions.Add(nulls);
+        return Spectrum(Tr);
+    }
+}
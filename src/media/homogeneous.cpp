@@ -0,0 +1,35 @@
+//
+// Created by 18310 on 2021/5/6.
+//
+
+#include "homogeneous.h"
+#include "interaction.h"
+#include "sampler.h"
+
+namespace sr {
+
+    Spectrum HomogeneousMedium::Tr(const Ray &ray, Sampler &/*sampler*/) const {
+        //Beer's law, tMax may be Infinity for rays leaving the scene
+        return Exp(-sigma_t * (std::min(ray.tMax * ray.d.Length(), MaxFloat)));
+    }
+
+    Spectrum HomogeneousMedium::Sample(const Ray &ray, Sampler &sampler, MediumInteraction *mi) const {
+        //pick a channel uniformly and sample its exponential free flight distance
+        int channel = std::min((int) (sampler.Get1D() * Spectrum::nSamples), Spectrum::nSamples - 1);
+        Float rayLength = ray.d.Length();
+        Float dist = -std::log(1 - sampler.Get1D()) / sigma_t[channel];
+        Float t = std::min(dist / rayLength, ray.tMax);
+        bool sampledMedium = t < ray.tMax;
+        if (sampledMedium) *mi = MediumInteraction(ray.o + ray.d * t, -ray.d, ray.time, this, &phase);
+
+        Spectrum Tr = Exp(-sigma_t * (std::min(t, MaxFloat) * rayLength));
+
+        //pdf is averaged over the channels that could have been picked
+        Spectrum density = sampledMedium ? (sigma_t * Tr) : Tr;
+        Float pdf = 0;
+        for (int i = 0; i < Spectrum::nSamples; ++i) pdf += density[i];
+        pdf *= 1 / (Float) Spectrum::nSamples;
+        if (pdf == 0) pdf = 1;
+        return sampledMedium ? (Tr * sigma_s / pdf) : (Tr / pdf);
+    }
+}
@@ -0,0 +1,25 @@
+//
+// Created by 18310 on 2021/5/8.
+//
+
+#include "sparsegrid.h"
+
+namespace sr {
+
+    SparseGridMedium::SparseGridMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, Float g,
+                                       const Transform &mediumToWorld, std::unique_ptr<SparseVolume> volume,
+                                       int majorantRes)
+            : GridDensityMedium(sigma_a, sigma_s, g, mediumToWorld), volume(std::move(volume)) {
+        BuildMajorantGrid(majorantRes);
+    }
+
+    Float SparseGridMedium::MaxDensity(const Bounds3f &b) const {
+        //voxels whose trilinear support overlaps b, as in GridDensityMedium
+        Point3i res = volume->Resolution();
+        Point3i p0((int) std::floor(b.pMin.x * res.x - 0.5f), (int) std::floor(b.pMin.y * res.y - 0.5f),
+                   (int) std::floor(b.pMin.z * res.z - 0.5f));
+        Point3i p1((int) std::floor(b.pMax.x * res.x - 0.5f) + 2, (int) std::floor(b.pMax.y * res.y - 0.5f) + 2,
+                   (int) std::floor(b.pMax.z * res.z - 0.5f) + 2);
+        return volume->MaxValue(Bounds3i(p0, p1));
+    }
+}
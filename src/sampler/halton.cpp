@@ -0,0 +1,43 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#include "halton.h"
+#include <numeric>
+#include <random>
+
+namespace sr {
+
+    HaltonSampler::HaltonSampler(int64_t samplesPerPixel, uint32_t seed) : Sampler(samplesPerPixel, seed) {
+        std::vector<uint16_t> perms(PrimeSum(PrimeTableSize));
+        std::mt19937 rng(seed);
+        for (int i = 0; i < PrimeTableSize; ++i) {
+            uint16_t *p = &perms[PrimeSum(i)];
+            std::iota(p, p + Primes[i], uint16_t(0));
+            std::shuffle(p, p + Primes[i], rng);
+        }
+        permutations = std::make_shared<const std::vector<uint16_t>>(std::move(perms));
+    }
+
+    Float HaltonSampler::SampleDimension(int dim) const {
+        //dimensions past the prime table reuse the bases from a different offset into the sequence
+        int baseIndex = dim % PrimeTableSize;
+        uint64_t offset = PixelHash(dim / PrimeTableSize) & ((uint64_t(1) << 20) - 1);
+        return ScrambledRadicalInverse(baseIndex, offset + uint64_t(sampleIndex),
+                                       &(*permutations)[PrimeSum(baseIndex)]);
+    }
+
+    Float HaltonSampler::Get1D() {
+        return SampleDimension(dimension++);
+    }
+
+    Point2f HaltonSampler::Get2D() {
+        Point2f u(SampleDimension(dimension), SampleDimension(dimension + 1));
+        dimension += 2;
+        return u;
+    }
+
+    std::unique_ptr<Sampler> HaltonSampler::Clone() const {
+        return std::unique_ptr<Sampler>(new HaltonSampler(*this));
+    }
+}
@@ -0,0 +1,37 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#include "pmj02.h"
+
+namespace sr {
+
+    //Owen scrambling the index flips each bit by a hash of the bits above it, so samples [0, 2^k) land on an
+    //aligned block of 2^k sequence points, which is itself a (0, k, 2)-net. Unlike PermutedIndex, this
+    //decorrelates the pairs and keeps every power of two prefix stratified.
+    static inline uint64_t ShuffledIndex(uint64_t index, uint32_t seed) {
+        return (index & ~uint64_t(0xffffffff)) | OwenScramble(uint32_t(index), seed);
+    }
+
+    Float PMJ02Sampler::Get1D() {
+        uint64_t hash = PixelHash(dimension++);
+        uint64_t index = ShuffledIndex(uint64_t(sampleIndex), uint32_t(hash >> 32));
+        return UInt32ToFloat(OwenScramble(SobolSampleBits(index, 0), uint32_t(hash)));
+    }
+
+    Point2f PMJ02Sampler::Get2D() {
+        uint64_t hash = PixelHash(dimension);
+        //both coordinates share the index, so the pair keeps its (0, 2) stratification.
+        //The pixel pair takes the samples in sequence order, the later pairs are shuffled against it.
+        uint64_t index = dimension == 0 ? uint64_t(sampleIndex) : ShuffledIndex(uint64_t(sampleIndex),
+                                                                                 uint32_t(hash >> 32));
+        dimension += 2;
+        uint32_t seedX = uint32_t(hash), seedY = uint32_t(MixBits(hash));
+        return Point2f(UInt32ToFloat(OwenScramble(SobolSampleBits(index, 0), seedX)),
+                       UInt32ToFloat(OwenScramble(SobolSampleBits(index, 1), seedY)));
+    }
+
+    std::unique_ptr<Sampler> PMJ02Sampler::Clone() const {
+        return std::unique_ptr<Sampler>(new PMJ02Sampler(*this));
+    }
+}
@@ -0,0 +1,30 @@
+//
+// Created by 18310 on 2021/4/27.
+//
+
+#include "sobol.h"
+
+namespace sr {
+
+    Float SobolSampler::SampleDimension(int dim) const {
+        uint64_t hash = PixelHash(dim);
+        if (dim < NSobolDimensions) {
+            return UInt32ToFloat(OwenScramble(SobolSampleBits(uint64_t(sampleIndex), dim), uint32_t(hash)));
+        }
+        return UInt32ToFloat(OwenScramble(SobolSampleBits(PermutedIndex(hash >> 32), 0), uint32_t(hash)));
+    }
+
+    Float SobolSampler::Get1D() {
+        return SampleDimension(dimension++);
+    }
+
+    Point2f SobolSampler::Get2D() {
+        Point2f u(SampleDimension(dimension), SampleDimension(dimension + 1));
+        dimension += 2;
+        return u;
+    }
+
+    std::unique_ptr<Sampler> SobolSampler::Clone() const {
+        return std::unique_ptr<Sampler>(new SobolSampler(*this));
+    }
+}
@@ -3,11 +3,13 @@
 //
 
 #include "sphere.h"
+#include "interaction.h"
+
 namespace sr {
 
     //tighten the bounding box of sphere
     Bounds3f Sphere::ObjectBound() const {
-        Point3f pMin, pMax(radius, radius, zMax);
+        Point3f pMin(0, 0, zMin), pMax(radius, radius, zMax);
         if(phiMax <= PiOver2){
             pMax.y = radius * std::sin(phiMax);
         } else if(phiMax <= Pi){
@@ -20,12 +22,71 @@ namespace sr {
         return Bounds3f(pMin, pMax);
     }
 
-    bool Sphere::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect, bool testAlphaTexture) const {
+    //project back onto the surface, the hit computed from t carries more error
+    static inline Point3f RefineSpherePoint(Point3f pHit, Float radius) {
+        pHit *= radius / Distance(pHit, Point3f(0, 0, 0));
+        if (pHit.x == 0 && pHit.y == 0) pHit.x = 1e-5f * radius;
+        return pHit;
+    }
+
+    static inline Float SpherePhi(const Point3f &pHit) {
+        Float phi = std::atan2(pHit.y, pHit.x);
+        return phi < 0 ? phi + 2 * Pi : phi;
+    }
+
+    bool Sphere::IntersectHit(const Ray &r, HitRecord *hit, bool /*testAlphaTexture*/) const {
+        Ray ray = (*WorldToObject)(r);
+        Float a = ray.d.x * ray.d.x + ray.d.y * ray.d.y + ray.d.z * ray.d.z;
+        Float b = 2 * (ray.d.x * ray.o.x + ray.d.y * ray.o.y + ray.d.z * ray.o.z);
+        Float c = ray.o.x * ray.o.x + ray.o.y * ray.o.y + ray.o.z * ray.o.z - radius * radius;
+        Float t0, t1;
+        if (!Quadratic(a, b, c, &t0, &t1)) return false;
+        if (t0 >= ray.tMax || t1 <= 0) return false;
+
+        //try the near root, then the far one when the near one is clipped away
+        for (Float tShapeHit : {t0, t1}) {
+            if (tShapeHit <= 0 || tShapeHit >= ray.tMax) continue;
+            Point3f pHit = RefineSpherePoint(ray(tShapeHit), radius);
+            Float phi = SpherePhi(pHit);
+            if ((zMin > -radius && pHit.z < zMin) || (zMax < radius && pHit.z > zMax) || phi > phiMax) continue;
+            Float theta = SafeACos(pHit.z / radius);
+            hit->tHit = tShapeHit;
+            hit->primitiveId = -1;
+            hit->uv = Point2f(phi / phiMax, (theta - thetaMin) / (thetaMax - thetaMin));
+            return true;
+        }
         return false;
     }
 
+    void Sphere::ComputeObjectInteraction(const Ray &r, const HitRecord &hit, SurfaceInteraction *isect) const {
+        Ray ray = (*WorldToObject)(r);
+        Point3f pHit = RefineSpherePoint(ray(hit.tHit), radius);
+
+        //parametric derivatives
+        Float zRadius = std::sqrt(pHit.x * pHit.x + pHit.y * pHit.y);
+        Float invZRadius = 1 / zRadius;
+        Float cosPhi = pHit.x * invZRadius, sinPhi = pHit.y * invZRadius;
+        Float sinTheta = SafeSqrt(1 - (pHit.z / radius) * (pHit.z / radius));
+        Vector3f dpdu(-phiMax * pHit.y, phiMax * pHit.x, 0);
+        Vector3f dpdv = (thetaMax - thetaMin) * Vector3f(pHit.z * cosPhi, pHit.z * sinPhi, -radius * sinTheta);
+
+        //normal derivatives from the Weingarten equations
+        Vector3f d2Pduu = -phiMax * phiMax * Vector3f(pHit.x, pHit.y, 0);
+        Vector3f d2Pduv = (thetaMax - thetaMin) * pHit.z * phiMax * Vector3f(-sinPhi, cosPhi, 0);
+        Vector3f d2Pdvv = -(thetaMax - thetaMin) * (thetaMax - thetaMin) * Vector3f(pHit.x, pHit.y, pHit.z);
+        Float E = Dot(dpdu, dpdu), F = Dot(dpdu, dpdv), G = Dot(dpdv, dpdv);
+        Vector3f N = Normalize(Cross(dpdu, dpdv));
+        Float e = Dot(N, d2Pduu), f = Dot(N, d2Pduv), g = Dot(N, d2Pdvv);
+        Float invEGF2 = 1 / (E * G - F * F);
+        Normal3f dndu((f * F - e * G) * invEGF2 * dpdu + (e * F - f * E) * invEGF2 * dpdv);
+        Normal3f dndv((g * F - f * G) * invEGF2 * dpdu + (f * F - g * E) * invEGF2 * dpdv);
+
+        Vector3f pError = gamma(5) * Vector3f(std::abs(pHit.x), std::abs(pHit.y), std::abs(pHit.z));
+        *isect = SurfaceInteraction(pHit, pError, -ray.d, ray.time, hit.uv, dpdu, dpdv, dndu, dndv, this);
+    }
+
     Float Sphere::Area() const {
-        return 0;
+        return phiMax * radius * (zMax - zMin);
     }
 
 